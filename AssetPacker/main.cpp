@@ -0,0 +1,116 @@
+#include <Windows.h>
+#include <Rig3D\Common\AssetArchive.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+using namespace Rig3D;
+
+// Collects every file under directory, recording its path relative to the packing root.
+static void CollectFiles(const std::string& root, const std::string& directory, std::vector<std::string>& filenames, std::vector<std::string>& paths)
+{
+	WIN32_FIND_DATAA data;
+	HANDLE find = FindFirstFileA((root + directory + "*").c_str(), &data);
+	if (find == INVALID_HANDLE_VALUE)
+	{
+		return;
+	}
+
+	do
+	{
+		std::string name = data.cFileName;
+		if (name == "." || name == "..")
+		{
+			continue;
+		}
+
+		if (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+		{
+			CollectFiles(root, directory + name + "/", filenames, paths);
+		}
+		else
+		{
+			filenames.push_back(root + directory + name);
+			paths.push_back(directory + name);
+		}
+	} while (FindNextFileA(find, &data));
+
+	FindClose(find);
+}
+
+static int Pack(const char* archiveFilename, const char* rootDirectory)
+{
+	std::string root = rootDirectory;
+	if (!root.empty() && root.back() != '/' && root.back() != '\\')
+	{
+		root += "/";
+	}
+
+	std::vector<std::string> filenames;
+	std::vector<std::string> paths;
+	CollectFiles(root, "", filenames, paths);
+
+	std::vector<ArchiveSource> sources(filenames.size());
+	for (size_t i = 0; i < sources.size(); i++)
+	{
+		sources[i].filename = filenames[i].c_str();
+		sources[i].path = paths[i].c_str();
+	}
+
+	if (!WriteAssetArchive(archiveFilename, sources.data(), static_cast<uint32_t>(sources.size())))
+	{
+		fprintf(stderr, "Failed to write %s\n", archiveFilename);
+		return 1;
+	}
+
+	printf("Packed %u files into %s\n", static_cast<uint32_t>(sources.size()), archiveFilename);
+	return 0;
+}
+
+static int List(const char* archiveFilename)
+{
+	AssetArchive archive;
+	if (!OpenAssetArchive(archive, archiveFilename))
+	{
+		fprintf(stderr, "Failed to open %s\n", archiveFilename);
+		return 1;
+	}
+
+	uint64_t totalSize = 0;
+	uint64_t totalCompressedSize = 0;
+	for (uint32_t i = 0; i < archive.header->entryCount; i++)
+	{
+		const ArchiveEntry& entry = archive.entries[i];
+
+		uint64_t compressedSize = 0;
+		for (uint32_t c = 0; c < entry.chunkCount; c++)
+		{
+			compressedSize += archive.chunks[entry.firstChunk + c].compressedSize;
+		}
+
+		printf("%12llu %12llu  %s\n", entry.size, compressedSize, GetArchiveEntryName(archive, entry));
+		totalSize += entry.size;
+		totalCompressedSize += compressedSize;
+	}
+
+	printf("%12llu %12llu  %u files\n", totalSize, totalCompressedSize, archive.header->entryCount);
+	return 0;
+}
+
+// AssetPacker <archive> <directory>	Packs every file under directory, stored by its path relative to directory.
+// AssetPacker -l <archive>				Lists entries with their stored and compressed sizes.
+int main(int argc, char** argv)
+{
+	if (argc == 3 && strcmp(argv[1], "-l") == 0)
+	{
+		return List(argv[2]);
+	}
+
+	if (argc == 3)
+	{
+		return Pack(argv[1], argv[2]);
+	}
+
+	fprintf(stderr, "Usage: AssetPacker <archive> <directory>\n       AssetPacker -l <archive>\n");
+	return 1;
+}
@@ -10,9 +10,16 @@
 #include <d3dcompiler.h>
 #include <Rig3D/Graphics/Camera.h>
 #include "Rig3D/Intersection.h"
+#include "Rig3D/Visibility.h"
+#include "Rig3D/Geometry.h"
 #include <vector>
+#include <queue>
+#include <functional>
 
 #define DYNAMIC_COLLISION_TEST			0
+#define CONTINUOUS_COLLISION_DETECTION	1
+#define MAX_COLLISION_EVENTS			256
+#define POOL_TABLE_PART_COUNT			7
 #define PI								3.1415926535f
 #define BALL_COUNT						16
 #define ROW_COUNT						5
@@ -93,6 +100,36 @@ public:
 		Collision(vec3f poi, float t, int s0, int s1) : poi(poi), t(t), s0(s0), s1(s1) {};
 	};
 
+	// Predicted time of impact. s1 indexes a sphere for sphere-sphere events and a plane otherwise.
+	// Generations are snapshots of the body generations at prediction time, so any event predicted
+	// before one of its bodies changed velocity is stale and gets discarded when popped.
+	struct CollisionEvent
+	{
+		float		t;
+		int			s0;
+		int			s1;
+		uint32_t	g0;
+		uint32_t	g1;
+		bool		isPlane;
+
+		CollisionEvent(float t, int s0, int s1, uint32_t g0, uint32_t g1, bool isPlane) : t(t), s0(s0), s1(s1), g0(g0), g1(g1), isPlane(isPlane) {};
+
+		bool operator>(const CollisionEvent& other) const { return t > other.t; };
+	};
+
+	typedef std::priority_queue<CollisionEvent, std::vector<CollisionEvent>, std::greater<CollisionEvent>> CollisionEventQueue;
+
+	enum PoolTablePart
+	{
+		POOL_TABLE_LEGS,
+		POOL_TABLE_FEET,
+		POOL_TABLE_SIDES,
+		POOL_TABLE_GUARDS,
+		POOL_TABLE_SURFACE,
+		POOL_TABLE_BOTTOM,
+		POOL_TABLE_HOLES
+	};
+
 	struct PoolTable
 	{
 		IMesh*	legs;
@@ -102,6 +139,9 @@ public:
 		IMesh*	surface;
 		IMesh*	bottom;
 		IMesh*	holes;
+
+		AABB<vec3f>	localBounds[POOL_TABLE_PART_COUNT];
+		OBB<vec3f>	worldBounds[POOL_TABLE_PART_COUNT];
 	};
 
 	struct ViewProjection
@@ -121,7 +161,13 @@ public:
 	std::vector<Collision>			mSphereCollisions;
 	std::vector<Collision>			mPlaneCollisions;
 
+	CollisionEventQueue				mCollisionEvents;
+	float							mBodyTimes[BALL_COUNT];
+	uint32_t						mBodyGenerations[BALL_COUNT];
+
 	Camera							mCamera;
+	Frustum							mFrustum;
+	CullStatistics					mCullStatistics;
 
 	LinearAllocator					mAllocator;
 	MeshLibrary<LinearAllocator>	mMeshLibrary;
@@ -187,6 +233,12 @@ public:
 		mMeshLibrary.SetAllocator(&mAllocator);
 		mSphereCollisions.reserve(BALL_COUNT);
 		mPlaneCollisions.reserve(BALL_COUNT);
+
+		for (int i = 0; i < BALL_COUNT; i++)
+		{
+			mBodyTimes[i] = 0.0f;
+			mBodyGenerations[i] = 0;
+		}
 	}
 
 	~BilliardsSample()
@@ -242,14 +294,42 @@ public:
 		OBJBasicResource<Vertex3> poolTableHoles("Models\\Holes.obj");
 		OBJBasicResource<Vertex3> ball("Models\\Ball.obj");
 
-		mMeshLibrary.LoadMesh(&mPoolTable.legs, mRenderer, poolTableLegs);
-		mMeshLibrary.LoadMesh(&mPoolTable.feet, mRenderer, poolTableFeet);
-		mMeshLibrary.LoadMesh(&mPoolTable.sides, mRenderer, poolTableSides);
-		mMeshLibrary.LoadMesh(&mPoolTable.guards, mRenderer, poolTableGuards);
-		mMeshLibrary.LoadMesh(&mPoolTable.surface, mRenderer, poolTableSurface);
-		mMeshLibrary.LoadMesh(&mPoolTable.bottom, mRenderer, poolTableBottom);
-		mMeshLibrary.LoadMesh(&mPoolTable.holes, mRenderer, poolTableHoles);
-		mMeshLibrary.LoadMesh(&mBallMesh, mRenderer, ball);
+		LoadPoolTablePart(&mPoolTable.legs, poolTableLegs, POOL_TABLE_LEGS);
+		LoadPoolTablePart(&mPoolTable.feet, poolTableFeet, POOL_TABLE_FEET);
+		LoadPoolTablePart(&mPoolTable.sides, poolTableSides, POOL_TABLE_SIDES);
+		LoadPoolTablePart(&mPoolTable.guards, poolTableGuards, POOL_TABLE_GUARDS);
+		LoadPoolTablePart(&mPoolTable.surface, poolTableSurface, POOL_TABLE_SURFACE);
+		LoadPoolTablePart(&mPoolTable.bottom, poolTableBottom, POOL_TABLE_BOTTOM);
+		LoadPoolTablePart(&mPoolTable.holes, poolTableHoles, POOL_TABLE_HOLES);
+
+		// Every ball is drawn from this mesh, so stand in a sphere rather than run without one.
+		if (!mMeshLibrary.LoadMesh(&mBallMesh, mRenderer, ball))
+		{
+			ReportLoadFailure(ball.mFilename);
+
+			Geometry::Sphere(ball.mVertices, ball.mIndices, 16, 16, BALL_RADIUS);
+			mMeshLibrary.UploadMesh(&mBallMesh, mRenderer, ball);
+		}
+	}
+
+	// A part that fails to load keeps a null mesh and empty bounds, and is left out of rendering.
+	void LoadPoolTablePart(IMesh** mesh, OBJBasicResource<Vertex3>& resource, const uint32_t& part)
+	{
+		if (!mMeshLibrary.LoadMesh(mesh, mRenderer, resource))
+		{
+			ReportLoadFailure(resource.mFilename);
+			mPoolTable.localBounds[part].origin = mPoolTable.localBounds[part].halfSize = vec3f(0.0f);
+			return;
+		}
+
+		ComputeAABB(mPoolTable.localBounds[part], &resource.mVertices[0], static_cast<uint32_t>(resource.mVertices.size()));
+	}
+
+	void ReportLoadFailure(const char* filename)
+	{
+		char message[256];
+		sprintf_s(message, "Billiards Sample: failed to load %s\n", filename);
+		OutputDebugStringA(message);
 	}
 
 	void InitializeBoundingVolumes()
@@ -293,7 +373,14 @@ public:
 		mPlanes[2].distance = RIGHT_PLANE_DISTANCE;
 		mPlanes[3].distance = NEAR_PLANE_DISTANCE;
 
-		mTableWorldMatrix = (mat4f::rotateY(PI * 0.5f) * mat4f::translate(gTablePosition)).transpose();
+		mat4f tableWorldMatrix = mat4f::rotateY(PI * 0.5f) * mat4f::translate(gTablePosition);
+		mTableWorldMatrix = tableWorldMatrix.transpose();
+
+		// Table is static, so world bounds are only built once.
+		for (uint32_t i = 0; i < POOL_TABLE_PART_COUNT; i++)
+		{
+			TransformAABB(mPoolTable.worldBounds[i], mPoolTable.localBounds[i], tableWorldMatrix);
+		}
 	}
 
 	void InitializeShaders()
@@ -532,7 +619,9 @@ public:
 		static int frame = 0;
 		HandleInput();
 
-		
+#if CONTINUOUS_COLLISION_DETECTION != 0
+		StepContinuous(milliseconds);
+#else
 		if (frame % 2 == 0)
 		{
 			// Physics
@@ -549,6 +638,7 @@ public:
 			ResolveSphereSphereCollisions(&mSphereCollisions, mSpheres, mBallTransforms, mRigidBodies);
 			ResolvePlaneSphereCollisions(&mPlaneCollisions, mPlanes, mSpheres, mRigidBodies);
 		}
+#endif
 		// TO DO: Interpolate State 
 		
 		// Update Renderable Structures
@@ -563,6 +653,10 @@ public:
 		mViewProjection.view = mat4f::lookAtLH(mCamera.mTransform.GetPosition() + mCamera.mTransform.GetForward(), mCamera.mTransform.GetPosition(), mCamera.mTransform.GetUp()).transpose();
 		//mViewProjection.view = mat4f::lookAtLH(gTablePosition, mCamera.mTransform.GetPosition(), vec3f(0.0f, 1.0f, 0.0f)).transpose();
 
+		// View and projection are stored transposed for the shaders.
+		mat4f viewProjection = (mViewProjection.projection * mViewProjection.view).transpose();
+		ExtractNormalizedFrustumLH(&mFrustum, viewProjection);
+
 	}
 
 	void UpdateBallTransforms()
@@ -659,6 +753,8 @@ public:
 		mRenderer->VSetPrimitiveType(GPU_PRIMITIVE_TYPE_TRIANGLE);
 		mDeviceContext->UpdateSubresource(mViewProjectionBuffer, 0, nullptr, &mViewProjection, 0, 0);
 
+		mCullStatistics.Reset();
+
 		RenderBalls();
 		RenderPoolTable();
 
@@ -699,48 +795,58 @@ public:
 
 		// Legs
 		mDeviceContext->PSSetShaderResources(0, 1, &mPoolTableWoodSRV);
-		mRenderer->VBindMesh(mPoolTable.legs);
-		mRenderer->VDrawIndexed(0, mPoolTable.legs->GetIndexCount());
+		RenderPoolTablePart(mPoolTable.legs, POOL_TABLE_LEGS);
 
 		// Feet
 		mDeviceContext->PSSetShaderResources(0, 1, &mPoolTableConcreteSRV);
-		mRenderer->VBindMesh(mPoolTable.feet);
-		mRenderer->VDrawIndexed(0, mPoolTable.feet->GetIndexCount());
+		RenderPoolTablePart(mPoolTable.feet, POOL_TABLE_FEET);
 
 		// Guards
-		mRenderer->VBindMesh(mPoolTable.guards);
-		mRenderer->VDrawIndexed(0, mPoolTable.guards->GetIndexCount());
+		RenderPoolTablePart(mPoolTable.guards, POOL_TABLE_GUARDS);
 
 		// Surface
 		mDeviceContext->PSSetShaderResources(0, 1, &mPoolTableFeltSRV);
-		mRenderer->VBindMesh(mPoolTable.surface);
-		mRenderer->VDrawIndexed(0, mPoolTable.surface->GetIndexCount());
-
+		RenderPoolTablePart(mPoolTable.surface, POOL_TABLE_SURFACE);
 
 		// Bottom 
 		mDeviceContext->PSSetShaderResources(0, 1, &mPoolTableDarkWoodSRV);
-		mRenderer->VBindMesh(mPoolTable.bottom);
-		mRenderer->VDrawIndexed(0, mPoolTable.bottom->GetIndexCount());
+		RenderPoolTablePart(mPoolTable.bottom, POOL_TABLE_BOTTOM);
 
 		// Holes
-		mRenderer->VBindMesh(mPoolTable.holes);
-		mRenderer->VDrawIndexed(0, mPoolTable.holes->GetIndexCount());
+		RenderPoolTablePart(mPoolTable.holes, POOL_TABLE_HOLES);
 
 		// Sides
-		mRenderer->VBindMesh(mPoolTable.sides);
-		mRenderer->VDrawIndexed(0, mPoolTable.sides->GetIndexCount());
+		RenderPoolTablePart(mPoolTable.sides, POOL_TABLE_SIDES);
+	}
+
+	void RenderPoolTablePart(IMesh* mesh, const uint32_t& part)
+	{
+		if (!mesh)
+		{
+			return;
+		}
+
+		uint8_t planeMask = RIG_CULL_PLANE_MASK_ALL;
+		if (CullOBB(mFrustum, mPoolTable.worldBounds[part], planeMask, &mCullStatistics) == CULL_RESULT_OUTSIDE)
+		{
+			return;
+		}
+
+		mRenderer->VBindMesh(mesh);
+		mRenderer->VDrawIndexed(0, mesh->GetIndexCount());
 	}
 
 	void VShutdown() override
 	{
-		mBallMesh->~IMesh();
-		mPoolTable.legs->~IMesh();
-		mPoolTable.sides->~IMesh();
-		mPoolTable.feet->~IMesh();
-		mPoolTable.surface->~IMesh();
-		mPoolTable.holes->~IMesh(); 
-		mPoolTable.guards->~IMesh();
-		mPoolTable.bottom->~IMesh();
+		IMesh* meshes[] = { mBallMesh, mPoolTable.legs, mPoolTable.sides, mPoolTable.feet, mPoolTable.surface, mPoolTable.holes, mPoolTable.guards, mPoolTable.bottom };
+		for (IMesh* mesh : meshes)
+		{
+			if (mesh)
+			{
+				mesh->~IMesh();
+			}
+		}
+
 		mAllocator.Free();
 	}
 
@@ -773,10 +879,229 @@ public:
 		vec3f v = mRigidBodies[0].velocity;
 		float FPS = 1.0f / (frameTime / 1000.0f);
 		char str[256];
-		sprintf_s(str, "Billiards FPS %f FT %f STEPS %d CUE Velocity %3f %3f %3f Angular Velocity %3f %3f %3f", FPS, frameTime, i, v.x, v.y, v.z, mRigidBodies[0].angularVelocity.x, mRigidBodies[0].angularVelocity.y, mRigidBodies[0].angularVelocity.z);
+		sprintf_s(str, "Billiards FPS %f FT %f STEPS %d CULLED %u/%u INSIDE %u CUE Velocity %3f %3f %3f Angular Velocity %3f %3f %3f", FPS, frameTime, i, mCullStatistics.culled, mCullStatistics.tested, mCullStatistics.inside, v.x, v.y, v.z, mRigidBodies[0].angularVelocity.x, mRigidBodies[0].angularVelocity.y, mRigidBodies[0].angularVelocity.z);
 		mRenderer->SetWindowCaption(str);
 	}
 
+#pragma region Continuous Collision Detection
+
+	// Event driven alternative to IntegrateBalls + Detect/Resolve. Friction is applied once per frame and
+	// integrated over a single PHYSICS_TIME_STEP, the same impulse the first RK4 call of IntegrateBalls takes
+	// from it. Every ball then moves on a straight line until its next impact. Time left over when a frame hits
+	// MAX_COLLISION_EVENTS is carried into the next frame.
+	void StepContinuous(double milliseconds)
+	{
+		float frameTime = static_cast<float>(milliseconds);
+		if (frameTime > 16.67f)
+		{
+			frameTime = 16.67f;
+		}
+
+		static float carryTime = 0.0f;
+		float stepTime = frameTime + carryTime;
+
+		ApplyFriction(mSpheres, mRigidBodies, BALL_COUNT);
+		IntegrateVelocities(mRigidBodies, PHYSICS_TIME_STEP, BALL_COUNT);
+
+		int eventCount = 0;
+		carryTime = stepTime - ResolveCollisionEvents(stepTime, eventCount);
+
+		vec3f v = mRigidBodies[0].velocity;
+		float FPS = 1.0f / (frameTime / 1000.0f);
+		char str[256];
+		sprintf_s(str, "Billiards FPS %f FT %f EVENTS %d CARRY %f CULLED %u/%u PLANE TESTS %u CUE Velocity %3f %3f %3f", FPS, frameTime, eventCount, carryTime, mCullStatistics.culled, mCullStatistics.tested, mCullStatistics.planeTests, v.x, v.y, v.z);
+		mRenderer->SetWindowCaption(str);
+	}
+
+	// Moves every ball through up to stepTime, resolving impacts in time order. Times of impact are predicted
+	// once and kept in a min-heap; only the bodies involved in a resolved event are re-predicted, so the work
+	// scales with the number of actual collisions. Once MAX_COLLISION_EVENTS are resolved, stops at the time of
+	// the next one, which is predicted again next frame. Returns the time actually simulated.
+	float ResolveCollisionEvents(float stepTime, int& eventCount)
+	{
+		while (!mCollisionEvents.empty())
+		{
+			mCollisionEvents.pop();
+		}
+
+		for (int i = 0; i < BALL_COUNT; i++)
+		{
+			mBodyTimes[i] = 0.0f;
+		}
+
+		for (int i = 0; i < BALL_COUNT; i++)
+		{
+			for (int j = i + 1; j < BALL_COUNT; j++)
+			{
+				PredictSphereSphere(i, j, stepTime);
+			}
+
+			for (int p = 0; p < PLANE_COUNT; p++)
+			{
+				PredictSpherePlane(i, p, stepTime);
+			}
+		}
+
+		float endTime = stepTime;
+		while (!mCollisionEvents.empty())
+		{
+			CollisionEvent e = mCollisionEvents.top();
+			mCollisionEvents.pop();
+
+			if (e.isPlane)
+			{
+				if (e.g0 != mBodyGenerations[e.s0])
+				{
+					continue;
+				}
+			}
+			else if (e.g0 != mBodyGenerations[e.s0] || e.g1 != mBodyGenerations[e.s1])
+			{
+				continue;
+			}
+
+			if (eventCount == MAX_COLLISION_EVENTS)
+			{
+				endTime = e.t;
+				break;
+			}
+
+			if (e.isPlane)
+			{
+				AdvanceBody(e.s0, e.t);
+
+				vec3f contactNormal = mPlanes[e.s1].normal;
+				float k = CalculatePlaneSphereImpulse(mSpheres[e.s0], mRigidBodies[e.s0], contactNormal);
+				mRigidBodies[e.s0].velocity += k * contactNormal * mRigidBodies[e.s0].inverseMass;
+				mBodyGenerations[e.s0]++;
+
+				RepredictBody(e.s0, -1, stepTime);
+			}
+			else
+			{
+				AdvanceBody(e.s0, e.t);
+				AdvanceBody(e.s1, e.t);
+
+				vec3f contactNormal = cliqCity::graphicsMath::normalize(mSpheres[e.s1].origin - mSpheres[e.s0].origin);
+				float k = CalculateSphereSphereImpulse(mSpheres[e.s0], mSpheres[e.s1], mRigidBodies[e.s0], mRigidBodies[e.s1], contactNormal);
+				mRigidBodies[e.s0].velocity -= k * contactNormal * mRigidBodies[e.s0].inverseMass;
+				mRigidBodies[e.s1].velocity += k * contactNormal * mRigidBodies[e.s1].inverseMass;
+				mBodyGenerations[e.s0]++;
+				mBodyGenerations[e.s1]++;
+
+				RepredictBody(e.s0, e.s1, stepTime);
+				RepredictBody(e.s1, e.s0, stepTime);
+			}
+
+			eventCount++;
+		}
+
+		for (int i = 0; i < BALL_COUNT; i++)
+		{
+			AdvanceBody(i, endTime);
+			IntegrateRotation(mBallTransforms[i], mRigidBodies[i], endTime);
+		}
+
+		return endTime;
+	}
+
+	void IntegrateVelocities(RigidBody* rigidBodies, float dt, int count)
+	{
+		for (int i = 0; i < count; i++)
+		{
+			rigidBodies[i].velocity			+= rigidBodies[i].forces * rigidBodies[i].inverseMass * dt;
+			rigidBodies[i].angularVelocity	+= rigidBodies[i].torques * gSphereInverseTensorVector * dt;
+			rigidBodies[i].angularVelocity	= rigidBodies[i].angularVelocity * vec3f(1.0f, 0.02f, 1.0f);
+			rigidBodies[i].forces = rigidBodies[i].torques = vec3f(0.0f);
+		}
+	}
+
+	inline void IntegrateRotation(Transform& transform, const RigidBody& rigidBody, float dt)
+	{
+		quatf rotation = transform.GetRotation();
+		rotation += rotation * quatf(0.0f, rigidBody.angularVelocity) * 0.5f * dt;
+		transform.SetRotation(cliqCity::graphicsMath::normalize(rotation));
+	}
+
+	// Moves a body along its current velocity from its local time to t.
+	inline void AdvanceBody(int i, float t)
+	{
+		float dt = t - mBodyTimes[i];
+		if (dt > 0.0f)
+		{
+			mSpheres[i].origin += mRigidBodies[i].velocity * dt;
+			mBallTransforms[i].SetPosition(mSpheres[i].origin);
+			mBodyTimes[i] = t;
+		}
+	}
+
+	// Sphere as it will be at time t if it keeps its current velocity.
+	inline Sphere SphereAtTime(int i, float t) const
+	{
+		Sphere sphere = mSpheres[i];
+		sphere.origin += mRigidBodies[i].velocity * (t - mBodyTimes[i]);
+		return sphere;
+	}
+
+	void PredictSphereSphere(int i, int j, float frameTime)
+	{
+		float t0 = max(mBodyTimes[i], mBodyTimes[j]);
+		Sphere s0 = SphereAtTime(i, t0);
+		Sphere s1 = SphereAtTime(j, t0);
+
+		// Only approaching pairs produce events. Resting contacts would otherwise report t = 0 forever.
+		vec3f relativeVelocity = mRigidBodies[j].velocity - mRigidBodies[i].velocity;
+		if (cliqCity::graphicsMath::dot(relativeVelocity, s1.origin - s0.origin) >= 0.0f)
+		{
+			return;
+		}
+
+		vec3f poi;
+		float t;
+		if (IntersectDynamicSphereSphere<vec3f>(s0, mRigidBodies[i].velocity, s1, mRigidBodies[j].velocity, poi, t) && t0 + t <= frameTime)
+		{
+			mCollisionEvents.push(CollisionEvent(t0 + t, i, j, mBodyGenerations[i], mBodyGenerations[j], false));
+		}
+	}
+
+	void PredictSpherePlane(int i, int p, float frameTime)
+	{
+		float t0 = mBodyTimes[i];
+		const vec3f& velocity = mRigidBodies[i].velocity;
+
+		float distance = cliqCity::graphicsMath::dot(mPlanes[p].normal, mSpheres[i].origin) - mPlanes[p].distance;
+		if (cliqCity::graphicsMath::dot(mPlanes[p].normal, velocity) * distance >= 0.0f)
+		{
+			return;
+		}
+
+		vec3f poi;
+		float t;
+		if (IntersectDynamicSpherePlane<vec3f>(mSpheres[i], velocity, mPlanes[p], poi, t) && t0 + t <= frameTime)
+		{
+			mCollisionEvents.push(CollisionEvent(t0 + t, i, p, mBodyGenerations[i], 0, true));
+		}
+	}
+
+	// Re-predicts body i against every plane and every sphere except the one it just collided with.
+	void RepredictBody(int i, int except, float frameTime)
+	{
+		for (int j = 0; j < BALL_COUNT; j++)
+		{
+			if (j != i && j != except)
+			{
+				PredictSphereSphere(i, j, frameTime);
+			}
+		}
+
+		for (int p = 0; p < PLANE_COUNT; p++)
+		{
+			PredictSpherePlane(i, p, frameTime);
+		}
+	}
+
+#pragma endregion
+
 	void Euler(Transform* transforms, Sphere* spheres, RigidBody* rigidBodies, float dt, int count)
 	{
 		for (int i = 0; i < BALL_COUNT; i++)
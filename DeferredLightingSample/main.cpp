@@ -5,10 +5,17 @@
 #include "Rig3D\Common\Transform.h"
 #include "Memory\Memory\Memory.h"
 #include "Rig3D\Graphics\MeshLibrary.h"
+#include "Rig3D\Graphics\AssetLoader.h"
+#include "Rig3D\Common\ConcurrentLinearAllocator.h"
 #include "Rig3D/TaskDispatch/TaskDispatcher.h"
+#include "Rig3D/Occlusion.h"
+#include "Rig3D/Graphics/ClusteredLighting.h"
+#include "Rig3D/Graphics/Meshlet.h"
+#include "Rig3D/Geometry.h"
 #include <d3d11.h>
 #include <d3dcompiler.h>
 #include <random>
+#include <assert.h>
 #include <ctime>
 
 #define SATURATE_RANDOM				FLT_EPSILON + (float)(rand()) / ((float)(RAND_MAX / (1.0f - FLT_EPSILON)))
@@ -25,6 +32,14 @@
 #define MESH_COUNT					5
 #define POINT_LIGHT_SCALE			0.2f
 #define POINT_LIGHT_VOLUME_SCALE	5.0f
+#define POINT_LIGHT_RADIUS			2.45f			// Attenuation reaches zero here, see LightVolumePixelShader
+#define OCCLUSION_BUFFER_WIDTH		320
+#define OCCLUSION_BUFFER_HEIGHT		240
+#define OCCLUSION_RASTER_RANGES		8
+#define CLUSTER_DIMENSION_X			16
+#define CLUSTER_DIMENSION_Y			12
+#define CLUSTER_DIMENSION_Z			24
+#define CLUSTER_ASSIGN_RANGES		4
 
 using namespace Rig3D;
 
@@ -46,18 +61,7 @@ struct Vertex3
 	vec2f UV;
 };
 
-std::mutex gMemoryMutex;
-
-void PerformModelLoadTask(const cliqCity::multicore::TaskData& data)
-{
-	OBJBasicResource<Vertex3> resource(reinterpret_cast<const char*>(data.mKernelData));
-	MeshLibrary<LinearAllocator>* meshLibrary = reinterpret_cast<MeshLibrary<LinearAllocator>*>(data.mStream.in[0]);
-	TSingleton<IRenderer, DX3D11Renderer>* drawContext = reinterpret_cast<TSingleton<IRenderer, DX3D11Renderer>*>(data.mStream.in[1]);
-	IMesh** mesh = reinterpret_cast<IMesh**>(data.mStream.in[2]);
-
-	std::lock_guard<std::mutex> lock(gMemoryMutex);
-	meshLibrary->LoadMesh(mesh, drawContext, resource);
-}
+typedef AssetRequest<OBJBasicResource<Vertex3>> ModelRequest;
 
 class DeferredLightingScene : public IScene, public virtual IRendererDelegate
 {
@@ -78,9 +82,11 @@ public:
 
 	struct SceneObject
 	{
-		Transform	mTransform;
-		vec4f		mColor;
-		IMesh*		mMesh;
+		Transform		mTransform;
+		vec4f			mColor;
+		IMesh*			mMesh;
+		OccluderMesh*	mOccluder;
+		bool			mIsOccluder;
 	};
 
 	ModelViewProjection				mMVP;
@@ -90,8 +96,28 @@ public:
 	PointLight						mPointLights[MAX_LIGHTS];
 	int								mPointLightCount;
 
-	MeshLibrary<LinearAllocator>	mMeshLibrary;
-	LinearAllocator					mAllocator;
+	MeshLibrary<ConcurrentLinearAllocator>	mMeshLibrary;
+	ConcurrentLinearAllocator			mAllocator;
+
+	cliqCity::multicore::Thread			mThreads[THREAD_COUNT];
+	cliqCity::multicore::TaskDispatcher	mTaskDispatcher;
+
+	OcclusionBuffer					mOcclusionBuffer;
+	OcclusionStatistics				mOcclusionStatistics;
+	OcclusionRasterRange			mOcclusionRanges[OCCLUSION_RASTER_RANGES];
+	OccluderMesh					mTorusOccluder;
+	OccluderMesh					mCylinderOccluder;
+	OccluderMesh					mConeOccluder;
+	OccluderMesh					mHelixOccluder;
+	OccluderMesh					mSphereOccluder;
+	OccluderMesh					mPlaneOccluder;
+	bool							mSceneObjectVisible[5];
+	bool							mPointLightVisible[MAX_LIGHTS];
+	bool							mPointLightVolumeVisible[MAX_LIGHTS];
+
+	ClusterGrid						mClusterGrid;
+	ClusterAssignRange				mClusterRanges[CLUSTER_ASSIGN_RANGES];
+	ClusteredLight					mClusteredLights[MAX_LIGHTS];
 	
 	TSingleton<IRenderer, DX3D11Renderer>*	mRenderer;
 	IMesh*							mTorusMesh;
@@ -152,6 +178,7 @@ public:
 	DeferredLightingScene() : 
 		mPointLightCount(MIN_LIGHTS),
 		mAllocator(gMemory, gMemory + 10240),
+		mTaskDispatcher(mThreads, THREAD_COUNT, gTaskMemory, 1024),
 		mRenderer(nullptr),
 		mTorusMesh(nullptr),
 		mCylinderMesh(nullptr),
@@ -251,11 +278,15 @@ public:
 		mDevice = mRenderer->GetDevice();
 		mDeviceContext = mRenderer->GetDeviceContext();
 
+		mTaskDispatcher.Start();
+
 		InitializeGeometry();
 		InitializeLighting();
 		InitializeSceneObjects();
 		InitializeShaders();
 		InitializeShaderResources();
+
+		InitializeOcclusionBuffer(mOcclusionBuffer, OCCLUSION_BUFFER_WIDTH, OCCLUSION_BUFFER_HEIGHT);
 	}
 
 	void VUpdate(double milliseconds) override
@@ -282,6 +313,25 @@ public:
 		}
 
 		t += static_cast<float>(milliseconds / 1000.0f);
+
+		UpdateLightClusters();
+	}
+
+	// Builds the per cluster light lists for the active lights. The light volume pass does not consume
+	// them yet; the cluster, index and light buffers are laid out for upload as structured buffers.
+	void UpdateLightClusters()
+	{
+		for (int i = 0; i < mPointLightCount; i++)
+		{
+			mClusteredLights[i].position = mPointLights[i].Position;
+			mClusteredLights[i].radius = POINT_LIGHT_RADIUS;
+			mClusteredLights[i].color = mPointLights[i].Color;
+		}
+
+		// View is stored transposed for the shaders.
+		AssignLightsParallel(mTaskDispatcher, mClusterGrid, mClusteredLights, mPointLightCount, mMVP.View.transpose(), mClusterRanges, CLUSTER_ASSIGN_RANGES);
+
+		assert(ValidateLightClusters(mClusterGrid));
 	}
 
 	void HandleInput()
@@ -300,9 +350,53 @@ public:
 		}
 	}
 
+	// Rasterizes the occluders on the CPU and tests every scene object and light against them
+	// before anything is submitted.
+	void UpdateOcclusion()
+	{
+		mat4f viewProjection = (mMVP.Projection * mMVP.View).transpose();
+
+		mOcclusionStatistics.Reset();
+		ClearOcclusionBuffer(mOcclusionBuffer);
+
+		for (int i = 0; i < 5; i++)
+		{
+			if (mSceneObjects[i].mIsOccluder)
+			{
+				AddOccluder(mOcclusionBuffer, *mSceneObjects[i].mOccluder, mSceneObjects[i].mTransform.GetWorldMatrix() * viewProjection, &mOcclusionStatistics);
+			}
+		}
+
+		RasterizeOccludersParallel(mTaskDispatcher, mOcclusionBuffer, mOcclusionRanges, OCCLUSION_RASTER_RANGES);
+
+		for (int i = 0; i < 5; i++)
+		{
+			mSceneObjectVisible[i] = !IsOccluded(mOcclusionBuffer, mSceneObjects[i].mOccluder->bounds, mSceneObjects[i].mTransform.GetWorldMatrix() * viewProjection, &mOcclusionStatistics);
+		}
+
+		// Light world matrices are stored transposed for the shaders.
+		for (int i = 0; i < mPointLightCount; i++)
+		{
+			mPointLightVisible[i] = !IsOccluded(mOcclusionBuffer, mSphereOccluder.bounds, mPointLightWorldMatrices[i].transpose() * viewProjection, &mOcclusionStatistics);
+			mPointLightVolumeVisible[i] = !IsOccluded(mOcclusionBuffer, mSphereOccluder.bounds, mPointLightVolumeWorldMatrices[i].transpose() * viewProjection, &mOcclusionStatistics);
+		}
+	}
+
+	void UpdateWindowCaption()
+	{
+		char caption[256];
+		sprintf_s(caption, "Deferred Lighting Sample Occluded %u/%u Occluder Triangles %u Clustered Lights %u Light Indices %u Max Per Cluster %u",
+			mOcclusionStatistics.occluded, mOcclusionStatistics.tested, mOcclusionStatistics.binnedTriangles,
+			mClusterGrid.statistics.visibleLights, mClusterGrid.statistics.lightIndices, mClusterGrid.statistics.maxLightsPerCluster);
+		mRenderer->SetWindowCaption(caption);
+	}
+
 	void VRender() override
 	{
 		const float color[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+
+		UpdateOcclusion();
+
 		mRenderer->VSetPrimitiveType(GPU_PRIMITIVE_TYPE_TRIANGLE);
 		
 		// G-Buffer Pass
@@ -327,6 +421,11 @@ public:
 
 			for (int i = 0; i < 5; i++)
 			{
+				if (!mSceneObjectVisible[i])
+				{
+					continue;
+				}
+
 				mMVP.Model = mSceneObjects[i].mTransform.GetWorldMatrix().transpose();
 				mDeviceContext->UpdateSubresource(mMVPBuffer, 0, nullptr, &mMVP, 0, 0);
 				mDeviceContext->UpdateSubresource(mColorBuffer, 0, nullptr, &mSceneObjects[i].mColor, 0, 0);
@@ -357,6 +456,11 @@ public:
 			mRenderer->VBindMesh(mSphereMesh);
 			for (int i = 0; i < mPointLightCount; i++)
 			{
+				if (!mPointLightVolumeVisible[i])
+				{
+					continue;
+				}
+
 				mMVP.Model = mPointLightVolumeWorldMatrices[i];
 				mDeviceContext->UpdateSubresource(mMVPBuffer, 0, nullptr, &mMVP, 0, 0);
 				mDeviceContext->UpdateSubresource(mLightBuffer, 0, nullptr, &mPointLights[i], 0, 0);
@@ -398,6 +502,11 @@ public:
 			mRenderer->VBindMesh(mSphereMesh);
 			for (int i = 0; i < mPointLightCount; i++)
 			{
+				if (!mPointLightVisible[i])
+				{
+					continue;
+				}
+
 				mMVP.Model = mPointLightWorldMatrices[i];
 				mDeviceContext->UpdateSubresource(mMVPBuffer, 0, nullptr, &mMVP, 0, 0);
 				mDeviceContext->UpdateSubresource(mColorBuffer, 0, nullptr, &mPointLights[i].Color, 0, 0);
@@ -436,6 +545,8 @@ public:
 		}
 
 		mRenderer->VSwapBuffers();
+
+		UpdateWindowCaption();
 	}
 
 	void VShutdown() override
@@ -673,15 +784,32 @@ public:
 		{
 			mMVP.View = mat4f::lookAtLH(mSceneObjects[4].mTransform.GetPosition() - vec3f(0.0f, 0.0f, 5.0f), vec3f(0.0f, 20.0f, -20.0f), vec3f(0.0f, 1.0f, 0.0f)).transpose();
 			mMVP.Projection = mat4f::normalizedPerspectiveLH(0.25f * PI, mRenderer->GetAspectRatio(), 0.1f, 100.0f).transpose();
+
+			InitializeClusterGrid(mClusterGrid, CLUSTER_DIMENSION_X, CLUSTER_DIMENSION_Y, CLUSTER_DIMENSION_Z, 0.25f * PI, mRenderer->GetAspectRatio(), 0.1f, 100.0f);
 		}
 	}
 
+	// A model that failed to load, or loaded without triangles, is replaced by a sphere so the scene and light
+	// passes still have a mesh. The occluder keeps a CPU copy of the positions for occlusion culling.
+	void InitializeModel(IMesh** mesh, OccluderMesh& occluder, OBJBasicResource<Vertex3>& resource, bool loaded)
+	{
+		if (!loaded || resource.mVertices.empty() || resource.mIndices.empty())
+		{
+			char message[256];
+			sprintf_s(message, "Deferred Lighting Sample: failed to load %s\n", resource.mFilename);
+			OutputDebugStringA(message);
+
+			Geometry::Sphere(resource.mVertices, resource.mIndices, 16, 16, 1.0f);
+			mMeshLibrary.UploadMesh(mesh, mRenderer, resource);
+		}
+
+		InitializeOccluderMesh(occluder, &resource.mVertices[0], static_cast<uint32_t>(resource.mVertices.size()), &resource.mIndices[0], static_cast<uint32_t>(resource.mIndices.size()));
+	}
+
 	void InitializeGeometry()
 	{
 #ifdef MULTITHREAD
-		cliqCity::multicore::Thread threads[THREAD_COUNT];
-		cliqCity::multicore::TaskData modelData[MESH_COUNT];
-		char* fileNames[MESH_COUNT] = {
+		const char* fileNames[MESH_COUNT] = {
 			"Models\\torus.obj",
 			"Models\\cylinder.obj",
 			"Models\\cone.obj",
@@ -697,18 +825,66 @@ public:
 			&mSphereMesh
 		};
 
-		cliqCity::multicore::TaskID taskIDs[MESH_COUNT];
+		OccluderMesh* occluders[MESH_COUNT] = {
+			&mTorusOccluder,
+			&mCylinderOccluder,
+			&mConeOccluder,
+			&mHelixOccluder,
+			&mSphereOccluder
+		};
+
+		// Workers parse into the requests; this thread uploads each mesh as soon as its parse finishes. Every request
+		// in flight holds a dispatcher task, so the loader is capped at MESH_COUNT and the task pool must hold them.
+		static_assert(MESH_COUNT * sizeof(cliqCity::multicore::Task) <= sizeof(gTaskMemory), "gTaskMemory cannot hold a task per model");
+		AssetLoader<OBJBasicResource<Vertex3>, MESH_COUNT> loader(&mTaskDispatcher);
+		ModelRequest requests[MESH_COUNT];
 
-		cliqCity::multicore::TaskDispatcher dispatchQueue(threads, THREAD_COUNT, gTaskMemory, 1024);
-		dispatchQueue.Start();
 		for (int i = 0; i < MESH_COUNT; i++)
 		{
-			modelData[i].mKernelData = fileNames[i];
-			modelData[i].mStream.in[0] = &mMeshLibrary;
-			modelData[i].mStream.in[1] = mRenderer;
-			modelData[i].mStream.in[2] = meshes[i];
-			taskIDs[i] = dispatchQueue.AddTask(modelData[i], PerformModelLoadTask);
+			requests[i].resource.mFilename = fileNames[i];
+			requests[i].mesh = meshes[i];
+			requests[i].userData = occluders[i];
+			loader.Load(&requests[i]);
 		}
+
+#if defined(DEBUG) || defined(_DEBUG)
+		// Every request, including one Load turned away, must come back from the completion queue exactly once.
+		uint32_t returnCounts[MESH_COUNT] = {};
+#endif
+
+		ModelRequest* completed[MESH_COUNT];
+		while (loader.GetPendingCount() > 0)
+		{
+			uint32_t count = loader.Upload(mMeshLibrary, mRenderer, completed, MESH_COUNT);
+			for (uint32_t i = 0; i < count; i++)
+			{
+				OBJBasicResource<Vertex3>& resource = completed[i]->resource;
+#if defined(DEBUG) || defined(_DEBUG)
+				assert(completed[i] >= requests && completed[i] < requests + MESH_COUNT);
+				returnCounts[completed[i] - requests]++;
+#endif
+				InitializeModel(completed[i]->mesh, *reinterpret_cast<OccluderMesh*>(completed[i]->userData), resource, completed[i]->loaded);
+
+#if defined(DEBUG) || defined(_DEBUG)
+				// Check the meshlet builder and its normal cones against real content.
+				MeshletMesh meshlets;
+				BuildMeshlets(meshlets, &resource.mVertices[0], static_cast<uint32_t>(resource.mVertices.size()), &resource.mIndices[0], static_cast<uint32_t>(resource.mIndices.size()));
+				assert(ValidateMeshlets(meshlets, &resource.mVertices[0], &resource.mIndices[0], static_cast<uint32_t>(resource.mIndices.size())));
+#endif
+			}
+
+			if (count == 0)
+			{
+				std::this_thread::yield();
+			}
+		}
+
+#if defined(DEBUG) || defined(_DEBUG)
+		for (int i = 0; i < MESH_COUNT; i++)
+		{
+			assert(returnCounts[i] == 1 && *requests[i].mesh != nullptr);
+		}
+#endif
 #else
 		OBJBasicResource<Vertex3> torusResource("Models\\torus.obj");
 		OBJBasicResource<Vertex3> cylinderResource("Models\\cylinder.obj");
@@ -716,11 +892,11 @@ public:
 		OBJBasicResource<Vertex3> cubeResource("Models\\cube.obj");
 		OBJBasicResource<Vertex3> sphereResource("Models\\sphere.obj");
 
-		mMeshLibrary.LoadMesh(&mTorusMesh, mRenderer, torusResource);
-		mMeshLibrary.LoadMesh(&mCylinderMesh, mRenderer, cylinderResource);
-		mMeshLibrary.LoadMesh(&mConeMesh, mRenderer, coneResource);
-		mMeshLibrary.LoadMesh(&mHelixMesh, mRenderer, cubeResource);
-		mMeshLibrary.LoadMesh(&mSphereMesh, mRenderer, sphereResource);
+		InitializeModel(&mTorusMesh, mTorusOccluder, torusResource, mMeshLibrary.LoadMesh(&mTorusMesh, mRenderer, torusResource));
+		InitializeModel(&mCylinderMesh, mCylinderOccluder, cylinderResource, mMeshLibrary.LoadMesh(&mCylinderMesh, mRenderer, cylinderResource));
+		InitializeModel(&mConeMesh, mConeOccluder, coneResource, mMeshLibrary.LoadMesh(&mConeMesh, mRenderer, coneResource));
+		InitializeModel(&mHelixMesh, mHelixOccluder, cubeResource, mMeshLibrary.LoadMesh(&mHelixMesh, mRenderer, cubeResource));
+		InitializeModel(&mSphereMesh, mSphereOccluder, sphereResource, mMeshLibrary.LoadMesh(&mSphereMesh, mRenderer, sphereResource));
 #endif
 	
 		Vertex3 planeVertices[9];
@@ -741,6 +917,8 @@ public:
 		mRenderer->VSetMeshVertexBuffer(mPlaneMesh, planeVertices, sizeof(Vertex3) * 9, sizeof(Vertex3));
 		mRenderer->VSetMeshIndexBuffer(mPlaneMesh, planeIndices, 24);
 
+		InitializeOccluderMesh(mPlaneOccluder, planeVertices, 9, planeIndices, 24);
+
 		Vertex2 quadVertices[4];
 		quadVertices[0].Position = { -1.0f, 1.0f, 0.0f };
 		quadVertices[0].UV = { 0.0f, 0.0f };
@@ -802,23 +980,33 @@ public:
 		mSceneObjects[0].mTransform.SetPosition(-2.2f, 0.0f, 3.0f);
 		mSceneObjects[0].mColor = color;// { 1.0f, 1.0f, 0.0f, 1.0f };
 		mSceneObjects[0].mMesh = mTorusMesh;
+		mSceneObjects[0].mOccluder = &mTorusOccluder;
+		mSceneObjects[0].mIsOccluder = true;
 
 		mSceneObjects[1].mTransform.SetPosition(3.9f, -0.1f, 1.5f );
 		mSceneObjects[1].mColor = color; // { 1.0f, 0.0f, 1.0f, 1.0f };
 		mSceneObjects[1].mMesh = mCylinderMesh;
+		mSceneObjects[1].mOccluder = &mCylinderOccluder;
+		mSceneObjects[1].mIsOccluder = true;
 
 		mSceneObjects[2].mTransform.SetPosition(3.7f, 0.0f, -3.0f );
 		mSceneObjects[2].mColor = color;// { 0.0f, 1.0f, 1.0f, 1.0f };
 		mSceneObjects[2].mMesh = mHelixMesh;
+		mSceneObjects[2].mOccluder = &mHelixOccluder;
+		mSceneObjects[2].mIsOccluder = true;
 
 		mSceneObjects[3].mTransform.SetPosition(-3.5f, 0.0f, -2.0f );
 		mSceneObjects[3].mColor = color; //{ 1.0f, 0.0f, 0.0f, 1.0f };
 		mSceneObjects[3].mMesh = mConeMesh;
+		mSceneObjects[3].mOccluder = &mConeOccluder;
+		mSceneObjects[3].mIsOccluder = true;
 
 		mSceneObjects[4].mTransform.SetPosition(0.0f, -0.6f, 0.0f );
 		mSceneObjects[4].mTransform.SetScale(vec3f(30.0f, 1.0f, 20.0f));
 		mSceneObjects[4].mColor = { 0.5f, 0.5f, 0.5f, 1.0f };
 		mSceneObjects[4].mMesh = mPlaneMesh;
+		mSceneObjects[4].mOccluder = &mPlaneOccluder;
+		mSceneObjects[4].mIsOccluder = false;	// Nothing in the scene is below the floor
 	}
 
 	void InitializeShaders()
@@ -1,45 +1,241 @@
 // References: http://www.gamedev.net/page/resources/_/technical/game-programming/bvh-file-loading-and-displaying-r3295
 
 #include "BVHResource.h"
-#include <string>
-#include <fstream>
-#include "StringTrim.h"
-#include <sstream>
-
-static const std::string BVHKeyHierarchy	("HIERARCHY");
-static const std::string BVHKeyRoot			("ROOT");
-static const std::string BVHKeyOffset		("OFFSET");
-static const std::string BVHKeyChannels		("CHANNELS");
-static const std::string BVHKeyJoint		("JOINT");
-static const std::string BVHKeyMotion		("MOTION");
-static const std::string BVHKeyPositionX	("Xposition");
-static const std::string BVHKeyPositionY	("Yposition");
-static const std::string BVHKeyPositionZ	("Zposition");
-static const std::string BVHKeyRotationX	("Xrotation");
-static const std::string BVHKeyRotationY	("Yrotation");
-static const std::string BVHKeyRotationZ	("Zrotation");
-static const std::string BVHKeyEndSite		("End");
-static const std::string BVHKeyFrameCount	("Frames:");
-static const std::string BVHKeyFrame        ("Frame");
-
-static const uint16_t DOF_POSITION_X = 0x01;
-static const uint16_t DOF_POSITION_Y = 0x02;
-static const uint16_t DOF_POSITION_Z = 0x04;
-static const uint16_t DOF_ROTATION_X = 0x10;
-static const uint16_t DOF_ROTATION_Y = 0x20;
-static const uint16_t DOF_ROTATION_Z = 0x40;
+#include "Rig3D\Common\MemoryMappedFile.h"
+#include "Rig3D\Graphics\OBJParser.h"
+#include "Rig3D\TaskDispatch\TaskDispatcher.h"
+#include <string.h>
+
+using namespace Rig3D;
+using namespace cliqCity::multicore;
 
 static const char BVHBeginElement	= '{';
 static const char BVHEndElement		= '}';
 
-BVHResource::BVHResource(const char* filename) : mFilename(filename)
+// Current token, pointing into the mapped file.
+struct BVHTokenizer
+{
+	const char*	p;
+	const char*	end;
+	const char*	token;
+	uint32_t	length;
+};
+
+// A run of whole frame lines in the MOTION block.
+struct BVHChunk
+{
+	const char*	begin;
+	const char*	end;
+	float*		data;
+	uint32_t	channelCount;
+	uint32_t	firstFrame;
+	uint32_t	frameCount;		// Frame lines in the chunk, found by the count pass
+	uint32_t	frameLimit;		// Frames declared in the header; lines past it are ignored
+	bool		valid;
+	TaskID		taskID;
+};
+
+#pragma region Tokenizer
+
+static inline bool IsBVHSpace(const char& c)
+{
+	return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+static inline const char* SkipBVHSpace(const char* p, const char* end)
+{
+	while (p < end && IsBVHSpace(*p))
+	{
+		p++;
+	}
+
+	return p;
+}
+
+static bool NextBVHToken(BVHTokenizer& tokenizer)
+{
+	const char* p = SkipBVHSpace(tokenizer.p, tokenizer.end);
+
+	tokenizer.token = p;
+	while (p < tokenizer.end && !IsBVHSpace(*p))
+	{
+		p++;
+	}
+
+	tokenizer.length = static_cast<uint32_t>(p - tokenizer.token);
+	tokenizer.p = p;
+	return tokenizer.length != 0;
+}
+
+template<size_t N>
+static inline bool IsBVHToken(const BVHTokenizer& tokenizer, const char (&keyword)[N])
+{
+	return tokenizer.length == N - 1 && memcmp(tokenizer.token, keyword, N - 1) == 0;
+}
+
+template<size_t N>
+static inline bool ExpectBVHToken(BVHTokenizer& tokenizer, const char (&keyword)[N])
+{
+	return NextBVHToken(tokenizer) && IsBVHToken(tokenizer, keyword);
+}
+
+// Numbers must be followed by white space, so "1.0x" is rejected rather than split.
+static bool ReadBVHFloat(BVHTokenizer& tokenizer, float& value)
+{
+	const char* p = SkipBVHSpace(tokenizer.p, tokenizer.end);
+	if (!ParseOBJFloat(p, tokenizer.end, value) || (p < tokenizer.end && !IsBVHSpace(*p)))
+	{
+		return false;
+	}
+
+	tokenizer.p = p;
+	return true;
+}
+
+static bool ReadBVHInteger(BVHTokenizer& tokenizer, uint32_t& value)
+{
+	const char* p = SkipBVHSpace(tokenizer.p, tokenizer.end);
+
+	int64_t integer;
+	if (!ParseOBJInteger(p, tokenizer.end, integer) || integer < 0 || integer > UINT32_MAX || (p < tokenizer.end && !IsBVHSpace(*p)))
+	{
+		return false;
+	}
+
+	value = static_cast<uint32_t>(integer);
+	tokenizer.p = p;
+	return true;
+}
+
+// Rest of the line with surrounding white space removed; joint names may contain spaces.
+static void ReadBVHLine(BVHTokenizer& tokenizer, std::string& line)
+{
+	const char* begin = SkipOBJSpace(tokenizer.p, tokenizer.end);
+	const char* end = static_cast<const char*>(memchr(begin, '\n', tokenizer.end - begin));
+	end = end ? end : tokenizer.end;
+	tokenizer.p = end;
+
+	while (end > begin && IsBVHSpace(end[-1]))
+	{
+		end--;
+	}
+
+	line.assign(begin, end);
+}
+
+static uint16_t GetBVHChannel(const BVHTokenizer& tokenizer)
 {
+	if (tokenizer.length != 9 || (memcmp(tokenizer.token + 1, "position", 8) != 0 && memcmp(tokenizer.token + 1, "rotation", 8) != 0))
+	{
+		return 0;
+	}
+
+	uint16_t axis = 0;
+	switch (tokenizer.token[0])
+	{
+	case 'X': axis = DOF_POSITION_X; break;
+	case 'Y': axis = DOF_POSITION_Y; break;
+	case 'Z': axis = DOF_POSITION_Z; break;
+	default: return 0;
+	}
+
+	// Rotation flags are the position flags shifted up a nibble
+	return (tokenizer.token[1] == 'r') ? axis << 4 : axis;
+}
+
+#pragma endregion
+
+#pragma region Motion
+
+// Frame lines are the non blank lines of the block.
+static void CountBVHFrames(BVHChunk& chunk)
+{
+	uint32_t count = 0;
+	for (const char* p = SkipBVHSpace(chunk.begin, chunk.end); p < chunk.end; p = SkipBVHSpace(SkipOBJLine(p, chunk.end), chunk.end))
+	{
+		count++;
+	}
+
+	chunk.frameCount = count;
+}
+
+// Each frame line holds exactly channelCount values, converted in place into the frame's slot of the motion data.
+static void ParseBVHFrames(BVHChunk& chunk)
+{
+	uint32_t frameCount = (chunk.firstFrame < chunk.frameLimit) ? (std::min)(chunk.frameCount, chunk.frameLimit - chunk.firstFrame) : 0;
+	float* values = chunk.data + static_cast<size_t>(chunk.firstFrame) * chunk.channelCount;
+
+	const char* p = chunk.begin;
+	for (uint32_t frame = 0; frame < frameCount; frame++, values += chunk.channelCount)
+	{
+		p = SkipBVHSpace(p, chunk.end);
+		if (ParseOBJFloats(p, chunk.end, values, chunk.channelCount) != chunk.channelCount)
+		{
+			chunk.valid = false;
+			return;
+		}
+
+		p = SkipOBJSpace(p, chunk.end);
+		if (p < chunk.end && *p != '\r' && *p != '\n')
+		{
+			chunk.valid = false;
+			return;
+		}
+	}
+
+	chunk.valid = true;
+}
+
+static void PerformBVHCountTask(const TaskData& data)
+{
+	CountBVHFrames(*reinterpret_cast<BVHChunk*>(data.mKernelData));
+}
+
+static void PerformBVHParseTask(const TaskData& data)
+{
+	ParseBVHFrames(*reinterpret_cast<BVHChunk*>(data.mKernelData));
+}
+
+static void RunBVHChunks(std::vector<BVHChunk>& chunks, TaskDispatcher* dispatcher, TaskKernel kernel)
+{
+	TaskData taskData;
+	if (!dispatcher || chunks.size() == 1)
+	{
+		for (BVHChunk& chunk : chunks)
+		{
+			taskData.mKernelData = &chunk;
+			kernel(taskData);
+		}
+
+		return;
+	}
+
+	for (BVHChunk& chunk : chunks)
+	{
+		taskData.mKernelData = &chunk;
+		chunk.taskID = dispatcher->AddTask(taskData, kernel);
+	}
+
+	for (BVHChunk& chunk : chunks)
+	{
+		dispatcher->WaitForTask(chunk.taskID);
+	}
+}
 
+#pragma endregion
+
+BVHResource::BVHResource(const char* filename) : mFilename(filename)
+{
+	mHierarchy.ChannelCount = 0;
+	mMotion.FrameCount		= 0;
+	mMotion.ChannelCount	= 0;
+	mMotion.FrameTime		= 0.0f;
+	mMotion.Data			= nullptr;
 }
 
 BVHResource::BVHResource() : BVHResource(nullptr)
 {
-	
+
 }
 
 BVHResource::~BVHResource()
@@ -48,193 +244,218 @@ BVHResource::~BVHResource()
 	delete[] mMotion.Data;
 }
 
-int BVHResource::Load()
+int BVHResource::Load(TaskDispatcher* dispatcher)
 {
-	std::fstream file(mFilename);
+	MemoryMappedFile file;
 
-	if (!file.is_open())
+	if (!mFilename || !file.Open(mFilename))
 	{
 		return -1;
 	}
 
-	std::string line;
+	DeleteJoint(&mHierarchy.Root);
+	delete[] mMotion.Data;
+
+	mHierarchy.Root			= BVHJoint();
+	mHierarchy.ChannelCount	= 0;
+	mHierarchy.JointCount	= 1;
+	mMotion.FrameCount		= 0;
+	mMotion.ChannelCount	= 0;
+	mMotion.FrameTime		= 0.0f;
+	mMotion.Data			= nullptr;
 
-	file >> line;
+	BVHTokenizer tokenizer = { file.GetData(), file.GetData() + file.GetSize(), nullptr, 0 };
 
-	if (Trim(line) == BVHKeyHierarchy)
+	if (!ExpectBVHToken(tokenizer, "HIERARCHY") || !LoadHeirachy(tokenizer) || !LoadMotion(tokenizer, dispatcher))
 	{
-		LoadHeirachy(file);
+		return -1;
 	}
 
-	file.close();
-
 	return 1;
 }
 
-void BVHResource::LoadJoint(std::fstream& file, BVHJoint* joint, BVHJoint* parent)
+bool BVHResource::LoadJoint(BVHTokenizer& tokenizer, BVHJoint* joint, BVHJoint* parent)
 {
-	if (parent) 
-	{
-		joint->Parent = parent;
-	}
+	joint->Parent			= parent;
+	joint->Offset[0]		= 0.0f;
+	joint->Offset[1]		= 0.0f;
+	joint->Offset[2]		= 0.0f;
+	joint->ChannelOffset	= mMotion.ChannelCount;
+	joint->ChannelCount		= 0;
 
 	// Joint name.
-	file >> joint->Name;
-
-	std::string line;
+	ReadBVHLine(tokenizer, joint->Name);
 
-	static int	channelStart	= 0;
-	uint32_t channelOrderIndex	= 0;
-
-	while (file.good())
+	if (!NextBVHToken(tokenizer) || tokenizer.length != 1 || *tokenizer.token != BVHBeginElement)
 	{
-		file >> line;
+		return false;
+	}
 
-		line = Trim(line);
-	
-		char c = line.at(0);
-		if (c == 'X' || c == 'Y' || c == 'Z')
+	while (NextBVHToken(tokenizer))
+	{
+		if (IsBVHToken(tokenizer, "OFFSET"))
 		{
-			if (line == BVHKeyPositionX)
-			{
-				joint->ChannelOrder.push_back(DOF_POSITION_X);
-			}
-			else if (line == BVHKeyPositionY)
-			{
-				joint->ChannelOrder.push_back(DOF_POSITION_Y);
-			}
-			else if (line == BVHKeyPositionZ)
-			{
-				joint->ChannelOrder.push_back(DOF_POSITION_Z);
-			}
-			else if (line == BVHKeyRotationX)
-			{
-				joint->ChannelOrder.push_back(DOF_ROTATION_X);
-			}
-			else if (line == BVHKeyRotationY)
+			if (!ReadBVHFloat(tokenizer, joint->Offset[0]) || !ReadBVHFloat(tokenizer, joint->Offset[1]) || !ReadBVHFloat(tokenizer, joint->Offset[2]))
 			{
-				joint->ChannelOrder.push_back(DOF_ROTATION_Y);
+				return false;
 			}
-			else if (line == BVHKeyRotationZ)
+		}
+		else if (IsBVHToken(tokenizer, "CHANNELS"))
+		{
+			if (!ReadBVHInteger(tokenizer, joint->ChannelCount))
 			{
-				joint->ChannelOrder.push_back(DOF_ROTATION_Z);
+				return false;
 			}
-		}
 
-		if (line == BVHKeyOffset)
-		{
-			file >> joint->Offset[0] >> joint->Offset[1] >> joint->Offset[2];
-		}
-		else if (line == BVHKeyChannels)
-		{
-			file >> joint->ChannelCount;
-		
+			joint->ChannelOffset = mMotion.ChannelCount;
 			mMotion.ChannelCount += joint->ChannelCount;
 
-			joint->ChannelOffset = channelStart;
-			channelStart += joint->ChannelCount;
-
-			// set up channel order storage for next read	
-			joint->ChannelOrder.reserve(joint->ChannelCount);
+			joint->ChannelOrder.resize(joint->ChannelCount);
+			for (uint32_t i = 0; i < joint->ChannelCount; i++)
+			{
+				if (!NextBVHToken(tokenizer) || (joint->ChannelOrder[i] = GetBVHChannel(tokenizer)) == 0)
+				{
+					return false;
+				}
+			}
 		}
-		else if (line == BVHKeyJoint)
+		else if (IsBVHToken(tokenizer, "JOINT"))
 		{
 			// Recursively define children
 			joint->Children.push_back(BVHJoint());
-
-			LoadJoint(file, &joint->Children.back(), joint);
-
 			mHierarchy.JointCount++;
+
+			if (!LoadJoint(tokenizer, &joint->Children.back(), joint))
+			{
+				return false;
+			}
 		}
-		else if (line == BVHKeyEndSite)
+		else if (IsBVHToken(tokenizer, "End"))
 		{
-			file >> line >> line;
-
 			joint->Children.push_back(BVHJoint());
+			mHierarchy.JointCount++;
 
 			BVHJoint* leafJoint = &joint->Children.back();
-			leafJoint->Parent = joint;
-			leafJoint->ChannelCount = 0;
-			leafJoint->Name = "End Site";
-			
-			file >> line;
-			if (line == BVHKeyOffset)
+			leafJoint->Parent			= joint;
+			leafJoint->ChannelOffset	= mMotion.ChannelCount;
+			leafJoint->ChannelCount		= 0;
+			leafJoint->Name				= "End Site";
+
+			if (!ExpectBVHToken(tokenizer, "Site") || !ExpectBVHToken(tokenizer, "{") || !ExpectBVHToken(tokenizer, "OFFSET") ||
+				!ReadBVHFloat(tokenizer, leafJoint->Offset[0]) || !ReadBVHFloat(tokenizer, leafJoint->Offset[1]) || !ReadBVHFloat(tokenizer, leafJoint->Offset[2]) ||
+				!ExpectBVHToken(tokenizer, "}"))
 			{
-				file >> leafJoint->Offset[0] >> leafJoint->Offset[1] >> leafJoint->Offset[2];
+				return false;
 			}
-
-			file >> line;
-
-			mHierarchy.JointCount++;
 		}
-		else if (line == "}")
+		else if (tokenizer.length == 1 && *tokenizer.token == BVHEndElement)
+		{
+			return true;
+		}
+		else
 		{
-			break;
+			return false;
 		}
 	}
+
+	return false;
 }
 
-int	BVHResource::LoadHeirachy(std::fstream& file)
+bool BVHResource::LoadHeirachy(BVHTokenizer& tokenizer)
 {
-	std::string line;
-
-	while (file.good())
+	if (!ExpectBVHToken(tokenizer, "ROOT") || !LoadJoint(tokenizer, &mHierarchy.Root))
 	{
-		file >> line;
-
-		if (Trim(line) == BVHKeyRoot)
-		{
-			LoadJoint(file, &mHierarchy.Root);
-		}
-		else if (Trim(line) == BVHKeyMotion)
-		{
-			LoadMotion(file);
-		}
+		return false;
 	}
 
-	return 1;
+	mHierarchy.ChannelCount = mMotion.ChannelCount;
+
+	// Children were appended to vectors while their own children were loaded, so parent pointers taken along the
+	// way may have moved. Link them again now that the tree is final.
+	LinkJoint(&mHierarchy.Root, nullptr);
+
+	return true;
 }
 
-int	BVHResource::LoadMotion(std::fstream& file)
+bool BVHResource::LoadMotion(BVHTokenizer& tokenizer, TaskDispatcher* dispatcher)
 {
-	std::string line;
+	// MOTION
+	// Frames: <count>
+	// Frame Time: <seconds>
+	if (!ExpectBVHToken(tokenizer, "MOTION") ||
+		!ExpectBVHToken(tokenizer, "Frames:") || !ReadBVHInteger(tokenizer, mMotion.FrameCount) ||
+		!ExpectBVHToken(tokenizer, "Frame") || !ExpectBVHToken(tokenizer, "Time:") || !ReadBVHFloat(tokenizer, mMotion.FrameTime))
+	{
+		return false;
+	}
 
-	while(file.good())
+	const char* text	= tokenizer.p;
+	const char* end		= tokenizer.end;
+	size_t		size	= end - text;
+
+	// Every value takes at least a digit and a separator, so counts the remaining text cannot hold are malformed
+	// and rejected before they size the allocation. Dividing keeps the check free of overflow.
+	if (mMotion.ChannelCount == 0 || mMotion.FrameCount > size / 2 / mMotion.ChannelCount)
 	{
-		file >> line;
+		return false;
+	}
 
-		line = Trim(line);
+	mMotion.Data = new float[static_cast<size_t>(mMotion.FrameCount) * mMotion.ChannelCount];
 
-		if (line == BVHKeyFrameCount)
-		{
-			file >> mMotion.FrameCount;
-		}
-		else if (line == BVHKeyFrame)
-		{
-			file >> line >> mMotion.FrameTime;	// Frame Time: 
-
-			int frameCount		= mMotion.FrameCount;
-			int channelCount	= mMotion.ChannelCount;
-		
-			mMotion.Data = new float[frameCount * channelCount];
-			
-			for (int frame = 0; frame < frameCount; frame++)
-			{
-				for (int channel = 0; channel < channelCount; channel++)
-				{
-					float x;
-					std::stringstream ss;
-					file >> line;
-					ss << line;
-					ss >> x;
+	size_t chunkCount = dispatcher ? (std::max<size_t>)(1, (std::min<size_t>)(size / BVH_MIN_CHUNK_SIZE, BVH_MAX_CHUNKS)) : 1;
+	std::vector<BVHChunk> chunks(chunkCount);
 
-					mMotion.Data[frame * channelCount + channel] = x;
-				}
-			}
+	const char* begin = text;
+	for (size_t i = 0; i < chunkCount; i++)
+	{
+		const char* split = (i + 1 == chunkCount) ? end : (std::max)(begin, text + size / chunkCount * (i + 1));
+
+		BVHChunk& chunk		= chunks[i];
+		chunk.begin			= begin;
+		chunk.end			= (split < end) ? SkipOBJLine(split, end) : end;
+		chunk.data			= mMotion.Data;
+		chunk.channelCount	= mMotion.ChannelCount;
+		chunk.frameLimit	= mMotion.FrameCount;
+		chunk.valid			= false;
+		begin				= chunk.end;
+	}
+
+	// Frame lines are counted first so every chunk knows which frame it starts at, then all chunks parse at once
+	RunBVHChunks(chunks, dispatcher, PerformBVHCountTask);
+
+	uint32_t frameCount = 0;
+	for (BVHChunk& chunk : chunks)
+	{
+		chunk.firstFrame = frameCount;
+		frameCount += chunk.frameCount;
+	}
+
+	if (frameCount < mMotion.FrameCount)
+	{
+		return false;
+	}
+
+	RunBVHChunks(chunks, dispatcher, PerformBVHParseTask);
+
+	for (const BVHChunk& chunk : chunks)
+	{
+		if (!chunk.valid)
+		{
+			return false;
 		}
 	}
 
-	return 1;
+	return true;
+}
+
+void BVHResource::LinkJoint(BVHJoint* joint, BVHJoint* parent)
+{
+	joint->Parent = parent;
+
+	for (uint32_t i = 0; i < joint->Children.size(); i++)
+	{
+		LinkJoint(&joint->Children[i], joint);
+	}
 }
 
 void BVHResource::DeleteJoint(BVHJoint* joint)
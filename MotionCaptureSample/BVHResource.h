@@ -1,14 +1,25 @@
 #pragma once
 #include <stdint.h>
 #include <vector>
-#include <fstream>
+#include <string>
 
-extern const uint16_t DOF_POSITION_X;
-extern const uint16_t DOF_POSITION_Y;
-extern const uint16_t DOF_POSITION_Z;
-extern const uint16_t DOF_ROTATION_X;
-extern const uint16_t DOF_ROTATION_Y;
-extern const uint16_t DOF_ROTATION_Z;
+#define BVH_MIN_CHUNK_SIZE	(1 << 18)
+#define BVH_MAX_CHUNKS		16
+
+namespace cliqCity
+{
+	namespace multicore
+	{
+		class TaskDispatcher;
+	}
+}
+
+static const uint16_t DOF_POSITION_X = 0x01;
+static const uint16_t DOF_POSITION_Y = 0x02;
+static const uint16_t DOF_POSITION_Z = 0x04;
+static const uint16_t DOF_ROTATION_X = 0x10;
+static const uint16_t DOF_ROTATION_Y = 0x20;
+static const uint16_t DOF_ROTATION_Z = 0x40;
 
 struct BVHJoint
 {
@@ -36,6 +47,11 @@ struct BVHMotion
 	float*		Data;
 };
 
+struct BVHTokenizer;
+
+// Loads a BVH file straight out of a memory mapping. The hierarchy is tokenized in place, without allocating per
+// token. The MOTION block is cut into chunks at line breaks and each chunk converts its frames directly into
+// BVHMotion::Data, on the dispatcher when one is given.
 class BVHResource
 {
 public:
@@ -46,7 +62,8 @@ public:
 	BVHResource();
 	~BVHResource();
 
-	int Load();
+	// Returns 1 on success, -1 when the file cannot be opened or is malformed.
+	int Load(cliqCity::multicore::TaskDispatcher* dispatcher = nullptr);
 
 	inline void SetFilename(const char* filename)
 	{
@@ -56,9 +73,9 @@ public:
 private:
 	const char* mFilename;
 
-	void		LoadJoint(std::fstream& file, BVHJoint* joint, BVHJoint* parent = nullptr);
-	int			LoadHeirachy(std::fstream& file);
-	int			LoadMotion(std::fstream& file);
+	bool		LoadJoint(BVHTokenizer& tokenizer, BVHJoint* joint, BVHJoint* parent = nullptr);
+	bool		LoadHeirachy(BVHTokenizer& tokenizer);
+	bool		LoadMotion(BVHTokenizer& tokenizer, cliqCity::multicore::TaskDispatcher* dispatcher);
+	void		LinkJoint(BVHJoint* joint, BVHJoint* parent);
 	void		DeleteJoint(BVHJoint* joint);
 };
-
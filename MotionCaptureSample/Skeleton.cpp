@@ -0,0 +1,93 @@
+#include "Skeleton.h"
+
+static const float SkeletonRadian = 3.1415926535f / 180.0f;
+
+static void AppendJoint(Skeleton& skeleton, const BVHJoint& joint, const uint32_t& parent)
+{
+	uint32_t index = static_cast<uint32_t>(skeleton.Parents.size());
+
+	skeleton.Parents.push_back(parent);
+	skeleton.Offsets.push_back({ joint.Offset[0], joint.Offset[1], joint.Offset[2] });
+	skeleton.ChannelOffsets.push_back(joint.ChannelOffset);
+	skeleton.ChannelCounts.push_back(joint.ChannelCount);
+	skeleton.Names.push_back(joint.Name);
+
+	for (uint32_t i = 0; i < joint.ChannelCount; i++)
+	{
+		skeleton.Channels[joint.ChannelOffset + i] = joint.ChannelOrder[i];
+	}
+
+	for (uint32_t i = 0; i < joint.Children.size(); i++)
+	{
+		AppendJoint(skeleton, joint.Children[i], index);
+	}
+}
+
+void BuildSkeleton(Skeleton& skeleton, const BVHHierarchy& hierarchy)
+{
+	skeleton.Parents.clear();
+	skeleton.Offsets.clear();
+	skeleton.ChannelOffsets.clear();
+	skeleton.ChannelCounts.clear();
+	skeleton.Names.clear();
+
+	skeleton.Parents.reserve(hierarchy.JointCount);
+	skeleton.Offsets.reserve(hierarchy.JointCount);
+	skeleton.ChannelOffsets.reserve(hierarchy.JointCount);
+	skeleton.ChannelCounts.reserve(hierarchy.JointCount);
+	skeleton.Names.reserve(hierarchy.JointCount);
+	skeleton.Channels.assign(hierarchy.ChannelCount, 0);
+
+	AppendJoint(skeleton, hierarchy.Root, SKELETON_NO_PARENT);
+
+	skeleton.JointCount = static_cast<uint32_t>(skeleton.Parents.size());
+	skeleton.ChannelCount = hierarchy.ChannelCount;
+}
+
+void InitializePose(SkeletonPose& pose, const Skeleton& skeleton)
+{
+	pose.Positions.assign(skeleton.Offsets.begin(), skeleton.Offsets.end());
+	pose.Rotations.assign(skeleton.JointCount, quatf());
+	pose.WorldMatrices.assign(skeleton.JointCount, mat4f(1.0f));
+}
+
+void EvaluatePose(SkeletonPose& pose, const Skeleton& skeleton, const BVHMotion& motion, const uint32_t& frame)
+{
+	const float* values = motion.Data + static_cast<size_t>(frame) * motion.ChannelCount;
+
+	for (uint32_t j = 0; j < skeleton.JointCount; j++)
+	{
+		vec3f position = skeleton.Offsets[j];
+		vec3f rotation = { 0.0f, 0.0f, 0.0f };
+
+		uint32_t channelOffset = skeleton.ChannelOffsets[j];
+		for (uint32_t c = channelOffset; c < channelOffset + skeleton.ChannelCounts[j]; c++)
+		{
+			float value = values[c];
+
+			switch (skeleton.Channels[c])
+			{
+			case DOF_POSITION_X: position.x += value; break;
+			case DOF_POSITION_Y: position.y += value; break;
+			case DOF_POSITION_Z: position.z += value; break;
+			case DOF_ROTATION_X: rotation.x += value * SkeletonRadian; break;
+			case DOF_ROTATION_Y: rotation.y += value * SkeletonRadian; break;
+			case DOF_ROTATION_Z: rotation.z += value * SkeletonRadian; break;
+			}
+		}
+
+		pose.Positions[j] = position;
+		pose.Rotations[j] = quatf::rollPitchYaw(-rotation.z, rotation.x, rotation.y);
+	}
+}
+
+void ComputeWorldMatrices(SkeletonPose& pose, const Skeleton& skeleton)
+{
+	for (uint32_t j = 0; j < skeleton.JointCount; j++)
+	{
+		mat4f local = pose.Rotations[j].toMatrix4() * mat4f::translate(pose.Positions[j]);
+
+		uint32_t parent = skeleton.Parents[j];
+		pose.WorldMatrices[j] = (parent == SKELETON_NO_PARENT) ? local : local * pose.WorldMatrices[parent];
+	}
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include "GraphicsMath\cgm.h"
+#include "BVHResource.h"
+#include <stdint.h>
+#include <vector>
+#include <string>
+
+#define SKELETON_NO_PARENT 0xffffffff
+
+// Flattened BVHHierarchy. Joints are stored depth first, so every parent comes before its children and a single
+// forward loop can accumulate world matrices. A skeleton is read only once built; each animated instance keeps its
+// own SkeletonPose and several instances can share one skeleton and one BVHMotion.
+struct Skeleton
+{
+	std::vector<uint32_t>		Parents;		// SKELETON_NO_PARENT for the root
+	std::vector<vec3f>			Offsets;		// Bind offset from the parent
+	std::vector<uint32_t>		ChannelOffsets;	// First channel of the joint within a motion frame
+	std::vector<uint32_t>		ChannelCounts;
+	std::vector<uint16_t>		Channels;		// DOF_* per channel, in motion frame order
+	std::vector<std::string>	Names;			// Not touched by pose evaluation
+	uint32_t					JointCount;
+	uint32_t					ChannelCount;
+};
+
+struct SkeletonPose
+{
+	std::vector<vec3f>	Positions;		// Local, bind offset included
+	std::vector<quatf>	Rotations;		// Local
+	std::vector<mat4f>	WorldMatrices;
+};
+
+void BuildSkeleton(Skeleton& skeleton, const BVHHierarchy& hierarchy);
+void InitializePose(SkeletonPose& pose, const Skeleton& skeleton);
+
+// Decodes one motion frame into local joint positions and rotations.
+void EvaluatePose(SkeletonPose& pose, const Skeleton& skeleton, const BVHMotion& motion, const uint32_t& frame);
+
+// World matrices from the local pose, parents first.
+void ComputeWorldMatrices(SkeletonPose& pose, const Skeleton& skeleton);
@@ -0,0 +1,130 @@
+#include "SkeletonAnimation.h"
+#include <math.h>
+#include <algorithm>
+
+static inline quatf NlerpRotation(const SkeletonAnimation& animation, const size_t& a, const size_t& b, const float& u)
+{
+	const std::vector<float>* rotations = animation.Rotations;
+
+	float w = rotations[0][a] + (rotations[0][b] - rotations[0][a]) * u;
+	float x = rotations[1][a] + (rotations[1][b] - rotations[1][a]) * u;
+	float y = rotations[2][a] + (rotations[2][b] - rotations[2][a]) * u;
+	float z = rotations[3][a] + (rotations[3][b] - rotations[3][a]) * u;
+
+	float scale = 1.0f / sqrtf(w * w + x * x + y * y + z * z);
+	return { w * scale, x * scale, y * scale, z * scale };
+}
+
+void BakeAnimation(SkeletonAnimation& animation, const Skeleton& skeleton, const BVHMotion& motion)
+{
+	animation.FrameCount	= motion.FrameCount;
+	animation.JointCount	= skeleton.JointCount;
+	animation.FrameTime		= motion.FrameTime;
+
+	size_t count = static_cast<size_t>(motion.FrameCount) * skeleton.JointCount;
+	for (uint32_t c = 0; c < 3; c++)
+	{
+		animation.Translations[c].resize(count);
+	}
+
+	for (uint32_t c = 0; c < 4; c++)
+	{
+		animation.Rotations[c].resize(count);
+	}
+
+	SkeletonPose pose;
+	InitializePose(pose, skeleton);
+
+	for (uint32_t f = 0; f < motion.FrameCount; f++)
+	{
+		EvaluatePose(pose, skeleton, motion, f);
+
+		size_t i = static_cast<size_t>(f) * skeleton.JointCount;
+		for (uint32_t j = 0; j < skeleton.JointCount; j++, i++)
+		{
+			const vec3f& translation = pose.Positions[j];
+			animation.Translations[0][i] = translation.x;
+			animation.Translations[1][i] = translation.y;
+			animation.Translations[2][i] = translation.z;
+
+			const quatf& rotation = pose.Rotations[j];
+			float sign = 1.0f;
+			if (f > 0)
+			{
+				size_t previous = i - skeleton.JointCount;
+				float dot =
+					rotation.w * animation.Rotations[0][previous] +
+					rotation.v.x * animation.Rotations[1][previous] +
+					rotation.v.y * animation.Rotations[2][previous] +
+					rotation.v.z * animation.Rotations[3][previous];
+
+				sign = (dot < 0.0f) ? -1.0f : 1.0f;
+			}
+
+			animation.Rotations[0][i] = rotation.w * sign;
+			animation.Rotations[1][i] = rotation.v.x * sign;
+			animation.Rotations[2][i] = rotation.v.y * sign;
+			animation.Rotations[3][i] = rotation.v.z * sign;
+		}
+	}
+}
+
+void SampleAnimation(SkeletonPose& pose, const SkeletonAnimation& animation, const uint32_t& frame, const float& u)
+{
+	if (animation.FrameCount == 0)
+	{
+		return;
+	}
+
+	uint32_t lastFrame = animation.FrameCount - 1;
+	size_t a = static_cast<size_t>((std::min)(frame, lastFrame)) * animation.JointCount;
+	size_t b = static_cast<size_t>((std::min)(frame + 1, lastFrame)) * animation.JointCount;
+
+	const std::vector<float>* translations = animation.Translations;
+
+	for (uint32_t j = 0; j < animation.JointCount; j++, a++, b++)
+	{
+		pose.Positions[j] = {
+			translations[0][a] + (translations[0][b] - translations[0][a]) * u,
+			translations[1][a] + (translations[1][b] - translations[1][a]) * u,
+			translations[2][a] + (translations[2][b] - translations[2][a]) * u };
+
+		pose.Rotations[j] = NlerpRotation(animation, a, b, u);
+	}
+}
+
+void SampleAnimationCatmullRom(SkeletonPose& pose, const SkeletonAnimation& animation, const uint32_t& frame, const float& u)
+{
+	if (animation.FrameCount == 0)
+	{
+		return;
+	}
+
+	uint32_t lastFrame = animation.FrameCount - 1;
+	uint32_t current = (std::min)(frame, lastFrame);
+
+	size_t i0 = static_cast<size_t>((current == 0) ? 0 : current - 1) * animation.JointCount;
+	size_t i1 = static_cast<size_t>(current) * animation.JointCount;
+	size_t i2 = static_cast<size_t>((std::min)(current + 1, lastFrame)) * animation.JointCount;
+	size_t i3 = static_cast<size_t>((std::min)(current + 2, lastFrame)) * animation.JointCount;
+
+	// Rows of T * CR with T = (1, u, u^2, u^3)
+	float u2 = u * u;
+	float u3 = u2 * u;
+	float w0 = 0.5f * (-u + 2.0f * u2 - u3);
+	float w1 = 0.5f * (2.0f - 5.0f * u2 + 3.0f * u3);
+	float w2 = 0.5f * (u + 4.0f * u2 - 3.0f * u3);
+	float w3 = 0.5f * (-u2 + u3);
+
+	const std::vector<float>* translations = animation.Translations;
+
+	for (uint32_t j = 0; j < animation.JointCount; j++, i0++, i1++, i2++, i3++)
+	{
+		pose.Positions[j] = {
+			w0 * translations[0][i0] + w1 * translations[0][i1] + w2 * translations[0][i2] + w3 * translations[0][i3],
+			w0 * translations[1][i0] + w1 * translations[1][i1] + w2 * translations[1][i2] + w3 * translations[1][i3],
+			w0 * translations[2][i0] + w1 * translations[2][i1] + w2 * translations[2][i2] + w3 * translations[2][i3] };
+
+		pose.Rotations[j] = NlerpRotation(animation, i1, i2, u);
+	}
+}
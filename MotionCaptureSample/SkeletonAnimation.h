@@ -0,0 +1,26 @@
+#pragma once
+#include "Skeleton.h"
+#include <stdint.h>
+#include <vector>
+
+// BVHMotion baked at load time into local translation and rotation tracks for a Skeleton. Channels are decoded and
+// Euler angles turned into quaternions once, so sampling a frame is a fetch and an interpolation with no trig.
+// Every component is its own array, frame major: element frame * JointCount + joint. Sampling reads two or four
+// runs of contiguous joints per component. Rotations are kept in the hemisphere of the previous frame, so
+// interpolating neighbouring frames always takes the short way round.
+struct SkeletonAnimation
+{
+	std::vector<float>	Translations[3];	// x, y, z; bind offset included
+	std::vector<float>	Rotations[4];		// w, x, y, z
+	uint32_t			FrameCount;
+	uint32_t			JointCount;
+	float				FrameTime;
+};
+
+void BakeAnimation(SkeletonAnimation& animation, const Skeleton& skeleton, const BVHMotion& motion);
+
+// Linear translations and normalized linear rotations between frame and frame + 1.
+void SampleAnimation(SkeletonPose& pose, const SkeletonAnimation& animation, const uint32_t& frame, const float& u);
+
+// Catmull-Rom translations through frame - 1 .. frame + 2, normalized linear rotations between frame and frame + 1.
+void SampleAnimationCatmullRom(SkeletonPose& pose, const SkeletonAnimation& animation, const uint32_t& frame, const float& u);
@@ -5,10 +5,12 @@
 #include "Rig3D\Common\Transform.h"
 #include "Memory\Memory\Memory.h"
 #include "Rig3D\Graphics\MeshLibrary.h"
+#include "Rig3D\TaskDispatch\TaskDispatcher.h"
 #include <d3d11.h>
 #include "Rig3D\Graphics\Interface\IShader.h"
 #include "Rig3D\Graphics\Interface\IShaderResource.h"
 #include "BVHResource.h"
+#include "SkeletonAnimation.h"
 #include <vector>
 #include <utility>
 #include <Rig3D\Graphics\DirectX11\DirectXTK\Inc\WICTextureLoader.h>
@@ -17,11 +19,14 @@
 #define CAMERA_SPEED			0.1f
 #define CAMERA_ROTATION_SPEED	0.1f
 #define RADIAN					3.1415926535f / 180.0f
-#define INTERPOLATION			0
+#define INTERPOLATION			0		// 0: linear, 1: Catmull-Rom
 #define BVH_FILENAME			"BVH\\Tiptoe.bvh"
+#define THREAD_COUNT			4
 
 using namespace Rig3D;
 
+uint8_t gTaskMemory[4096];
+
 typedef	std::vector<std::pair<uint32_t, uint32_t>> PairVector;
 
 struct Vertex2
@@ -51,13 +56,18 @@ public:
 
 	Transform					mCamera;
 	BVHResource					mBVHResource;
+	Skeleton					mSkeleton;
+	SkeletonAnimation			mAnimation;
+	SkeletonPose				mPose;
 
 	LinearAllocator				mAllocator;
 
+	cliqCity::multicore::Thread			mThreads[THREAD_COUNT];
+	cliqCity::multicore::TaskDispatcher	mTaskDispatcher;
+
 	PairVector					mPairVector;
 	mat4f*						mJointWorldMatrices;
 	vec3f*						mLineVertices;
-	Transform*					mTransforms;
 	IMesh*						mCubeMesh;
 	IMesh*						mPlaneMesh;
 
@@ -76,12 +86,13 @@ public:
 	ID3D11ShaderResourceView*	mCheckerboardSRV;
 	ID3D11SamplerState*			mSamplerState;
 
-	uint32_t					mTransformCount;
+	uint32_t					mJointCount;
 
 	float						mMouseX;
 	float						mMouseY;
 	float						mAnimationDuration;
 	float						mAnimationScale;
+	double						mLoadMilliseconds;
 
 	MotionCaptureSample();
 	~MotionCaptureSample();
@@ -94,22 +105,21 @@ public:
 
 	void InitializeGeometry();
 	void InitializeBVHResources();
-	void InitializeTransforms(Transform* transforms, PairVector* pairVector, const BVHJoint* joint);
 
 	void InitializeShaders();
 
 	void UpdateCamera();
-	void UpdateTransforms(Transform* transforms, const BVHJoint* joint, const BVHMotion* motion, const uint32_t& transformCount, const uint32_t& frameIndex, const float& u);
-	void UpdateJointWorldMatrices(mat4f* jointWorldMatrices, Transform* transforms, const uint32_t& count);
-	void UpdateLineVertices(vec3f* lineVertices, PairVector* pairVector, mat4f* jointWorldMatrices);
+	void UpdatePose(SkeletonPose* pose, const SkeletonAnimation* animation, const uint32_t& frame, const float& u);
+	void UpdateJointWorldMatrices(mat4f* jointWorldMatrices, const SkeletonPose* pose, const uint32_t& count);
+	void UpdateLineVertices(vec3f* lineVertices, PairVector* pairVector, const SkeletonPose* pose);
 	void HandleInput(Input& input);
 };
 
 MotionCaptureSample::MotionCaptureSample() : 
 	mAllocator(10240),
+	mTaskDispatcher(mThreads, THREAD_COUNT, gTaskMemory, 4096),
 	mJointWorldMatrices(nullptr),
 	mLineVertices(nullptr),
-	mTransforms(nullptr), 
 	mCubeMesh(nullptr), 
 	mPlaneMesh(nullptr),
 	mRenderer(nullptr),
@@ -124,11 +134,12 @@ MotionCaptureSample::MotionCaptureSample() :
 	mLineVertexBuffer(nullptr),
 	mCheckerboardSRV(nullptr),
 	mSamplerState(nullptr),
-	mTransformCount(0),
+	mJointCount(0),
 	mMouseX(0.0f),
 	mMouseY(0.0f),
 	mAnimationDuration(0.0f),
-	mAnimationScale(3.0f)
+	mAnimationScale(3.0f),
+	mLoadMilliseconds(0.0)
 {
 	mOptions.mWindowCaption = "Motion Capture Sample";
 	mOptions.mWindowWidth = 1200;
@@ -150,6 +161,8 @@ void MotionCaptureSample::VInitialize()
 	mRenderer->SetDelegate(this);
 
 	mCamera.SetPosition(vec3f(0.0f, 100.0f, -400.0f));
+
+	mTaskDispatcher.Start();
 	
 	InitializeBVHResources();
 	InitializeGeometry();
@@ -170,22 +183,23 @@ void MotionCaptureSample::VUpdate(double milliseconds)
 	if (t < mAnimationDuration)
 	{
 		// Find key frame index
-		frame = static_cast<int>(floorf((t / mBVHResource.mMotion.FrameTime )* mAnimationScale));
+		float frameTime = t / (mBVHResource.mMotion.FrameTime * mAnimationScale);
+		frame = (std::min)(static_cast<uint32_t>(floorf(frameTime)), mBVHResource.mMotion.FrameCount - 1);
 
 		// Find fractional portion
-		float u = (t - frame);
+		float u = frameTime - frame;
 	
-		UpdateTransforms(mTransforms, &mBVHResource.mHierarchy.Root, &mBVHResource.mMotion, mTransformCount, frame * mBVHResource.mMotion.ChannelCount, u);
+		UpdatePose(&mPose, &mAnimation, frame, u);
 		
 		animationTime += static_cast<float>(milliseconds);
 	}
 	
-	UpdateJointWorldMatrices(mJointWorldMatrices, mTransforms, mTransformCount);
+	UpdateJointWorldMatrices(mJointWorldMatrices, &mPose, mJointCount);
 
-	UpdateLineVertices(mLineVertices, &mPairVector, mJointWorldMatrices);
+	UpdateLineVertices(mLineVertices, &mPairVector, &mPose);
 
 	char str[256];
-	sprintf_s(str, "Frame: %u Animation: %f", frame, t);
+	sprintf_s(str, "Frame: %u Animation: %f BVH Load: %.2f ms", frame, t, mLoadMilliseconds);
 	mRenderer->SetWindowCaption(str);
 
 	frame++;
@@ -216,7 +230,7 @@ void MotionCaptureSample::VRender()
 	mRenderer->VUpdateShaderConstantBuffer(mVertexShaderResource, &mViewProjection, 0);
 	mRenderer->VSetVertexShaderConstantBuffers(mVertexShaderResource);
 	mRenderer->VBindMesh(mCubeMesh);
-	deviceContext->DrawIndexedInstanced(mCubeMesh->GetIndexCount(), mTransformCount, 0, 0, 0);
+	deviceContext->DrawIndexedInstanced(mCubeMesh->GetIndexCount(), mJointCount, 0, 0, 0);
 
 	mRenderer->VSetInputLayout(mPlaneVertexShader);
 	mRenderer->VSetVertexShader(mPlaneVertexShader);
@@ -313,26 +327,33 @@ void MotionCaptureSample::InitializeBVHResources()
 {
 	// Load BVH file
 	mBVHResource.SetFilename(BVH_FILENAME);
-	mBVHResource.Load();
+
+	ClockTime loadStart = std::chrono::high_resolution_clock::now();
+	mBVHResource.Load(&mTaskDispatcher);
+	mLoadMilliseconds = Milliseconds(std::chrono::high_resolution_clock::now() - loadStart).count();
 
 	// Set up animation traits
 	mAnimationDuration = mBVHResource.mMotion.FrameTime * mBVHResource.mMotion.FrameCount * mAnimationScale;
 
-	mTransformCount = mBVHResource.mHierarchy.JointCount;
-	
-	// Allocate Transforms
-	size_t transformsByteSize = sizeof(Transform) * mTransformCount;
-	mTransforms = reinterpret_cast<Transform*>(mAllocator.Allocate(transformsByteSize, alignof(Transform), 0));
-	memset(mTransforms, 0, transformsByteSize);
+	// Flatten the hierarchy; joints are depth first, so the root is joint 0 and parents precede children
+	BuildSkeleton(mSkeleton, mBVHResource.mHierarchy);
+	InitializePose(mPose, mSkeleton);
+
+	// Decode channels and build rotations once, so playback only samples tracks
+	BakeAnimation(mAnimation, mSkeleton, mBVHResource.mMotion);
+
+	mJointCount = mSkeleton.JointCount;
 
 	// Allocate world matrices
-	size_t matricesByteSize = sizeof(mat4f) * mTransformCount;
+	size_t matricesByteSize = sizeof(mat4f) * mJointCount;
 	mJointWorldMatrices = reinterpret_cast<mat4f*>(mAllocator.Allocate(matricesByteSize, alignof(mat4f), 0));
 	memset(mJointWorldMatrices, 0, matricesByteSize);
 
-	// Initialize transforms from bvh resource
-	BVHJoint* currentJoint = &mBVHResource.mHierarchy.Root;
-	InitializeTransforms(mTransforms, &mPairVector, currentJoint);
+	// One line per bone
+	for (uint32_t i = 1; i < mJointCount; i++)
+	{
+		mPairVector.push_back(std::make_pair(mSkeleton.Parents[i], i));
+	}
 
 	size_t lineVertexByteSize = sizeof(vec3f) * mPairVector.size() * 2;
 	mLineVertices = reinterpret_cast<vec3f*>(mAllocator.Allocate(lineVertexByteSize, alignof(vec3f), 0));
@@ -341,27 +362,6 @@ void MotionCaptureSample::InitializeBVHResources()
 	mPlaneWorldMatrix = mat4f::scale(1.0f);
 }
 
-void MotionCaptureSample::InitializeTransforms(Transform* transforms, PairVector* pairVector, const BVHJoint* joint)
-{	
-	static uint32_t index = 0;
-
-	std::pair<uint32_t, uint32_t> jointPair;
-	jointPair.first = index;
-
-	Transform* parent = &transforms[index++];
-	parent->SetScale(vec3f(1.0f));
-	
-
-	for (uint32_t i = 0; i < joint->Children.size(); i++)
-	{
-		jointPair.second = index;
-		pairVector->push_back(jointPair);
-
-		transforms[index].SetParent(parent);
-		InitializeTransforms(transforms, pairVector, &joint->Children[i]);
-	}
-}
-
 void MotionCaptureSample::InitializeShaders()
 {
 	// ==== Joint Shaders ====
@@ -390,7 +390,7 @@ void MotionCaptureSample::InitializeShaders()
 	mRenderer->VCreateShaderConstantBuffers(mVertexShaderResource, constantBufferData, constantBufferSizes, 1);
 
 	void*	instanceBufferData[]	= { mJointWorldMatrices };
-	size_t	instanceBufferSizes[]	= { sizeof(mat4f) * mTransformCount };
+	size_t	instanceBufferSizes[]	= { sizeof(mat4f) * mJointCount };
 	size_t	instanceBufferStrides[] = { sizeof(mat4f) };
 	size_t	instanceBufferOffsets[] = { 0 };
 	mRenderer->VCreateDynamicShaderInstanceBuffers(mVertexShaderResource, instanceBufferData, instanceBufferSizes, instanceBufferStrides, instanceBufferOffsets, 1);
@@ -445,141 +445,33 @@ void MotionCaptureSample::UpdateCamera()
 	mViewProjection.Projection = mat4f::normalizedPerspectiveLH(PI * 0.25f, mRenderer->GetAspectRatio(), 0.1f, 1000.0f).transpose();
 }
 
-void MotionCaptureSample::UpdateTransforms(Transform* transforms, const BVHJoint* joint, const BVHMotion* motion, const uint32_t& transformCount, const uint32_t& frameIndex, const float& u)
+void MotionCaptureSample::UpdatePose(SkeletonPose* pose, const SkeletonAnimation* animation, const uint32_t& frame, const float& u)
 {
-	static uint32_t index = 0;
-
-	if (index == transformCount)
-	{
-		index = 0;
-	}
-
 #if INTERPOLATION == 1
-	uint32_t frameIndices[4];
-	frameIndices[0] = (frameIndex == 0) ? frameIndex : frameIndex - 1;
-	frameIndices[1] = frameIndex;
-	frameIndices[2] = frameIndex + 1;
-	frameIndices[3] = (frameIndex == motion->FrameCount - 2) ? frameIndex + 1 : frameIndex + 2;
-
-	vec3f jointPositions[4];
-	vec3f jointRotations[4];
-
-	for (int f = 0; f < 4; f ++)
-	{
-		uint32_t channelOffset = frameIndices[f] + joint->ChannelOffset;
-		jointPositions[f] = { joint->Offset[0], joint->Offset[1], joint->Offset[2] };
-		jointRotations[f] = { 0.0f, 0.0f, 0.0f };
-
-		for (uint32_t i = 0; i < joint->ChannelCount; i++)
-		{
-			uint16_t channel = joint->ChannelOrder[i];
-			float value = motion->Data[channelOffset + i];
-
-			if (channel & DOF_POSITION_X)
-			{
-				jointPositions[f].x += value;
-			}
-			else if (channel & DOF_POSITION_Y)
-			{
-				jointPositions[f].y += value;
-			}
-			else if (channel & DOF_POSITION_Z)
-			{
-				jointPositions[f].z += value;
-			}
-			else if (channel & DOF_ROTATION_X)
-			{
-				jointRotations[f].x += value * RADIAN;
-			}
-			else if (channel & DOF_ROTATION_Y)
-			{
-				jointRotations[f].y += value * RADIAN;
-			}
-			else if (channel & DOF_ROTATION_Z)
-			{
-				jointRotations[f].z += value * RADIAN;
-			}
-		}
-	}
-
-	mat4f CR = 0.5f * mat4f(
-		0.0f, 2.0f, 0.0f, 0.0f,
-		-1.0f, 0.0f, 1.0f, 0.0f,
-		2.0f, -5.0f, 4.0f, -1.0f,
-		-1.0f, 3.0f, -3.0f, 1.0f);
-
-	mat4f P = { jointPositions[0], jointPositions[1], jointPositions[2], jointPositions[3] };
-	vec4f T = { 1, u, u * u, u * u * u };
-
-	vec3f position = T * CR * P;
-	
-	quatf q0 = quatf::rollPitchYaw(jointRotations[1].z, jointRotations[1].x, jointRotations[1].y);
-	quatf q1 = quatf::rollPitchYaw(jointRotations[2].z, jointRotations[2].x, jointRotations[2].y);
-	quatf rotation = cliqCity::graphicsMath::slerp(q0, q1, u);
+	SampleAnimationCatmullRom(*pose, *animation, frame, u);
 #else
-
-	uint32_t channelOffset = frameIndex + joint->ChannelOffset;
-	vec3f position = { joint->Offset[0], joint->Offset[1], joint->Offset[2] };
-	vec3f rotation = { 0.0f, 0.0f, 0.0f };
-
-	for (uint32_t i = 0; i < joint->ChannelCount; i++)
-	{
-		uint16_t channel = joint->ChannelOrder[i];
-		float value = motion->Data[channelOffset + i];
-
-		if (channel & DOF_POSITION_X)
-		{
-			position.x += value;
-		}
-		else if (channel & DOF_POSITION_Y)
-		{
-			position.y += value;
-		}
-		else if (channel & DOF_POSITION_Z)
-		{
-			position.z += value;
-		}
-		else if (channel & DOF_ROTATION_X)
-		{
-			rotation.x += value * RADIAN;
-		}
-		else if (channel & DOF_ROTATION_Y)
-		{
-			rotation.y += value * RADIAN;
-		}
-		else if (channel & DOF_ROTATION_Z)
-		{
-			rotation.z += value * RADIAN;
-		}
-	}
+	SampleAnimation(*pose, *animation, frame, u);
 #endif
 
-	Transform* transform = &transforms[index++];
-	transform->SetPosition(position.x, position.y, position.z);
-	transform->SetRotation(rotation.x, rotation.y, -rotation.z);
-	
-	for (uint32_t i = 0; i < joint->Children.size(); i++)
-	{
-		UpdateTransforms(transforms, &joint->Children[i], motion, transformCount, frameIndex, u);
-	}
+	ComputeWorldMatrices(*pose, mSkeleton);
 }
 
-void MotionCaptureSample::UpdateJointWorldMatrices(mat4f* jointWorldMatrices, Transform* transforms, const uint32_t& count)
+void MotionCaptureSample::UpdateJointWorldMatrices(mat4f* jointWorldMatrices, const SkeletonPose* pose, const uint32_t& count)
 {
 	for (uint32_t i = 0; i < count; i++)
 	{
-		mJointWorldMatrices[i] = transforms[i].GetWorldMatrix().transpose();
+		jointWorldMatrices[i] = pose->WorldMatrices[i].transpose();
 	}
 
-	mRenderer->VUpdateShaderInstanceBuffer(mVertexShaderResource, mJointWorldMatrices, sizeof(mat4f) * count, 0);
+	mRenderer->VUpdateShaderInstanceBuffer(mVertexShaderResource, jointWorldMatrices, sizeof(mat4f) * count, 0);
 }
 
-void MotionCaptureSample::UpdateLineVertices(vec3f* lineVertices, PairVector* pairVector, mat4f* jointWorldMatrices)
+void MotionCaptureSample::UpdateLineVertices(vec3f* lineVertices, PairVector* pairVector, const SkeletonPose* pose)
 {
 	for (uint32_t i = 0, j = 0; i < pairVector->size(); i++, j += 2)
 	{
-		lineVertices[j] = jointWorldMatrices[pairVector->at(i).first].transpose().t;
-		lineVertices[j + 1] = jointWorldMatrices[pairVector->at(i).second].transpose().t;
+		lineVertices[j] = pose->WorldMatrices[pairVector->at(i).first].t;
+		lineVertices[j + 1] = pose->WorldMatrices[pairVector->at(i).second].t;
 	}
 }
 
@@ -0,0 +1,410 @@
+#pragma once
+#include "Rig3D/Common/MemoryMappedFile.h"
+#include "Rig3D/Common/LZ4.h"
+#include "Rig3D/TaskDispatch/TaskDispatcher.h"
+#include <vector>
+#include <string>
+#include <fstream>
+#include <algorithm>
+#include <string.h>
+#include <stdint.h>
+
+#define RIG_ARCHIVE_MAGIC		0x4b415052	// "RPAK"
+#define RIG_ARCHIVE_VERSION		1
+#define RIG_ARCHIVE_CHUNK_SIZE	65536
+
+// Read only asset archive. Each file is split into RIG_ARCHIVE_CHUNK_SIZE chunks compressed independently with LZ4
+// (a chunk that does not shrink is stored raw), so one open and one mapping replace a file open per asset and the
+// chunks of a large file decompress in parallel. The directory sits at the end of the file: a chunk table, an entry
+// table sorted by path hash for binary search, and the normalized path strings entries point into.
+namespace Rig3D
+{
+	struct ArchiveHeader
+	{
+		uint32_t	magic;
+		uint32_t	version;
+		uint32_t	entryCount;
+		uint32_t	chunkCount;
+		uint64_t	chunkTableOffset;
+		uint64_t	entryTableOffset;
+		uint64_t	namesOffset;
+		uint64_t	namesSize;
+	};
+
+	struct ArchiveEntry
+	{
+		uint64_t	pathHash;
+		uint32_t	nameOffset;
+		uint32_t	nameLength;
+		uint64_t	size;
+		uint32_t	firstChunk;
+		uint32_t	chunkCount;
+	};
+
+	// compressedSize == size marks a raw chunk.
+	struct ArchiveChunk
+	{
+		uint64_t	offset;
+		uint32_t	compressedSize;
+		uint32_t	size;
+	};
+
+	struct AssetArchive
+	{
+		MemoryMappedFile		file;
+		const ArchiveHeader*	header;
+		const ArchiveChunk*		chunks;
+		const ArchiveEntry*		entries;
+		const char*				names;
+
+		AssetArchive() : header(nullptr), chunks(nullptr), entries(nullptr), names(nullptr) {};
+	};
+
+	// Paths match case insensitively with either slash, so "Models\Sphere.obj" finds "models/sphere.obj".
+	inline char NormalizeArchivePathCharacter(const char& c)
+	{
+		return (c == '\\') ? '/' : ((c >= 'A' && c <= 'Z') ? c - 'A' + 'a' : c);
+	}
+
+	inline const char* SkipArchivePathPrefix(const char* path)
+	{
+		while (path[0] == '.' && (path[1] == '/' || path[1] == '\\'))
+		{
+			path += 2;
+		}
+
+		return path;
+	}
+
+	// FNV-1a over the normalized path.
+	inline uint64_t HashArchivePath(const char* path)
+	{
+		uint64_t hash = 14695981039346656037ull;
+		for (path = SkipArchivePathPrefix(path); *path; path++)
+		{
+			hash = (hash ^ static_cast<uint8_t>(NormalizeArchivePathCharacter(*path))) * 1099511628211ull;
+		}
+
+		return hash;
+	}
+
+	inline void NormalizeArchivePath(const char* path, std::string& normalized)
+	{
+		normalized.clear();
+		for (path = SkipArchivePathPrefix(path); *path; path++)
+		{
+			normalized.push_back(NormalizeArchivePathCharacter(*path));
+		}
+	}
+
+	// Maps filename and validates the directory. On failure the archive is closed.
+	inline bool OpenAssetArchive(AssetArchive& archive, const char* filename)
+	{
+		archive.header = nullptr;
+		if (!archive.file.Open(filename) || archive.file.GetSize() < sizeof(ArchiveHeader))
+		{
+			archive.file.Close();
+			return false;
+		}
+
+		const char* data = archive.file.GetData();
+		uint64_t fileSize = archive.file.GetSize();
+
+		const ArchiveHeader* header = reinterpret_cast<const ArchiveHeader*>(data);
+		bool valid =
+			header->magic == RIG_ARCHIVE_MAGIC &&
+			header->version == RIG_ARCHIVE_VERSION &&
+			header->chunkTableOffset <= fileSize && static_cast<uint64_t>(header->chunkCount) * sizeof(ArchiveChunk) <= fileSize - header->chunkTableOffset &&
+			header->entryTableOffset <= fileSize && static_cast<uint64_t>(header->entryCount) * sizeof(ArchiveEntry) <= fileSize - header->entryTableOffset &&
+			header->namesOffset <= fileSize && header->namesSize <= fileSize - header->namesOffset;
+
+		if (!valid)
+		{
+			archive.file.Close();
+			return false;
+		}
+
+		archive.chunks = reinterpret_cast<const ArchiveChunk*>(data + header->chunkTableOffset);
+		archive.entries = reinterpret_cast<const ArchiveEntry*>(data + header->entryTableOffset);
+		archive.names = data + header->namesOffset;
+
+		// Checked once here so lookups and reads can trust the tables
+		for (uint32_t i = 0; i < header->chunkCount && valid; i++)
+		{
+			const ArchiveChunk& chunk = archive.chunks[i];
+			valid = chunk.size <= RIG_ARCHIVE_CHUNK_SIZE && chunk.compressedSize <= chunk.size && chunk.offset <= fileSize && chunk.compressedSize <= fileSize - chunk.offset;
+		}
+
+		for (uint32_t i = 0; i < header->entryCount && valid; i++)
+		{
+			const ArchiveEntry& entry = archive.entries[i];
+			valid =
+				static_cast<uint64_t>(entry.nameOffset) + entry.nameLength < header->namesSize && archive.names[entry.nameOffset + entry.nameLength] == '\0' &&
+				entry.firstChunk <= header->chunkCount && entry.chunkCount <= header->chunkCount - entry.firstChunk &&
+				entry.chunkCount == (entry.size + RIG_ARCHIVE_CHUNK_SIZE - 1) / RIG_ARCHIVE_CHUNK_SIZE &&
+				(i == 0 || archive.entries[i - 1].pathHash <= entry.pathHash);
+		}
+
+		if (!valid)
+		{
+			archive.file.Close();
+			return false;
+		}
+
+		archive.header = header;
+		return true;
+	}
+
+	// Directory lookup: binary search on the path hash, then a name compare to rule out collisions.
+	inline const ArchiveEntry* FindArchiveEntry(const AssetArchive& archive, const char* path)
+	{
+		uint64_t hash = HashArchivePath(path);
+		path = SkipArchivePathPrefix(path);
+
+		const ArchiveEntry* end = archive.entries + archive.header->entryCount;
+		const ArchiveEntry* entry = std::lower_bound(archive.entries, end, hash, [](const ArchiveEntry& e, const uint64_t& h) { return e.pathHash < h; });
+		for (; entry != end && entry->pathHash == hash; entry++)
+		{
+			const char* name = archive.names + entry->nameOffset;
+
+			uint32_t i = 0;
+			while (i < entry->nameLength && path[i] && name[i] == NormalizeArchivePathCharacter(path[i]))
+			{
+				i++;
+			}
+
+			if (i == entry->nameLength && !path[i])
+			{
+				return entry;
+			}
+		}
+
+		return nullptr;
+	}
+
+	inline const char* GetArchiveEntryName(const AssetArchive& archive, const ArchiveEntry& entry)
+	{
+		return archive.names + entry.nameOffset;
+	}
+
+	// Pointer into the mapping when every chunk of entry is stored raw (already compressed data such as DDS usually
+	// is), so it can be used without a copy; nullptr otherwise. Raw chunks of one entry are written back to back.
+	inline const char* GetArchiveEntryView(const AssetArchive& archive, const ArchiveEntry& entry)
+	{
+		for (uint32_t c = 0; c < entry.chunkCount; c++)
+		{
+			const ArchiveChunk& chunk = archive.chunks[entry.firstChunk + c];
+			if (chunk.compressedSize != chunk.size || (c > 0 && chunk.offset != archive.chunks[entry.firstChunk + c - 1].offset + RIG_ARCHIVE_CHUNK_SIZE))
+			{
+				return nullptr;
+			}
+		}
+
+		return (entry.chunkCount > 0) ? archive.file.GetData() + archive.chunks[entry.firstChunk].offset : nullptr;
+	}
+
+	// Decompresses chunks [first, first + count) of entry into their place in destination, which holds entry.size
+	// bytes.
+	inline bool ReadArchiveChunks(const AssetArchive& archive, const ArchiveEntry& entry, const uint32_t& first, const uint32_t& count, void* destination)
+	{
+		for (uint32_t c = first; c < first + count; c++)
+		{
+			const ArchiveChunk& chunk = archive.chunks[entry.firstChunk + c];
+			const char* source = archive.file.GetData() + chunk.offset;
+			char* target = static_cast<char*>(destination) + static_cast<uint64_t>(c) * RIG_ARCHIVE_CHUNK_SIZE;
+
+			uint64_t expected = (std::min<uint64_t>)(RIG_ARCHIVE_CHUNK_SIZE, entry.size - static_cast<uint64_t>(c) * RIG_ARCHIVE_CHUNK_SIZE);
+			if (chunk.size != expected)
+			{
+				return false;
+			}
+
+			if (chunk.compressedSize == chunk.size)
+			{
+				memcpy(target, source, chunk.size);
+			}
+			else if (LZ4Decompress(source, chunk.compressedSize, target, chunk.size) != chunk.size)
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	inline bool ReadArchiveEntry(const AssetArchive& archive, const ArchiveEntry& entry, void* destination)
+	{
+		return ReadArchiveChunks(archive, entry, 0, entry.chunkCount, destination);
+	}
+
+	inline bool ReadArchiveEntry(const AssetArchive& archive, const ArchiveEntry& entry, std::vector<char>& data)
+	{
+		data.resize(static_cast<size_t>(entry.size));
+		return ReadArchiveEntry(archive, entry, data.empty() ? nullptr : &data[0]);
+	}
+
+	struct ArchiveReadRange
+	{
+		const AssetArchive*			archive;
+		const ArchiveEntry*			entry;
+		void*						destination;
+		uint32_t					first;
+		uint32_t					count;
+		bool						succeeded;
+		cliqCity::multicore::TaskID	taskID;
+	};
+
+	inline void PerformArchiveReadTask(const cliqCity::multicore::TaskData& data)
+	{
+		ArchiveReadRange* range = reinterpret_cast<ArchiveReadRange*>(data.mKernelData);
+		range->succeeded = ReadArchiveChunks(*range->archive, *range->entry, range->first, range->count, range->destination);
+	}
+
+	// ReadArchiveEntry with the chunks split across up to rangeCount tasks. ranges is caller owned scratch with
+	// rangeCount elements. Single chunk entries are read on the calling thread.
+	inline bool ReadArchiveEntryParallel(cliqCity::multicore::TaskDispatcher& dispatcher, const AssetArchive& archive, const ArchiveEntry& entry, void* destination, ArchiveReadRange* ranges, const uint32_t& rangeCount)
+	{
+		if (entry.chunkCount <= 1 || rangeCount <= 1)
+		{
+			return ReadArchiveEntry(archive, entry, destination);
+		}
+
+		uint32_t rangeSize = (entry.chunkCount + rangeCount - 1) / rangeCount;
+
+		cliqCity::multicore::TaskData data;
+		uint32_t taskCount = 0;
+		for (uint32_t first = 0; first < entry.chunkCount; first += rangeSize, taskCount++)
+		{
+			ArchiveReadRange& range = ranges[taskCount];
+			range.archive = &archive;
+			range.entry = &entry;
+			range.destination = destination;
+			range.first = first;
+			range.count = (std::min)(rangeSize, entry.chunkCount - first);
+			range.succeeded = false;
+
+			data.mKernelData = &range;
+			range.taskID = dispatcher.AddTask(data, PerformArchiveReadTask);
+		}
+
+		bool succeeded = true;
+		for (uint32_t i = 0; i < taskCount; i++)
+		{
+			dispatcher.WaitForTask(ranges[i].taskID);
+			succeeded = succeeded && ranges[i].succeeded;
+		}
+
+		return succeeded;
+	}
+
+	struct ArchiveSource
+	{
+		const char* filename;	// File on disk
+		const char* path;		// Path inside the archive
+	};
+
+	// Packs sources into filename. Fails on unreadable sources or two sources with the same normalized path.
+	inline bool WriteAssetArchive(const char* filename, const ArchiveSource* sources, const uint32_t& sourceCount)
+	{
+		std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+		if (!file.is_open())
+		{
+			return false;
+		}
+
+		ArchiveHeader header;
+		memset(&header, 0, sizeof(header));
+		header.magic = RIG_ARCHIVE_MAGIC;
+		header.version = RIG_ARCHIVE_VERSION;
+
+		// Header goes first as a placeholder and is rewritten once the directory offsets are known
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+		std::vector<ArchiveChunk>	chunks;
+		std::vector<ArchiveEntry>	entries(sourceCount);
+		std::string					names;
+		std::string					normalized;
+		std::vector<char>			compressed(LZ4CompressBound(RIG_ARCHIVE_CHUNK_SIZE));
+
+		for (uint32_t s = 0; s < sourceCount; s++)
+		{
+			MemoryMappedFile source;
+			if (!source.Open(sources[s].filename))
+			{
+				return false;
+			}
+
+			NormalizeArchivePath(sources[s].path, normalized);
+
+			ArchiveEntry& entry = entries[s];
+			entry.pathHash = HashArchivePath(sources[s].path);
+			entry.nameOffset = static_cast<uint32_t>(names.size());
+			entry.nameLength = static_cast<uint32_t>(normalized.size());
+			entry.size = source.GetSize();
+			entry.firstChunk = static_cast<uint32_t>(chunks.size());
+			entry.chunkCount = static_cast<uint32_t>((entry.size + RIG_ARCHIVE_CHUNK_SIZE - 1) / RIG_ARCHIVE_CHUNK_SIZE);
+
+			// Null terminated so GetArchiveEntryName can hand out C strings
+			names.append(normalized);
+			names.push_back('\0');
+
+			for (uint64_t offset = 0; offset < entry.size; offset += RIG_ARCHIVE_CHUNK_SIZE)
+			{
+				ArchiveChunk chunk;
+				chunk.offset = static_cast<uint64_t>(file.tellp());
+				chunk.size = static_cast<uint32_t>((std::min<uint64_t>)(RIG_ARCHIVE_CHUNK_SIZE, entry.size - offset));
+
+				const char* data = source.GetData() + offset;
+				size_t compressedSize = LZ4Compress(data, chunk.size, &compressed[0], compressed.size());
+				if (compressedSize > 0 && compressedSize < chunk.size)
+				{
+					chunk.compressedSize = static_cast<uint32_t>(compressedSize);
+					file.write(&compressed[0], compressedSize);
+				}
+				else
+				{
+					chunk.compressedSize = chunk.size;
+					file.write(data, chunk.size);
+				}
+
+				chunks.push_back(chunk);
+			}
+		}
+
+		std::sort(entries.begin(), entries.end(), [&names](const ArchiveEntry& a, const ArchiveEntry& b)
+		{
+			return (a.pathHash != b.pathHash) ? a.pathHash < b.pathHash : strcmp(&names[a.nameOffset], &names[b.nameOffset]) < 0;
+		});
+
+		for (uint32_t i = 1; i < sourceCount; i++)
+		{
+			if (entries[i].pathHash == entries[i - 1].pathHash && strcmp(&names[entries[i].nameOffset], &names[entries[i - 1].nameOffset]) == 0)
+			{
+				return false;
+			}
+		}
+
+		header.entryCount = sourceCount;
+		header.chunkCount = static_cast<uint32_t>(chunks.size());
+
+		// Tables start 8 byte aligned so the mapped directory can be read in place
+		static const char padding[8] = {};
+		uint64_t offset = static_cast<uint64_t>(file.tellp());
+		file.write(padding, static_cast<std::streamsize>(((offset + 7) & ~7ull) - offset));
+
+		header.chunkTableOffset = static_cast<uint64_t>(file.tellp());
+		file.write(reinterpret_cast<const char*>(chunks.data()), chunks.size() * sizeof(ArchiveChunk));
+
+		header.entryTableOffset = static_cast<uint64_t>(file.tellp());
+		file.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(ArchiveEntry));
+
+		header.namesOffset = static_cast<uint64_t>(file.tellp());
+		header.namesSize = names.size();
+		file.write(names.data(), names.size());
+
+		file.seekp(0);
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+		return file.good();
+	}
+}
@@ -0,0 +1,333 @@
+#include "AsyncFileIO.h"
+#include <Windows.h>
+#include <algorithm>
+
+using namespace Rig3D;
+using namespace cliqCity::multicore;
+
+#pragma region AsyncFile
+
+AsyncFile::AsyncFile() : mFile(nullptr), mSize(0)
+{
+
+}
+
+AsyncFile::~AsyncFile()
+{
+	Close();
+}
+
+bool AsyncFile::Open(const char* filename)
+{
+	Close();
+
+	// Overlapped so several I/O threads can read the same file at once
+	HANDLE file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_OVERLAPPED, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size))
+	{
+		CloseHandle(file);
+		return false;
+	}
+
+	mFile = file;
+	mSize = static_cast<uint64_t>(size.QuadPart);
+	return true;
+}
+
+void AsyncFile::Close()
+{
+	if (mFile)
+	{
+		CloseHandle(mFile);
+		mFile = nullptr;
+	}
+
+	mSize = 0;
+}
+
+bool AsyncFile::Read(const uint64_t& offset, void* buffer, const uint32_t& size, uint32_t& bytesRead, void* event) const
+{
+	OVERLAPPED overlapped = {};
+	overlapped.Offset = static_cast<DWORD>(offset);
+	overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+	overlapped.hEvent = event;
+
+	bytesRead = 0;
+	if (!ReadFile(mFile, buffer, size, nullptr, &overlapped) && GetLastError() != ERROR_IO_PENDING)
+	{
+		return GetLastError() == ERROR_HANDLE_EOF;
+	}
+
+	DWORD transferred = 0;
+	if (!GetOverlappedResult(mFile, &overlapped, &transferred, TRUE))
+	{
+		return GetLastError() == ERROR_HANDLE_EOF;
+	}
+
+	bytesRead = static_cast<uint32_t>(transferred);
+	return true;
+}
+
+#pragma endregion
+
+#pragma region AsyncFileIO
+
+AsyncFileIO::AsyncFileIO(Thread* threads, uint8_t threadCount, TaskDispatcher* dispatcher) :
+	mDispatcher(dispatcher),
+	mThreads(threads),
+	mThreadCount(threadCount),
+	mIsRunning(false)
+{
+
+}
+
+AsyncFileIO::AsyncFileIO() : AsyncFileIO(nullptr, 0, nullptr)
+{
+
+}
+
+AsyncFileIO::~AsyncFileIO()
+{
+	Stop();
+	mThreads = nullptr;
+}
+
+void AsyncFileIO::Start()
+{
+	if (mIsRunning)
+	{
+		return;
+	}
+
+	mIsRunning = true;
+	for (int i = 0; i < mThreadCount; i++)
+	{
+		mThreads[i] = std::thread(&AsyncFileIO::ProcessRequests, this);
+	}
+}
+
+// Finishes every queued request, then joins the I/O threads.
+void AsyncFileIO::Stop()
+{
+	{
+		ScopedLock lock(mQueueLock);
+		if (!mIsRunning)
+		{
+			return;
+		}
+
+		mIsRunning = false;
+	}
+
+	mQueueSignal.notify_all();
+	for (int i = 0; i < mThreadCount; i++)
+	{
+		if (mThreads[i].joinable())
+		{
+			mThreads[i].join();
+		}
+	}
+}
+
+void AsyncFileIO::Submit(AsyncReadRequest* request)
+{
+	Submit(&request, 1);
+}
+
+// A batch takes the queue lock and wakes the I/O threads once.
+void AsyncFileIO::Submit(AsyncReadRequest** requests, const uint32_t& count)
+{
+	{
+		ScopedLock lock(mQueueLock);
+		for (uint32_t i = 0; i < count; i++)
+		{
+			requests[i]->bytesRead = 0;
+			requests[i]->state.store(ASYNC_READ_PENDING, std::memory_order_relaxed);
+			mQueue.push_back(requests[i]);
+		}
+	}
+
+	(count > 1) ? mQueueSignal.notify_all() : mQueueSignal.notify_one();
+}
+
+void AsyncFileIO::Wait(const AsyncReadRequest& request) const
+{
+	while (!request.IsComplete())
+	{
+		std::this_thread::yield();
+	}
+}
+
+void AsyncFileIO::ProcessRequests()
+{
+	HANDLE event = CreateEventA(nullptr, TRUE, FALSE, nullptr);
+
+	for (;;)
+	{
+		AsyncReadRequest* request;
+		{
+			UniqueLock lock(mQueueLock);
+			while (mQueue.empty() && mIsRunning)
+			{
+				mQueueSignal.wait(lock);
+			}
+
+			if (mQueue.empty())
+			{
+				break;
+			}
+
+			request = mQueue.front();
+			mQueue.pop_front();
+		}
+
+		uint32_t bytesRead = 0;
+		bool succeeded = request->file && request->file->Read(request->offset, request->buffer, request->size, bytesRead, event);
+		request->bytesRead = bytesRead;
+
+		CompleteRequest(request, succeeded);
+	}
+
+	CloseHandle(event);
+}
+
+void AsyncFileIO::CompleteRequest(AsyncReadRequest* request, const bool& succeeded)
+{
+	// Copied first: without a kernel the owner may reuse the request as soon as the state changes
+	TaskKernel kernel = request->kernel;
+	TaskData data = request->data;
+	data.mKernelData = request;
+
+	request->state.store(succeeded ? ASYNC_READ_COMPLETE : ASYNC_READ_FAILED, std::memory_order_release);
+
+	if (kernel && mDispatcher)
+	{
+		mDispatcher->AddTask(data, kernel);
+	}
+	else if (kernel)
+	{
+		kernel(data);
+	}
+}
+
+#pragma endregion
+
+#pragma region AsyncFileStream
+
+AsyncFileStream::AsyncFileStream() : mIO(nullptr), mMemory(nullptr), mBlockSize(0), mNextOffset(0), mBlockCount(0), mBlock(0), mRecycledBlock(-1)
+{
+
+}
+
+AsyncFileStream::~AsyncFileStream()
+{
+	Close();
+}
+
+bool AsyncFileStream::Open(AsyncFileIO* io, const char* filename, void* memory, const size_t& blockSize, const uint32_t& blockCount)
+{
+	Close();
+
+	if (blockCount == 0 || blockCount > RIG_ASYNC_STREAM_MAX_BLOCKS || blockSize == 0 || !mFile.Open(filename))
+	{
+		return false;
+	}
+
+	mIO = io;
+	mMemory = static_cast<uint8_t*>(memory);
+	mBlockSize = blockSize;
+	mBlockCount = blockCount;
+	mNextOffset = 0;
+	mBlock = 0;
+	mRecycledBlock = -1;
+
+	AsyncReadRequest* batch[RIG_ASYNC_STREAM_MAX_BLOCKS];
+	uint32_t batchCount = 0;
+	for (uint32_t b = 0; b < mBlockCount && mNextOffset < mFile.GetSize(); b++)
+	{
+		AsyncReadRequest& request = mRequests[b];
+		request.file = &mFile;
+		request.offset = mNextOffset;
+		request.buffer = mMemory + b * mBlockSize;
+		request.size = static_cast<uint32_t>((std::min<uint64_t>)(mBlockSize, mFile.GetSize() - mNextOffset));
+		request.kernel = nullptr;
+		mNextOffset += request.size;
+
+		batch[batchCount++] = &request;
+	}
+
+	mIO->Submit(batch, batchCount);
+	return true;
+}
+
+void AsyncFileStream::Close()
+{
+	for (uint32_t b = 0; b < mBlockCount; b++)
+	{
+		if (mRequests[b].state.load(std::memory_order_relaxed) == ASYNC_READ_PENDING)
+		{
+			mIO->Wait(mRequests[b]);
+		}
+
+		mRequests[b].state.store(ASYNC_READ_IDLE, std::memory_order_relaxed);
+	}
+
+	mFile.Close();
+	mBlockCount = 0;
+}
+
+bool AsyncFileStream::Next(const char*& data, size_t& size)
+{
+	// The block handed out last time is free again; refill it with the next unread range
+	if (mRecycledBlock >= 0 && mNextOffset < mFile.GetSize())
+	{
+		SubmitBlock(static_cast<uint32_t>(mRecycledBlock));
+	}
+
+	mRecycledBlock = -1;
+
+	if (mBlockCount == 0)
+	{
+		return false;
+	}
+
+	AsyncReadRequest& request = mRequests[mBlock];
+	if (request.state.load(std::memory_order_relaxed) == ASYNC_READ_IDLE)
+	{
+		return false;
+	}
+
+	mIO->Wait(request);
+
+	bool succeeded = request.state.load(std::memory_order_acquire) == ASYNC_READ_COMPLETE && request.bytesRead > 0;
+	request.state.store(ASYNC_READ_IDLE, std::memory_order_relaxed);
+	if (!succeeded)
+	{
+		return false;
+	}
+
+	data = static_cast<const char*>(request.buffer);
+	size = request.bytesRead;
+
+	mRecycledBlock = static_cast<int32_t>(mBlock);
+	mBlock = (mBlock + 1) % mBlockCount;
+	return true;
+}
+
+void AsyncFileStream::SubmitBlock(const uint32_t& block)
+{
+	AsyncReadRequest& request = mRequests[block];
+	request.offset = mNextOffset;
+	request.size = static_cast<uint32_t>((std::min<uint64_t>)(mBlockSize, mFile.GetSize() - mNextOffset));
+	mNextOffset += request.size;
+
+	mIO->Submit(&request);
+}
+
+#pragma endregion
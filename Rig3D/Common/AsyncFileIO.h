@@ -0,0 +1,134 @@
+#pragma once
+#include "Rig3D/TaskDispatch/TaskDispatcher.h"
+#include <atomic>
+#include <deque>
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef _WINDLL
+#define RIG3D __declspec(dllexport)
+#else
+#define RIG3D __declspec(dllimport)
+#endif
+
+#define RIG_ASYNC_STREAM_MAX_BLOCKS 8
+
+namespace Rig3D
+{
+	enum AsyncReadState
+	{
+		ASYNC_READ_IDLE,
+		ASYNC_READ_PENDING,
+		ASYNC_READ_COMPLETE,
+		ASYNC_READ_FAILED
+	};
+
+	// File opened for positional reads from any thread; reads never move a shared file pointer.
+	class RIG3D AsyncFile
+	{
+	public:
+		AsyncFile();
+		~AsyncFile();
+
+		bool Open(const char* filename);
+		void Close();
+
+		inline uint64_t	GetSize()	const { return mSize; };
+		inline bool		IsOpen()	const { return mFile != nullptr; };
+
+	private:
+		void*		mFile;
+		uint64_t	mSize;
+
+		bool Read(const uint64_t& offset, void* buffer, const uint32_t& size, uint32_t& bytesRead, void* event) const;
+
+		AsyncFile(AsyncFile const&) = delete;
+		void operator=(AsyncFile const&) = delete;
+
+		friend class AsyncFileIO;
+	};
+
+	// One read of size bytes at offset into buffer. On completion kernel (optional) runs on the dispatcher, or on
+	// the I/O thread without one, with data.mKernelData pointing at this request. A request with a kernel must stay
+	// alive until the kernel has run.
+	struct AsyncReadRequest
+	{
+		const AsyncFile*						file;
+		uint64_t								offset;
+		void*									buffer;
+		uint32_t								size;
+		uint32_t								bytesRead;
+		std::atomic<uint32_t>					state;
+		cliqCity::multicore::TaskKernel			kernel;
+		cliqCity::multicore::TaskData			data;
+
+		AsyncReadRequest() : file(nullptr), offset(0), buffer(nullptr), size(0), bytesRead(0), state(ASYNC_READ_IDLE), kernel(nullptr) {};
+
+		inline bool IsComplete() const { return state.load(std::memory_order_acquire) >= ASYNC_READ_COMPLETE; };
+	};
+
+	// Read service. Callers submit requests (one at a time or in batches) and keep working; a pool of caller owned
+	// I/O threads issues blocking positional reads so no worker or render thread waits on the disk. Completion
+	// kernels go to the TaskDispatcher, so parsing continues on the task workers.
+	class RIG3D AsyncFileIO
+	{
+	public:
+		AsyncFileIO(cliqCity::multicore::Thread* threads, uint8_t threadCount, cliqCity::multicore::TaskDispatcher* dispatcher);
+		AsyncFileIO();
+		~AsyncFileIO();
+
+		void Start();
+		void Stop();
+
+		void Submit(AsyncReadRequest* request);
+		void Submit(AsyncReadRequest** requests, const uint32_t& count);
+
+		void Wait(const AsyncReadRequest& request) const;
+
+	private:
+		cliqCity::multicore::Mutex				mQueueLock;
+		cliqCity::multicore::Signal				mQueueSignal;
+		std::deque<AsyncReadRequest*>			mQueue;
+		cliqCity::multicore::TaskDispatcher*	mDispatcher;
+		cliqCity::multicore::Thread*			mThreads;
+		uint8_t									mThreadCount;
+		bool									mIsRunning;
+
+		void ProcessRequests();
+		void CompleteRequest(AsyncReadRequest* request, const bool& succeeded);
+	};
+
+	// Sequential reader with read-ahead: keeps blockCount blocks in flight and hands them back in file order, so
+	// a parser consumes block n while blocks n + 1... are still loading. memory holds blockSize * blockCount bytes.
+	class RIG3D AsyncFileStream
+	{
+	public:
+		AsyncFileStream();
+		~AsyncFileStream();
+
+		bool Open(AsyncFileIO* io, const char* filename, void* memory, const size_t& blockSize, const uint32_t& blockCount);
+		void Close();
+
+		// Next block in file order, waiting only if it has not arrived. data stays valid until the following call.
+		// Returns false at the end of the file or on a read error.
+		bool Next(const char*& data, size_t& size);
+
+		inline uint64_t GetSize() const { return mFile.GetSize(); };
+
+	private:
+		AsyncFile			mFile;
+		AsyncReadRequest	mRequests[RIG_ASYNC_STREAM_MAX_BLOCKS];
+		AsyncFileIO*		mIO;
+		uint8_t*			mMemory;
+		size_t				mBlockSize;
+		uint64_t			mNextOffset;
+		uint32_t			mBlockCount;
+		uint32_t			mBlock;
+		int32_t				mRecycledBlock;
+
+		void SubmitBlock(const uint32_t& block);
+
+		AsyncFileStream(AsyncFileStream const&) = delete;
+		void operator=(AsyncFileStream const&) = delete;
+	};
+}
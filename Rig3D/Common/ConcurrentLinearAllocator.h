@@ -0,0 +1,61 @@
+#pragma once
+#include <atomic>
+#include <stdint.h>
+#include <stddef.h>
+
+namespace Rig3D
+{
+	// Linear allocator safe to share between threads. Allocate bumps an atomic cursor with compare and swap instead
+	// of taking a lock; Free releases everything and must not race with Allocate. Same interface as LinearAllocator,
+	// so it can back MeshLibrary or RIG_NEW from worker threads.
+	class ConcurrentLinearAllocator
+	{
+	public:
+		ConcurrentLinearAllocator(void* start, void* end) :
+			mStart(reinterpret_cast<uintptr_t>(start)),
+			mEnd(reinterpret_cast<uintptr_t>(end)),
+			mCurrent(reinterpret_cast<uintptr_t>(start))
+		{
+
+		}
+
+		ConcurrentLinearAllocator() : ConcurrentLinearAllocator(nullptr, nullptr)
+		{
+
+		}
+
+		// Returns memory where (address + offset) is a multiple of alignment (a power of two), or nullptr when full.
+		void* Allocate(const size_t& size, const size_t& alignment, const size_t& offset)
+		{
+			uintptr_t current = mCurrent.load(std::memory_order_relaxed);
+			for (;;)
+			{
+				uintptr_t address = ((current + offset + alignment - 1) & ~static_cast<uintptr_t>(alignment - 1)) - offset;
+				if (address + size > mEnd)
+				{
+					return nullptr;
+				}
+
+				if (mCurrent.compare_exchange_weak(current, address + size, std::memory_order_relaxed))
+				{
+					return reinterpret_cast<void*>(address);
+				}
+			}
+		}
+
+		void Free()
+		{
+			mCurrent.store(mStart, std::memory_order_relaxed);
+		}
+
+		inline size_t GetUsedSize() const { return mCurrent.load(std::memory_order_relaxed) - mStart; };
+
+	private:
+		uintptr_t				mStart;
+		uintptr_t				mEnd;
+		std::atomic<uintptr_t>	mCurrent;
+
+		ConcurrentLinearAllocator(ConcurrentLinearAllocator const&) = delete;
+		void operator=(ConcurrentLinearAllocator const&) = delete;
+	};
+}
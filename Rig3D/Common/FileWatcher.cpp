@@ -0,0 +1,140 @@
+#include "FileWatcher.h"
+#include <Windows.h>
+
+using namespace Rig3D;
+using namespace cliqCity::multicore;
+
+FileWatcher::FileWatcher() : mDirectory(nullptr), mStopEvent(nullptr), mSettleTime(RIG_FILE_WATCHER_SETTLE_TIME)
+{
+
+}
+
+FileWatcher::~FileWatcher()
+{
+	Stop();
+}
+
+bool FileWatcher::Start(const char* directory, const uint32_t& settleTime)
+{
+	Stop();
+
+	HANDLE handle = CreateFileA(directory, FILE_LIST_DIRECTORY, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, nullptr);
+	if (handle == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+
+	mDirectory = handle;
+	mStopEvent = CreateEventA(nullptr, TRUE, FALSE, nullptr);
+	mSettleTime = settleTime;
+	mThread = std::thread(&FileWatcher::WatchDirectory, this);
+	return true;
+}
+
+void FileWatcher::Stop()
+{
+	if (!mDirectory)
+	{
+		return;
+	}
+
+	SetEvent(mStopEvent);
+	if (mThread.joinable())
+	{
+		mThread.join();
+	}
+
+	CloseHandle(mStopEvent);
+	CloseHandle(mDirectory);
+	mStopEvent = nullptr;
+	mDirectory = nullptr;
+
+	ScopedLock lock(mLock);
+	mChanges.clear();
+}
+
+uint32_t FileWatcher::Poll(std::vector<std::string>& changes)
+{
+	uint64_t now = GetTickCount64();
+	uint32_t count = 0;
+
+	ScopedLock lock(mLock);
+	for (auto it = mChanges.begin(); it != mChanges.end();)
+	{
+		if (now - it->second >= mSettleTime)
+		{
+			changes.push_back(it->first);
+			it = mChanges.erase(it);
+			count++;
+		}
+		else
+		{
+			++it;
+		}
+	}
+
+	return count;
+}
+
+void FileWatcher::WatchDirectory()
+{
+	// DWORD aligned, as ReadDirectoryChangesW requires
+	DWORD buffer[16384];
+
+	OVERLAPPED overlapped = {};
+	overlapped.hEvent = CreateEventA(nullptr, TRUE, FALSE, nullptr);
+
+	HANDLE events[2] = { overlapped.hEvent, mStopEvent };
+	std::string name;
+	std::string path;
+
+	for (;;)
+	{
+		ResetEvent(overlapped.hEvent);
+		if (!ReadDirectoryChangesW(mDirectory, buffer, sizeof(buffer), TRUE, FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_SIZE, nullptr, &overlapped, nullptr))
+		{
+			break;
+		}
+
+		if (WaitForMultipleObjects(2, events, FALSE, INFINITE) != WAIT_OBJECT_0)
+		{
+			CancelIo(mDirectory);
+			GetOverlappedResult(mDirectory, &overlapped, nullptr, TRUE);
+			break;
+		}
+
+		DWORD size = 0;
+		if (!GetOverlappedResult(mDirectory, &overlapped, &size, FALSE) || size == 0)
+		{
+			// Zero bytes means the notification buffer overflowed and this batch is lost; keep watching
+			continue;
+		}
+
+		uint64_t now = GetTickCount64();
+
+		ScopedLock lock(mLock);
+		for (const uint8_t* record = reinterpret_cast<const uint8_t*>(buffer);;)
+		{
+			const FILE_NOTIFY_INFORMATION* information = reinterpret_cast<const FILE_NOTIFY_INFORMATION*>(record);
+			if (information->Action != FILE_ACTION_REMOVED && information->Action != FILE_ACTION_RENAMED_OLD_NAME)
+			{
+				int nameLength = static_cast<int>(information->FileNameLength / sizeof(WCHAR));
+				int length = WideCharToMultiByte(CP_UTF8, 0, information->FileName, nameLength, nullptr, 0, nullptr, nullptr);
+				name.resize(length);
+				WideCharToMultiByte(CP_UTF8, 0, information->FileName, nameLength, &name[0], length, nullptr, nullptr);
+
+				NormalizeWatchPath(name.c_str(), path);
+				mChanges[path] = now;
+			}
+
+			if (information->NextEntryOffset == 0)
+			{
+				break;
+			}
+
+			record += information->NextEntryOffset;
+		}
+	}
+
+	CloseHandle(overlapped.hEvent);
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include "Rig3D/TaskDispatch/TaskDispatcher.h"
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <stdint.h>
+
+#ifdef _WINDLL
+#define RIG3D __declspec(dllexport)
+#else
+#define RIG3D __declspec(dllimport)
+#endif
+
+#define RIG_FILE_WATCHER_SETTLE_TIME 100	// Milliseconds
+
+namespace Rig3D
+{
+	// Watched paths are relative to the watched directory, lower case with forward slashes.
+	inline void NormalizeWatchPath(const char* path, std::string& normalized)
+	{
+		normalized.clear();
+		for (; *path; path++)
+		{
+			char c = *path;
+			normalized.push_back((c == '\\') ? '/' : ((c >= 'A' && c <= 'Z') ? c - 'A' + 'a' : c));
+		}
+	}
+
+	// Reports files changed under a directory tree. A background thread blocks on the OS change notifications, so
+	// nothing is polled on disk. Editors write a file in several steps; a path is reported once it has been quiet for
+	// settleTime milliseconds, and once per burst of writes.
+	class RIG3D FileWatcher
+	{
+	public:
+		FileWatcher();
+		~FileWatcher();
+
+		bool Start(const char* directory, const uint32_t& settleTime = RIG_FILE_WATCHER_SETTLE_TIME);
+		void Stop();
+
+		// Appends paths that have settled since the last call. Returns the number appended.
+		uint32_t Poll(std::vector<std::string>& changes);
+
+		inline bool IsRunning() const { return mDirectory != nullptr; };
+
+	private:
+		cliqCity::multicore::Mutex					mLock;
+		cliqCity::multicore::Thread					mThread;
+		std::unordered_map<std::string, uint64_t>	mChanges;	// Path to time of the last write
+		void*										mDirectory;
+		void*										mStopEvent;
+		uint32_t									mSettleTime;
+
+		void WatchDirectory();
+
+		FileWatcher(FileWatcher const&) = delete;
+		void operator=(FileWatcher const&) = delete;
+	};
+}
@@ -0,0 +1,262 @@
+#pragma once
+#include <algorithm>
+#include <string.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#define RIG_LZ4_HASH_BITS		12
+#define RIG_LZ4_MIN_MATCH		4
+#define RIG_LZ4_MAX_OFFSET		65535
+#define RIG_LZ4_LAST_LITERALS	5	// The format ends every block with at least this many literals
+#define RIG_LZ4_MATCH_LIMIT		12	// and starts no match within this many bytes of the end
+
+// LZ4 block format (no frame header), compatible with the reference decoder. The compressor is the single pass
+// greedy matcher with a 4K entry hash table: roughly 3:1 on text assets such as OBJ and BVH while decoding at memory
+// speed. The decoder validates every length and offset, so a corrupt block fails instead of writing out of bounds.
+namespace Rig3D
+{
+	inline size_t LZ4CompressBound(const size_t& size)
+	{
+		return size + size / 255 + 16;
+	}
+
+	inline uint32_t LZ4Read32(const uint8_t* p)
+	{
+		uint32_t value;
+		memcpy(&value, p, sizeof(value));
+		return value;
+	}
+
+	inline uint32_t LZ4Hash(const uint32_t& sequence)
+	{
+		return (sequence * 2654435761u) >> (32 - RIG_LZ4_HASH_BITS);
+	}
+
+	// Length continuation bytes: 255 while the remainder is at least 255, then the remainder.
+	inline uint8_t* LZ4WriteLength(uint8_t* out, size_t length)
+	{
+		for (; length >= 255; length -= 255)
+		{
+			*out++ = 255;
+		}
+
+		*out++ = static_cast<uint8_t>(length);
+		return out;
+	}
+
+	// Emits literals [anchor, anchor + literalCount) followed by a match (matchLength == 0 for the final sequence).
+	// Returns nullptr when the sequence does not fit before end.
+	inline uint8_t* LZ4WriteSequence(uint8_t* out, const uint8_t* end, const uint8_t* anchor, const size_t& literalCount, const uint32_t& offset, const size_t& matchLength)
+	{
+		size_t required = 1 + literalCount / 255 + 1 + literalCount + 2 + matchLength / 255 + 1;
+		if (required > static_cast<size_t>(end - out))
+		{
+			return nullptr;
+		}
+
+		uint8_t* token = out++;
+		*token = static_cast<uint8_t>((std::min<size_t>)(literalCount, 15) << 4);
+		if (literalCount >= 15)
+		{
+			out = LZ4WriteLength(out, literalCount - 15);
+		}
+
+		memcpy(out, anchor, literalCount);
+		out += literalCount;
+
+		if (matchLength == 0)
+		{
+			return out;
+		}
+
+		*out++ = static_cast<uint8_t>(offset);
+		*out++ = static_cast<uint8_t>(offset >> 8);
+
+		size_t length = matchLength - RIG_LZ4_MIN_MATCH;
+		*token |= static_cast<uint8_t>((std::min<size_t>)(length, 15));
+		if (length >= 15)
+		{
+			out = LZ4WriteLength(out, length - 15);
+		}
+
+		return out;
+	}
+
+	// Compresses size bytes into destination. Returns the compressed size, or 0 when it exceeds capacity; a capacity
+	// of LZ4CompressBound(size) always succeeds.
+	inline size_t LZ4Compress(const void* source, const size_t& size, void* destination, const size_t& capacity)
+	{
+		const uint8_t* input = static_cast<const uint8_t*>(source);
+		uint8_t* out = static_cast<uint8_t*>(destination);
+		uint8_t* outEnd = out + capacity;
+
+		size_t anchor = 0;
+		if (size > RIG_LZ4_MATCH_LIMIT)
+		{
+			uint32_t table[1 << RIG_LZ4_HASH_BITS];
+			memset(table, 0, sizeof(table));
+
+			size_t matchLimit = size - RIG_LZ4_MATCH_LIMIT;
+			size_t ip = 1;
+			while (ip < matchLimit)
+			{
+				uint32_t sequence = LZ4Read32(input + ip);
+				uint32_t hash = LZ4Hash(sequence);
+				size_t candidate = table[hash];
+				table[hash] = static_cast<uint32_t>(ip);
+
+				if (ip - candidate > RIG_LZ4_MAX_OFFSET || LZ4Read32(input + candidate) != sequence)
+				{
+					// Skip faster through data that keeps missing
+					ip += 1 + ((ip - anchor) >> 6);
+					continue;
+				}
+
+				while (ip > anchor && candidate > 0 && input[ip - 1] == input[candidate - 1])
+				{
+					ip--;
+					candidate--;
+				}
+
+				size_t length = RIG_LZ4_MIN_MATCH;
+				while (ip + length < size - RIG_LZ4_LAST_LITERALS && input[ip + length] == input[candidate + length])
+				{
+					length++;
+				}
+
+				out = LZ4WriteSequence(out, outEnd, input + anchor, ip - anchor, static_cast<uint32_t>(ip - candidate), length);
+				if (!out)
+				{
+					return 0;
+				}
+
+				ip += length;
+				anchor = ip;
+
+				if (ip < matchLimit)
+				{
+					table[LZ4Hash(LZ4Read32(input + ip - 2))] = static_cast<uint32_t>(ip - 2);
+				}
+			}
+		}
+
+		out = LZ4WriteSequence(out, outEnd, input + anchor, size - anchor, 0, 0);
+		return out ? out - static_cast<uint8_t*>(destination) : 0;
+	}
+
+	// Decompresses a whole block. Returns the decompressed size, or 0 if the block is malformed or would exceed
+	// capacity.
+	inline size_t LZ4Decompress(const void* source, const size_t& size, void* destination, const size_t& capacity)
+	{
+		const uint8_t* in = static_cast<const uint8_t*>(source);
+		const uint8_t* inEnd = in + size;
+		uint8_t* out = static_cast<uint8_t*>(destination);
+		uint8_t* outEnd = out + capacity;
+
+		for (;;)
+		{
+			if (in >= inEnd)
+			{
+				return 0;
+			}
+
+			uint8_t token = *in++;
+
+			size_t literalCount = token >> 4;
+			if (literalCount == 15)
+			{
+				uint8_t byte;
+				do
+				{
+					if (in >= inEnd)
+					{
+						return 0;
+					}
+
+					byte = *in++;
+					literalCount += byte;
+				} while (byte == 255);
+			}
+
+			if (literalCount > static_cast<size_t>(inEnd - in) || literalCount > static_cast<size_t>(outEnd - out))
+			{
+				return 0;
+			}
+
+			// Short runs copy a fixed 16 bytes when both buffers have the slack; the excess is overwritten later
+			if (literalCount <= 16 && inEnd - in >= 16 && outEnd - out >= 16)
+			{
+				memcpy(out, in, 16);
+			}
+			else
+			{
+				memcpy(out, in, literalCount);
+			}
+
+			in += literalCount;
+			out += literalCount;
+
+			// The final sequence has literals only
+			if (in == inEnd)
+			{
+				break;
+			}
+
+			if (inEnd - in < 2)
+			{
+				return 0;
+			}
+
+			size_t offset = in[0] | (in[1] << 8);
+			in += 2;
+			if (offset == 0 || offset > static_cast<size_t>(out - static_cast<uint8_t*>(destination)))
+			{
+				return 0;
+			}
+
+			size_t length = token & 15;
+			if (length == 15)
+			{
+				uint8_t byte;
+				do
+				{
+					if (in >= inEnd)
+					{
+						return 0;
+					}
+
+					byte = *in++;
+					length += byte;
+				} while (byte == 255);
+			}
+
+			length += RIG_LZ4_MIN_MATCH;
+			if (length > static_cast<size_t>(outEnd - out))
+			{
+				return 0;
+			}
+
+			const uint8_t* match = out - offset;
+			if (offset >= 8 && static_cast<size_t>(outEnd - out) >= length + 8)
+			{
+				// Every 8 byte word is read from output already written, so overlap is safe at this offset
+				for (size_t i = 0; i < length; i += 8)
+				{
+					memcpy(out + i, match + i, 8);
+				}
+
+				out += length;
+			}
+			else
+			{
+				// Overlapping copy repeats the last offset bytes
+				for (size_t i = 0; i < length; i++)
+				{
+					*out++ = match[i];
+				}
+			}
+		}
+
+		return out - static_cast<uint8_t*>(destination);
+	}
+}
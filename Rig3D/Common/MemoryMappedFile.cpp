@@ -0,0 +1,81 @@
+#include "MemoryMappedFile.h"
+#include <Windows.h>
+
+using namespace Rig3D;
+
+MemoryMappedFile::MemoryMappedFile() : mFile(nullptr), mMapping(nullptr), mData(nullptr), mSize(0)
+{
+
+}
+
+MemoryMappedFile::~MemoryMappedFile()
+{
+	Close();
+}
+
+bool MemoryMappedFile::Open(const char* filename)
+{
+	Close();
+
+	HANDLE file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size))
+	{
+		CloseHandle(file);
+		return false;
+	}
+
+	mFile = file;
+	mSize = static_cast<size_t>(size.QuadPart);
+
+	// Empty files cannot be mapped; they open with a null view of size 0
+	if (mSize == 0)
+	{
+		return true;
+	}
+
+	HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (!mapping)
+	{
+		Close();
+		return false;
+	}
+
+	mMapping = mapping;
+	mData = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+	if (!mData)
+	{
+		Close();
+		return false;
+	}
+
+	return true;
+}
+
+void MemoryMappedFile::Close()
+{
+	if (mData)
+	{
+		UnmapViewOfFile(mData);
+		mData = nullptr;
+	}
+
+	if (mMapping)
+	{
+		CloseHandle(mMapping);
+		mMapping = nullptr;
+	}
+
+	if (mFile)
+	{
+		CloseHandle(mFile);
+		mFile = nullptr;
+	}
+
+	mSize = 0;
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef _WINDLL
+#define RIG3D __declspec(dllexport)
+#else
+#define RIG3D __declspec(dllimport)
+#endif
+
+namespace Rig3D
+{
+	// Read only view of a whole file. The mapping lives until Close or destruction; pages are faulted in on
+	// first touch, so parsing straight out of GetData avoids the copy through a stream buffer.
+	class RIG3D MemoryMappedFile
+	{
+	public:
+		MemoryMappedFile();
+		~MemoryMappedFile();
+
+		bool Open(const char* filename);
+		void Close();
+
+		inline const char*	GetData()	const { return mData; };
+		inline size_t		GetSize()	const { return mSize; };
+		inline bool			IsOpen()	const { return mData != nullptr || mFile != nullptr; };
+
+	private:
+		void*		mFile;
+		void*		mMapping;
+		const char*	mData;
+		size_t		mSize;
+
+		MemoryMappedFile(MemoryMappedFile const&) = delete;
+		void operator=(MemoryMappedFile const&) = delete;
+	};
+}
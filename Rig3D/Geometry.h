@@ -1,19 +1,40 @@
 #pragma once
 #define _USE_MATH_DEFINES
+#include "GraphicsMath/cgm.h"
+#include "Rig3D/Graphics/MeshOptimization.h"
 #include <cmath>
 #include <vector>
+#include <unordered_map>
 #include <math.h>
 
+// Procedural meshes. Every generator has a Get*Counts function giving the exact vertex and index counts, a version
+// writing into caller provided arrays of that size (see AllocateGeometry for arenas) and a std::vector version.
+// Vertices are shared wherever position, normal and UV all match and the index buffer is reordered for the vertex
+// cache. Front faces wind clockwise when viewed through a left handed camera. Vertex needs Position (vec3f), Normal
+// (vec3f) and UV (vec2f) members. Index is uint16_t or uint32_t; GetIndexSize on the vertex count from Get*Counts
+// gives the narrowest that fits.
 namespace Rig3D
 {
 	namespace Geometry
 	{
-		template <class Vertex, class Index>
-		void Plane(std::vector<Vertex>& vertices, std::vector<Index>& indices, float width, float depth, uint32_t vertexWidth, uint32_t vertexDepth)
+		template <class Vertex, class Index, class Allocator>
+		void AllocateGeometry(Allocator* allocator, Vertex** vertices, Index** indices, const uint32_t& vertexCount, const uint32_t& indexCount)
 		{
-			vertices.reserve(sizeof(Vertex) * vertexWidth * vertexDepth);
-			indices.reserve(sizeof(Index) * (vertexWidth - 1) * (vertexDepth - 1) * 6);
+			*vertices = reinterpret_cast<Vertex*>(allocator->Allocate(sizeof(Vertex) * vertexCount, alignof(Vertex), 0));
+			*indices = reinterpret_cast<Index*>(allocator->Allocate(sizeof(Index) * indexCount, alignof(Index), 0));
+		}
 
+#pragma region Plane
+
+		inline void GetPlaneCounts(uint32_t vertexWidth, uint32_t vertexDepth, uint32_t& vertexCount, uint32_t& indexCount)
+		{
+			vertexCount = vertexWidth * vertexDepth;
+			indexCount = (vertexWidth - 1) * (vertexDepth - 1) * 6;
+		}
+
+		template <class Vertex, class Index>
+		void Plane(Vertex* vertices, Index* indices, float width, float depth, uint32_t vertexWidth, uint32_t vertexDepth)
+		{
 			float widthStep = width / static_cast<float>(vertexWidth - 1);
 			float depthStep = depth / static_cast<float>(vertexDepth - 1);
 
@@ -24,116 +45,448 @@ namespace Rig3D
 			{
 				for (uint32_t x = 0; x < vertexWidth; x++)
 				{
-					Vertex v0;
+					Vertex& v0 = vertices[(z * vertexWidth) + x];
 					v0.Position = { x * widthStep - halfWidth, 0.0f, z * depthStep - halfDepth };
 					v0.Normal	= { 0.0f, 1.0f, 0.0f };
 					v0.UV = { static_cast<float>(x) / (vertexWidth - 1), 1.0f - (static_cast<float>(z) / (vertexDepth - 1)) };
-					vertices.push_back(v0);
 				}
 			}
 
+			uint32_t i = 0;
 			for (uint32_t z = 0; z < vertexDepth - 1; z++)
 			{
 				for (uint32_t x = 0; x < vertexWidth - 1; x++)
 				{
-					indices.push_back((z * vertexWidth) + x);
-					indices.push_back(((z + 1) * vertexWidth) + x);
-					indices.push_back(((z + 1) * vertexWidth) + x + 1);
-					indices.push_back(((z + 1) * vertexWidth) + x + 1);
-					indices.push_back((z * vertexWidth) + x + 1);
-					indices.push_back((z * vertexWidth) + x);
+					indices[i++] = (z * vertexWidth) + x;
+					indices[i++] = ((z + 1) * vertexWidth) + x;
+					indices[i++] = ((z + 1) * vertexWidth) + x + 1;
+					indices[i++] = ((z + 1) * vertexWidth) + x + 1;
+					indices[i++] = (z * vertexWidth) + x + 1;
+					indices[i++] = (z * vertexWidth) + x;
 				}
 			}
+
+			OptimizeVertexCache(indices, i, vertexWidth * vertexDepth);
 		}
 
 		template <class Vertex, class Index>
-		static void Sphere(std::vector<Vertex>& vertices, std::vector<Index>& indices, uint32_t azimuthSubdivisions, uint32_t polarSubdivisions, float radius)
+		void Plane(std::vector<Vertex>& vertices, std::vector<Index>& indices, float width, float depth, uint32_t vertexWidth, uint32_t vertexDepth)
 		{
-			uint32_t index = 0;
-			float pi = static_cast<float>(M_PI);
+			uint32_t vertexCount, indexCount;
+			GetPlaneCounts(vertexWidth, vertexDepth, vertexCount, indexCount);
 
-			for (uint32_t t = 0; t < polarSubdivisions; t++)
-			{
-				float theta0 = (static_cast<float>(t) / polarSubdivisions) * pi;
-				float theta1 = (static_cast<float>(t + 1) / polarSubdivisions) * pi;
+			vertices.resize(vertexCount);
+			indices.resize(indexCount);
+			Plane(&vertices[0], &indices[0], width, depth, vertexWidth, vertexDepth);
+		}
 
-				for (uint32_t p = 0; p < azimuthSubdivisions; p++)
-				{
-					float phi0 = (static_cast<float>(p) / azimuthSubdivisions) * pi * 2.0f;
-					float phi1 = (static_cast<float>(p + 1) / azimuthSubdivisions) * pi * 2.0f;
+#pragma endregion
+
+#pragma region Sphere
+
+		// UV sphere. The poles get one vertex per column so each pole triangle has its own U, and the seam column is
+		// duplicated. polarSubdivisions must be at least 2.
+		inline void GetSphereCounts(uint32_t azimuthSubdivisions, uint32_t polarSubdivisions, uint32_t& vertexCount, uint32_t& indexCount)
+		{
+			vertexCount = (2 * azimuthSubdivisions) + (polarSubdivisions - 1) * (azimuthSubdivisions + 1);
+			indexCount = (polarSubdivisions - 1) * azimuthSubdivisions * 6;
+		}
 
+		template <class Vertex, class Index>
+		void Sphere(Vertex* vertices, Index* indices, uint32_t azimuthSubdivisions, uint32_t polarSubdivisions, float radius)
+		{
+			float pi = static_cast<float>(M_PI);
+			uint32_t rowSize = azimuthSubdivisions + 1;
+			uint32_t southPole = azimuthSubdivisions + (polarSubdivisions - 1) * rowSize;
 
-					float sinTheta0 = sin(theta0);
-					float cosTheta0 = cos(theta0);
-					float sinPhi0 = sin(phi0);
-					float cosPhi0 = cos(phi0);
+			// Index of ring t (1 to polarSubdivisions - 1), column p
+			auto ring = [azimuthSubdivisions, rowSize](uint32_t t, uint32_t p) { return azimuthSubdivisions + (t - 1) * rowSize + p; };
 
-					float sinTheta1 = sin(theta1);
-					float cosTheta1 = cos(theta1);
-					float sinPhi1 = sin(phi1);
-					float cosPhi1 = cos(phi1);
+			for (uint32_t p = 0; p < azimuthSubdivisions; p++)
+			{
+				float u = (static_cast<float>(p) + 0.5f) / azimuthSubdivisions;
 
-					vec3f n0 = { sinTheta0 * cosPhi0, cosTheta0, sinTheta0 * sinPhi0 };
-					vec3f n1 = { sinTheta0 * cosPhi1, cosTheta0, sinTheta0 * sinPhi1 };
-					vec3f n2 = { sinTheta1 * cosPhi1, cosTheta1, sinTheta1 * sinPhi1 };
-					vec3f n3 = { sinTheta1 * cosPhi0, cosTheta1, sinTheta1 * sinPhi0 };
+				Vertex& north = vertices[p];
+				north.Position	= { 0.0f, radius, 0.0f };
+				north.Normal	= { 0.0f, 1.0f, 0.0f };
+				north.UV		= { u, 0.0f };
 
-					Vertex v0, v1, v2, v3;
-					v0.Position = radius * n0;
-					v1.Position = radius * n1;
-					v2.Position = radius * n2;
-					v3.Position = radius * n3;
+				Vertex& south = vertices[southPole + p];
+				south.Position	= { 0.0f, -radius, 0.0f };
+				south.Normal	= { 0.0f, -1.0f, 0.0f };
+				south.UV		= { u, 1.0f };
+			}
 
-					v0.Normal = n0;
-					v1.Normal = n1;
-					v2.Normal = n2;
-					v3.Normal = n3;
+			for (uint32_t t = 1; t < polarSubdivisions; t++)
+			{
+				float v = static_cast<float>(t) / polarSubdivisions;
+				float theta = v * pi;
+				float sinTheta = sin(theta);
+				float cosTheta = cos(theta);
 
-					v0.UV = { 0.5f + (atan2(n0.z, n0.x) / (2.0f * pi)), 0.5f - (asin(n0.y) / pi) };
-					v0.UV = { 0.5f + (atan2(n1.z, n1.x) / (2.0f * pi)), 0.5f - (asin(n1.y) / pi) };
-					v0.UV = { 0.5f + (atan2(n2.z, n2.x) / (2.0f * pi)), 0.5f - (asin(n2.y) / pi) };
-					v0.UV = { 0.5f + (atan2(n3.z, n3.x) / (2.0f * pi)), 0.5f - (asin(n3.y) / pi) };
+				for (uint32_t p = 0; p <= azimuthSubdivisions; p++)
+				{
+					float u = static_cast<float>(p) / azimuthSubdivisions;
+					float phi = u * pi * 2.0f;
+
+					vec3f n = { sinTheta * cos(phi), cosTheta, sinTheta * sin(phi) };
+
+					Vertex& v0 = vertices[ring(t, p)];
+					v0.Position = radius * n;
+					v0.Normal	= n;
+					v0.UV		= { u, v };
+				}
+			}
 
+			uint32_t i = 0;
+			for (uint32_t t = 0; t < polarSubdivisions; t++)
+			{
+				for (uint32_t p = 0; p < azimuthSubdivisions; p++)
+				{
 					if (t == 0)
 					{
-						vertices.push_back(v3);
-						vertices.push_back(v2);
-						vertices.push_back(v0);
-
-						indices.push_back(index++);
-						indices.push_back(index++);
-						indices.push_back(index++);
+						indices[i++] = ring(1, p);
+						indices[i++] = p;
+						indices[i++] = ring(1, p + 1);
 					}
 					else if (t + 1 == polarSubdivisions)
 					{
-						vertices.push_back(v1);
-						vertices.push_back(v0);
-						vertices.push_back(v2);
-
-						indices.push_back(index++);
-						indices.push_back(index++);
-						indices.push_back(index++);
+						indices[i++] = ring(t, p + 1);
+						indices[i++] = southPole + p;
+						indices[i++] = ring(t, p);
 					}
 					else
 					{
-						vertices.push_back(v3);
-						vertices.push_back(v1);
-						vertices.push_back(v0);
+						indices[i++] = ring(t + 1, p);
+						indices[i++] = ring(t, p);
+						indices[i++] = ring(t, p + 1);
+
+						indices[i++] = ring(t + 1, p);
+						indices[i++] = ring(t, p + 1);
+						indices[i++] = ring(t + 1, p + 1);
+					}
+				}
+			}
 
-						vertices.push_back(v3);
-						vertices.push_back(v2);
-						vertices.push_back(v1);
+			OptimizeVertexCache(indices, i, southPole + azimuthSubdivisions);
+		}
+
+		template <class Vertex, class Index>
+		void Sphere(std::vector<Vertex>& vertices, std::vector<Index>& indices, uint32_t azimuthSubdivisions, uint32_t polarSubdivisions, float radius)
+		{
+			uint32_t vertexCount, indexCount;
+			GetSphereCounts(azimuthSubdivisions, polarSubdivisions, vertexCount, indexCount);
 
-						indices.push_back(index++);
-						indices.push_back(index++);
-						indices.push_back(index++);
+			vertices.resize(vertexCount);
+			indices.resize(indexCount);
+			Sphere(&vertices[0], &indices[0], azimuthSubdivisions, polarSubdivisions, radius);
+		}
 
-						indices.push_back(index++);
-						indices.push_back(index++);
-						indices.push_back(index++);
-					}
+#pragma endregion
+
+#pragma region Icosphere
+
+		// Subdivided icosahedron: near uniform triangles, so fewer vertices than a UV sphere for the same silhouette.
+		// UVs are a spherical projection without a seam split and are only suitable for untextured or tiling use.
+		inline void GetIcosphereCounts(uint32_t subdivisions, uint32_t& vertexCount, uint32_t& indexCount)
+		{
+			uint32_t faceScale = 1u << (2 * subdivisions);
+			vertexCount = 10 * faceScale + 2;
+			indexCount = 60 * faceScale;
+		}
+
+		template <class Vertex, class Index>
+		void Icosphere(Vertex* vertices, Index* indices, uint32_t subdivisions, float radius)
+		{
+			float pi = static_cast<float>(M_PI);
+			float g = (1.0f + sqrtf(5.0f)) * 0.5f;
+
+			uint32_t vertexCount, indexCount;
+			GetIcosphereCounts(subdivisions, vertexCount, indexCount);
+
+			std::vector<vec3f> positions;
+			positions.reserve(vertexCount);
+
+			vec3f corners[12] =
+			{
+				{ -1.0f, g, 0.0f }, { 1.0f, g, 0.0f }, { -1.0f, -g, 0.0f }, { 1.0f, -g, 0.0f },
+				{ 0.0f, -1.0f, g }, { 0.0f, 1.0f, g }, { 0.0f, -1.0f, -g }, { 0.0f, 1.0f, -g },
+				{ g, 0.0f, -1.0f }, { g, 0.0f, 1.0f }, { -g, 0.0f, -1.0f }, { -g, 0.0f, 1.0f }
+			};
+
+			for (uint32_t c = 0; c < 12; c++)
+			{
+				positions.push_back(cliqCity::graphicsMath::normalize(corners[c]));
+			}
+
+			uint32_t faces[60] =
+			{
+				0, 11, 5,	0, 5, 1,	0, 1, 7,	0, 7, 10,	0, 10, 11,
+				1, 5, 9,	5, 11, 4,	11, 10, 2,	10, 7, 6,	7, 1, 8,
+				3, 9, 4,	3, 4, 2,	3, 2, 6,	3, 6, 8,	3, 8, 9,
+				4, 9, 5,	2, 4, 11,	6, 2, 10,	8, 6, 7,	9, 8, 1
+			};
+
+			// Front faces are clockwise in a left handed view, as for the other generators: cross(b - a, c - a) points outward
+			std::vector<uint32_t> source(faces, faces + 60);
+			for (uint32_t f = 0; f < 60; f += 3)
+			{
+				vec3f& a = positions[source[f]];
+				vec3f normal = cliqCity::graphicsMath::cross(positions[source[f + 1]] - a, positions[source[f + 2]] - a);
+				if (cliqCity::graphicsMath::dot(normal, a) < 0.0f)
+				{
+					std::swap(source[f + 1], source[f + 2]);
+				}
+			}
+
+			std::vector<uint32_t> target;
+			std::unordered_map<uint64_t, uint32_t> midpoints;
+
+			auto midpoint = [&positions, &midpoints](uint32_t a, uint32_t b)
+			{
+				uint64_t key = (a < b) ? ((static_cast<uint64_t>(a) << 32) | b) : ((static_cast<uint64_t>(b) << 32) | a);
+
+				auto it = midpoints.find(key);
+				if (it != midpoints.end())
+				{
+					return it->second;
+				}
+
+				uint32_t index = static_cast<uint32_t>(positions.size());
+				positions.push_back(cliqCity::graphicsMath::normalize(positions[a] + positions[b]));
+				midpoints[key] = index;
+				return index;
+			};
+
+			for (uint32_t s = 0; s < subdivisions; s++)
+			{
+				target.clear();
+				target.reserve(source.size() * 4);
+				midpoints.clear();
+				midpoints.reserve(source.size() / 2);
+
+				for (uint32_t f = 0; f < source.size(); f += 3)
+				{
+					uint32_t a = source[f];
+					uint32_t b = source[f + 1];
+					uint32_t c = source[f + 2];
+					uint32_t ab = midpoint(a, b);
+					uint32_t bc = midpoint(b, c);
+					uint32_t ca = midpoint(c, a);
+
+					uint32_t split[12] = { a, ab, ca,	ab, b, bc,	ca, bc, c,	ab, bc, ca };
+					target.insert(target.end(), split, split + 12);
+				}
+
+				source.swap(target);
+			}
+
+			for (uint32_t v = 0; v < vertexCount; v++)
+			{
+				vec3f& n = positions[v];
+				float u = atan2(n.z, n.x) / (2.0f * pi);
+
+				vertices[v].Position	= radius * n;
+				vertices[v].Normal		= n;
+				vertices[v].UV			= { (u < 0.0f) ? u + 1.0f : u, acos(n.y) / pi };
+			}
+
+			for (uint32_t i = 0; i < indexCount; i++)
+			{
+				indices[i] = static_cast<Index>(source[i]);
+			}
+
+			OptimizeVertexCache(indices, indexCount, vertexCount);
+		}
+
+		template <class Vertex, class Index>
+		void Icosphere(std::vector<Vertex>& vertices, std::vector<Index>& indices, uint32_t subdivisions, float radius)
+		{
+			uint32_t vertexCount, indexCount;
+			GetIcosphereCounts(subdivisions, vertexCount, indexCount);
+
+			vertices.resize(vertexCount);
+			indices.resize(indexCount);
+			Icosphere(&vertices[0], &indices[0], subdivisions, radius);
+		}
+
+#pragma endregion
+
+#pragma region Cube
+
+		// Four vertices per face so normals and UVs stay flat.
+		inline void GetCubeCounts(uint32_t& vertexCount, uint32_t& indexCount)
+		{
+			vertexCount = 24;
+			indexCount = 36;
+		}
+
+		template <class Vertex, class Index>
+		void Cube(Vertex* vertices, Index* indices, float size)
+		{
+			float h = size * 0.5f;
+
+			// Normal, then the face's U and V axes
+			vec3f axes[6][3] =
+			{
+				{ {  1.0f, 0.0f, 0.0f }, { 0.0f, 0.0f,  1.0f }, { 0.0f, -1.0f, 0.0f } },
+				{ { -1.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, -1.0f }, { 0.0f, -1.0f, 0.0f } },
+				{ { 0.0f,  1.0f, 0.0f }, { 1.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, -1.0f } },
+				{ { 0.0f, -1.0f, 0.0f }, { 1.0f, 0.0f, 0.0f }, { 0.0f, 0.0f,  1.0f } },
+				{ { 0.0f, 0.0f,  1.0f }, { -1.0f, 0.0f, 0.0f }, { 0.0f, -1.0f, 0.0f } },
+				{ { 0.0f, 0.0f, -1.0f }, {  1.0f, 0.0f, 0.0f }, { 0.0f, -1.0f, 0.0f } }
+			};
+
+			float corners[4][2] = { { 0.0f, 0.0f }, { 1.0f, 0.0f }, { 1.0f, 1.0f }, { 0.0f, 1.0f } };
+
+			for (uint32_t f = 0; f < 6; f++)
+			{
+				vec3f& n = axes[f][0];
+				vec3f& u = axes[f][1];
+				vec3f& v = axes[f][2];
+
+				for (uint32_t c = 0; c < 4; c++)
+				{
+					Vertex& v0 = vertices[f * 4 + c];
+					v0.Position = h * n + ((corners[c][0] * 2.0f - 1.0f) * h) * u + ((corners[c][1] * 2.0f - 1.0f) * h) * v;
+					v0.Normal	= n;
+					v0.UV		= { corners[c][0], corners[c][1] };
+				}
+
+				Index base = static_cast<Index>(f * 4);
+				Index* face = indices + f * 6;
+				face[0] = base;
+				face[1] = base + 1;
+				face[2] = base + 2;
+				face[3] = base;
+				face[4] = base + 2;
+				face[5] = base + 3;
+			}
+
+			OptimizeVertexCache(indices, 36, 24);
+		}
+
+		template <class Vertex, class Index>
+		void Cube(std::vector<Vertex>& vertices, std::vector<Index>& indices, float size)
+		{
+			uint32_t vertexCount, indexCount;
+			GetCubeCounts(vertexCount, indexCount);
+
+			vertices.resize(vertexCount);
+			indices.resize(indexCount);
+			Cube(&vertices[0], &indices[0], size);
+		}
+
+#pragma endregion
+
+#pragma region Cylinder
+
+		// Y aligned and centered on the origin. The side is a (azimuthSubdivisions + 1) x (heightSubdivisions + 1)
+		// grid with a duplicated seam; each cap is a fan around a center vertex with its own rim.
+		inline void GetCylinderCounts(uint32_t azimuthSubdivisions, uint32_t heightSubdivisions, uint32_t& vertexCount, uint32_t& indexCount)
+		{
+			vertexCount = (azimuthSubdivisions + 1) * (heightSubdivisions + 1) + 2 * (azimuthSubdivisions + 1);
+			indexCount = azimuthSubdivisions * heightSubdivisions * 6 + azimuthSubdivisions * 6;
+		}
+
+		template <class Vertex, class Index>
+		void Cylinder(Vertex* vertices, Index* indices, uint32_t azimuthSubdivisions, uint32_t heightSubdivisions, float radius, float height)
+		{
+			float pi = static_cast<float>(M_PI);
+			float halfHeight = height * 0.5f;
+			uint32_t rowSize = azimuthSubdivisions + 1;
+
+			uint32_t vertexCount, indexCount;
+			GetCylinderCounts(azimuthSubdivisions, heightSubdivisions, vertexCount, indexCount);
+
+			for (uint32_t h = 0; h <= heightSubdivisions; h++)
+			{
+				float v = static_cast<float>(h) / heightSubdivisions;
+
+				for (uint32_t p = 0; p <= azimuthSubdivisions; p++)
+				{
+					float u = static_cast<float>(p) / azimuthSubdivisions;
+					float phi = u * pi * 2.0f;
+					vec3f n = { cos(phi), 0.0f, sin(phi) };
+
+					Vertex& v0 = vertices[h * rowSize + p];
+					v0.Position = { radius * n.x, halfHeight - v * height, radius * n.z };
+					v0.Normal	= n;
+					v0.UV		= { u, v };
+				}
+			}
+
+			// Caps: center followed by azimuthSubdivisions rim vertices, top then bottom
+			uint32_t caps = rowSize * (heightSubdivisions + 1);
+			for (uint32_t c = 0; c < 2; c++)
+			{
+				float y = (c == 0) ? halfHeight : -halfHeight;
+				float ny = (c == 0) ? 1.0f : -1.0f;
+				Vertex* cap = vertices + caps + c * rowSize;
+
+				cap[0].Position = { 0.0f, y, 0.0f };
+				cap[0].Normal	= { 0.0f, ny, 0.0f };
+				cap[0].UV		= { 0.5f, 0.5f };
+
+				for (uint32_t p = 0; p < azimuthSubdivisions; p++)
+				{
+					float phi = (static_cast<float>(p) / azimuthSubdivisions) * pi * 2.0f;
+					float x = cos(phi);
+					float z = sin(phi);
+
+					cap[p + 1].Position = { radius * x, y, radius * z };
+					cap[p + 1].Normal	= { 0.0f, ny, 0.0f };
+					cap[p + 1].UV		= { 0.5f + x * 0.5f, 0.5f - z * ny * 0.5f };
 				}
 			}
+
+			uint32_t i = 0;
+			for (uint32_t h = 0; h < heightSubdivisions; h++)
+			{
+				for (uint32_t p = 0; p < azimuthSubdivisions; p++)
+				{
+					uint32_t v0 = h * rowSize + p;
+					uint32_t v1 = v0 + 1;
+					uint32_t v2 = v1 + rowSize;
+					uint32_t v3 = v0 + rowSize;
+
+					indices[i++] = v3;
+					indices[i++] = v0;
+					indices[i++] = v1;
+
+					indices[i++] = v3;
+					indices[i++] = v1;
+					indices[i++] = v2;
+				}
+			}
+
+			for (uint32_t p = 0; p < azimuthSubdivisions; p++)
+			{
+				uint32_t next = (p + 1) % azimuthSubdivisions;
+
+				indices[i++] = caps;
+				indices[i++] = caps + 1 + next;
+				indices[i++] = caps + 1 + p;
+
+				indices[i++] = caps + rowSize;
+				indices[i++] = caps + rowSize + 1 + p;
+				indices[i++] = caps + rowSize + 1 + next;
+			}
+
+			OptimizeVertexCache(indices, indexCount, vertexCount);
+		}
+
+		template <class Vertex, class Index>
+		void Cylinder(std::vector<Vertex>& vertices, std::vector<Index>& indices, uint32_t azimuthSubdivisions, uint32_t heightSubdivisions, float radius, float height)
+		{
+			uint32_t vertexCount, indexCount;
+			GetCylinderCounts(azimuthSubdivisions, heightSubdivisions, vertexCount, indexCount);
+
+			vertices.resize(vertexCount);
+			indices.resize(indexCount);
+			Cylinder(&vertices[0], &indices[0], azimuthSubdivisions, heightSubdivisions, radius, height);
 		}
+
+#pragma endregion
 	}
-}
\ No newline at end of file
+}
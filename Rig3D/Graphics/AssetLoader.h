@@ -0,0 +1,124 @@
+#pragma once
+#include "Rig3D/TaskDispatch/TaskDispatcher.h"
+#include "Rig3D/TaskDispatch/CompletionQueue.h"
+#include <atomic>
+#include <stdint.h>
+
+#define RIG_ASSET_LOADER_CAPACITY 64
+
+// Background mesh loading split in two: workers run Resource::Load (file read, parse, optimization) into the
+// request's staging vectors, then push the request onto a lock free completion queue. The thread owning the renderer
+// drains the queue with Upload, which creates GPU buffers through MeshLibrary::UploadMesh. Nothing on the worker side
+// touches the renderer or the mesh library allocator, so parses never serialize on a lock and the upload side can be
+// exercised with any renderer type, including a null one.
+namespace Rig3D
+{
+	class IMesh;
+
+	template<class Resource>
+	struct AssetRequest
+	{
+		Resource	resource;	// Staging memory; holds the parsed mesh until the owner is done with it
+		IMesh**		mesh;
+		void*		userData;
+		bool		loaded;
+
+		AssetRequest() : mesh(nullptr), userData(nullptr), loaded(false) {};
+	};
+
+	template<class Resource, uint32_t Capacity = RIG_ASSET_LOADER_CAPACITY>
+	class AssetLoader
+	{
+	public:
+		typedef AssetRequest<Resource> Request;
+
+		// Without a dispatcher, Load parses on the calling thread and Upload still hands results over.
+		AssetLoader(cliqCity::multicore::TaskDispatcher* dispatcher) : mDispatcher(dispatcher), mPendingCount(0)
+		{
+
+		}
+
+		AssetLoader() : AssetLoader(nullptr)
+		{
+
+		}
+
+		// Queues request for parsing. Each queued request holds one dispatcher task until parsed, and AddTask does not
+		// check for an exhausted task pool, so Capacity must fit in the dispatcher's task memory. Fails when Capacity
+		// requests are already in flight; request must stay alive until Upload returns it.
+		bool Load(Request* request)
+		{
+			if (mPendingCount.fetch_add(1, std::memory_order_relaxed) >= Capacity)
+			{
+				mPendingCount.fetch_sub(1, std::memory_order_relaxed);
+				return false;
+			}
+
+			request->loaded = false;
+
+			cliqCity::multicore::TaskData data;
+			data.mKernelData = request;
+			data.mStream.in[0] = this;
+
+			if (mDispatcher)
+			{
+				mDispatcher->AddTask(data, PerformLoadTask);
+			}
+			else
+			{
+				PerformLoadTask(data);
+			}
+
+			return true;
+		}
+
+		// Owner thread. Uploads up to maxCount parsed requests and writes them to completed (optional) in completion
+		// order. Requests whose Load or upload failed (an empty mesh) are returned with loaded == false and no mesh.
+		// Returns the count handled.
+		template<class Library, class Renderer>
+		uint32_t Upload(Library& library, Renderer* renderer, Request** completed, const uint32_t& maxCount)
+		{
+			uint32_t count = 0;
+			Request* request;
+			while (count < maxCount && mCompleted.TryPop(request))
+			{
+				if (request->loaded)
+				{
+					request->loaded = library.UploadMesh(request->mesh, renderer, request->resource);
+				}
+
+				if (completed)
+				{
+					completed[count] = request;
+				}
+
+				count++;
+				mPendingCount.fetch_sub(1, std::memory_order_relaxed);
+			}
+
+			return count;
+		}
+
+		// Requests queued but not yet returned by Upload.
+		inline uint32_t GetPendingCount() const { return mPendingCount.load(std::memory_order_relaxed); };
+
+	private:
+		cliqCity::multicore::TaskDispatcher*					mDispatcher;
+		cliqCity::multicore::CompletionQueue<Request*, Capacity>	mCompleted;
+		std::atomic<uint32_t>									mPendingCount;
+
+		static void PerformLoadTask(const cliqCity::multicore::TaskData& data)
+		{
+			Request* request = reinterpret_cast<Request*>(data.mKernelData);
+			AssetLoader* loader = reinterpret_cast<AssetLoader*>(data.mStream.in[0]);
+
+			request->loaded = request->resource.Load();
+
+			// Cannot fail: Load admits at most Capacity requests until Upload pops them
+			loader->mCompleted.TryPush(request);
+		}
+
+		AssetLoader(AssetLoader const&) = delete;
+		void operator=(AssetLoader const&) = delete;
+	};
+}
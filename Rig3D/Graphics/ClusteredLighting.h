@@ -0,0 +1,439 @@
+#pragma once
+#include "GraphicsMath/cgm.h"
+#include "Rig3D/Parametric.h"
+#include "Rig3D/TaskDispatch/TaskDispatcher.h"
+#include <vector>
+#include <math.h>
+#include <string.h>
+
+// CPU clustered light assignment. The view frustum is split into a dimensionX x dimensionY x dimensionZ grid of
+// froxels with exponential depth slices. Every light is tested against the view space bounds of the froxels it can
+// reach and each cluster ends up with a compact range in a shared light index list. Slices are independent, so
+// assignment splits across tasks by slice range without atomics.
+//
+// Cluster index = (slice * dimensionY + row) * dimensionX + column. Columns count left to right and rows bottom to
+// top in NDC; slice = floor(log(viewZ / nearZ) * sliceScale). Shaders derive the same index from screen position
+// and view depth.
+namespace Rig3D
+{
+	// GPU layout: float3 + float, float4.
+	struct ClusteredLight
+	{
+		vec3f	position;
+		float	radius;
+		vec4f	color;
+	};
+
+	struct LightCluster
+	{
+		uint32_t offset;
+		uint32_t count;
+	};
+
+	struct ClusterStatistics
+	{
+		uint32_t inputLights;			// Lights submitted
+		uint32_t visibleLights;			// Lights inside the view frustum (size of the light buffer)
+		uint32_t lightIndices;			// Total light - cluster references
+		uint32_t maxLightsPerCluster;
+
+		ClusterStatistics() : inputLights(0), visibleLights(0), lightIndices(0), maxLightsPerCluster(0) {};
+	};
+
+	struct ClusterGrid
+	{
+		std::vector<AABB<vec3f>>	bounds;			// View space froxel bounds, one per cluster
+		std::vector<LightCluster>	clusters;		// Upload: one per cluster
+		std::vector<uint32_t>		lightIndices;	// Upload: indices into lights
+		std::vector<ClusteredLight>	lights;			// Upload: visible lights, world space
+		std::vector<vec4f>			viewLights;		// View space center and radius of each visible light
+		std::vector<uint32_t>		lightSlices;	// First and last slice of each visible light
+		std::vector<float>			sliceDepths;	// dimensionZ + 1 slice boundaries
+		ClusterStatistics			statistics;
+		uint32_t					dimensionX;
+		uint32_t					dimensionY;
+		uint32_t					dimensionZ;
+		float						nearZ;
+		float						farZ;
+		float						tanHalfFovX;
+		float						tanHalfFovY;
+		float						sliceScale;
+
+		ClusterGrid() : dimensionX(0), dimensionY(0), dimensionZ(0), nearZ(0), farZ(0), tanHalfFovX(0), tanHalfFovY(0), sliceScale(0) {};
+	};
+
+	// One task's share of a parallel assignment: slices [firstSlice, firstSlice + sliceCount). Indices are
+	// gathered locally and merged afterwards, so the vectors keep their capacity from frame to frame.
+	struct ClusterAssignRange
+	{
+		ClusterGrid*				grid;
+		std::vector<uint32_t>		indices;
+		std::vector<uint32_t>		pairs;
+		std::vector<uint32_t>		cursors;
+		uint32_t					firstSlice;
+		uint32_t					sliceCount;
+		cliqCity::multicore::TaskID	taskID;
+	};
+
+#pragma region Grid
+
+	inline uint32_t GetClusterSlice(const ClusterGrid& grid, const float& viewZ)
+	{
+		if (viewZ <= grid.nearZ)
+		{
+			return 0;
+		}
+
+		int32_t slice = static_cast<int32_t>(logf(viewZ / grid.nearZ) * grid.sliceScale);
+		return static_cast<uint32_t>(min(max(slice, 0), static_cast<int32_t>(grid.dimensionZ) - 1));
+	}
+
+	inline uint32_t GetClusterIndex(const ClusterGrid& grid, const uint32_t& column, const uint32_t& row, const uint32_t& slice)
+	{
+		return (slice * grid.dimensionY + row) * grid.dimensionX + column;
+	}
+
+	// Only depends on the projection; rebuild when the field of view, aspect ratio or clip planes change.
+	inline void InitializeClusterGrid(ClusterGrid& grid, const uint32_t& dimensionX, const uint32_t& dimensionY, const uint32_t& dimensionZ, const float& fovY, const float& aspectRatio, const float& nearZ, const float& farZ)
+	{
+		grid.dimensionX = dimensionX;
+		grid.dimensionY = dimensionY;
+		grid.dimensionZ = dimensionZ;
+		grid.nearZ = nearZ;
+		grid.farZ = farZ;
+		grid.tanHalfFovY = tanf(fovY * 0.5f);
+		grid.tanHalfFovX = grid.tanHalfFovY * aspectRatio;
+		grid.sliceScale = dimensionZ / logf(farZ / nearZ);
+
+		grid.sliceDepths.resize(dimensionZ + 1);
+		for (uint32_t k = 0; k <= dimensionZ; k++)
+		{
+			grid.sliceDepths[k] = nearZ * powf(farZ / nearZ, static_cast<float>(k) / dimensionZ);
+		}
+
+		grid.bounds.resize(dimensionX * dimensionY * dimensionZ);
+		grid.clusters.resize(dimensionX * dimensionY * dimensionZ);
+
+		for (uint32_t k = 0; k < dimensionZ; k++)
+		{
+			float zNear = grid.sliceDepths[k];
+			float zFar = grid.sliceDepths[k + 1];
+
+			for (uint32_t i = 0; i < dimensionY; i++)
+			{
+				float bottom = (-1.0f + 2.0f * i / dimensionY) * grid.tanHalfFovY;
+				float top = (-1.0f + 2.0f * (i + 1) / dimensionY) * grid.tanHalfFovY;
+
+				for (uint32_t j = 0; j < dimensionX; j++)
+				{
+					float left = (-1.0f + 2.0f * j / dimensionX) * grid.tanHalfFovX;
+					float right = (-1.0f + 2.0f * (j + 1) / dimensionX) * grid.tanHalfFovX;
+
+					vec3f minimum = { min(left * zNear, left * zFar), min(bottom * zNear, bottom * zFar), zNear };
+					vec3f maximum = { max(right * zNear, right * zFar), max(top * zNear, top * zFar), zFar };
+
+					AABB<vec3f>& aabb = grid.bounds[GetClusterIndex(grid, j, i, k)];
+					aabb.origin = (minimum + maximum) * 0.5f;
+					aabb.halfSize = (maximum - minimum) * 0.5f;
+				}
+			}
+		}
+	}
+
+#pragma endregion
+
+#pragma region Assignment
+
+	// Moves lights to view space, drops the ones outside the frustum and fills the light buffer.
+	// view is a row vector world to view matrix.
+	inline void PrepareClusterLights(ClusterGrid& grid, const ClusteredLight* lights, const uint32_t& count, const mat4f& view)
+	{
+		grid.lights.clear();
+		grid.viewLights.clear();
+		grid.lightSlices.clear();
+
+		// Side plane normals through the eye, pointing inwards.
+		float inverseX = 1.0f / sqrtf(1.0f + grid.tanHalfFovX * grid.tanHalfFovX);
+		float inverseY = 1.0f / sqrtf(1.0f + grid.tanHalfFovY * grid.tanHalfFovY);
+		float sideX = grid.tanHalfFovX * inverseX;
+		float sideY = grid.tanHalfFovY * inverseY;
+
+		for (uint32_t i = 0; i < count; i++)
+		{
+			const vec3f& p = lights[i].position;
+			float r = lights[i].radius;
+
+			vec3f c =
+			{
+				p.x * view[0][0] + p.y * view[1][0] + p.z * view[2][0] + view[3][0],
+				p.x * view[0][1] + p.y * view[1][1] + p.z * view[2][1] + view[3][1],
+				p.x * view[0][2] + p.y * view[1][2] + p.z * view[2][2] + view[3][2]
+			};
+
+			if (c.z + r < grid.nearZ || c.z - r > grid.farZ)
+			{
+				continue;
+			}
+
+			float zTerm = c.z * sideX;
+			float yTerm = c.z * sideY;
+			if (zTerm - c.x * inverseX < -r || zTerm + c.x * inverseX < -r || yTerm - c.y * inverseY < -r || yTerm + c.y * inverseY < -r)
+			{
+				continue;
+			}
+
+			grid.lights.push_back(lights[i]);
+			grid.viewLights.push_back(vec4f(c, r));
+			grid.lightSlices.push_back(GetClusterSlice(grid, c.z - r));
+			grid.lightSlices.push_back(GetClusterSlice(grid, c.z + r));
+		}
+
+		grid.statistics.inputLights = count;
+		grid.statistics.visibleLights = static_cast<uint32_t>(grid.lights.size());
+	}
+
+	inline bool IntersectClusterSphere(const AABB<vec3f>& aabb, const vec4f& sphere)
+	{
+		float distanceSquared = 0.0f;
+		for (int e = 0; e < 3; e++)
+		{
+			float d = fabsf(sphere[e] - aabb.origin[e]) - aabb.halfSize[e];
+			if (d > 0.0f)
+			{
+				distanceSquared += d * d;
+			}
+		}
+
+		return distanceSquared <= sphere.w * sphere.w;
+	}
+
+	// Fills clusters and range.indices for the range's slices. Cluster offsets are local to range.indices
+	// until MergeClusterRanges rebases them.
+	inline void AssignClusterSlices(ClusterAssignRange& range)
+	{
+		ClusterGrid& grid = *range.grid;
+		range.indices.clear();
+
+		uint32_t lightCount = static_cast<uint32_t>(grid.viewLights.size());
+		uint32_t sliceSize = grid.dimensionX * grid.dimensionY;
+		uint32_t end = range.firstSlice + range.sliceCount;
+
+		range.cursors.resize(sliceSize);
+
+		for (uint32_t k = range.firstSlice; k < end; k++)
+		{
+			uint32_t first = GetClusterIndex(grid, 0, 0, k);
+			for (uint32_t c = 0; c < sliceSize; c++)
+			{
+				grid.clusters[first + c].count = 0;
+			}
+
+			// Light major: each light only visits the rows and columns its sphere overlaps, recording
+			// (cluster, light) pairs. Lights are visited in order so each cluster's list stays sorted.
+			range.pairs.clear();
+			for (uint32_t l = 0; l < lightCount; l++)
+			{
+				if (grid.lightSlices[l * 2] > k || k > grid.lightSlices[l * 2 + 1])
+				{
+					continue;
+				}
+
+				const vec4f& sphere = grid.viewLights[l];
+
+				uint32_t column0 = grid.dimensionX, column1 = 0;
+				for (uint32_t j = 0; j < grid.dimensionX; j++)
+				{
+					const AABB<vec3f>& aabb = grid.bounds[first + j];
+					if (fabsf(sphere.x - aabb.origin.x) <= aabb.halfSize.x + sphere.w)
+					{
+						column0 = min(column0, j);
+						column1 = j;
+					}
+				}
+
+				uint32_t row0 = grid.dimensionY, row1 = 0;
+				for (uint32_t i = 0; i < grid.dimensionY; i++)
+				{
+					const AABB<vec3f>& aabb = grid.bounds[first + i * grid.dimensionX];
+					if (fabsf(sphere.y - aabb.origin.y) <= aabb.halfSize.y + sphere.w)
+					{
+						row0 = min(row0, i);
+						row1 = i;
+					}
+				}
+
+				for (uint32_t i = row0; i <= row1 && row0 < grid.dimensionY; i++)
+				{
+					for (uint32_t j = column0; j <= column1 && column0 < grid.dimensionX; j++)
+					{
+						uint32_t local = i * grid.dimensionX + j;
+						if (IntersectClusterSphere(grid.bounds[first + local], sphere))
+						{
+							range.pairs.push_back(local);
+							range.pairs.push_back(l);
+							grid.clusters[first + local].count++;
+						}
+					}
+				}
+			}
+
+			// Counting sort of the pairs into contiguous per cluster lists.
+			uint32_t offset = static_cast<uint32_t>(range.indices.size());
+			for (uint32_t c = 0; c < sliceSize; c++)
+			{
+				grid.clusters[first + c].offset = offset;
+				range.cursors[c] = offset;
+				offset += grid.clusters[first + c].count;
+			}
+
+			range.indices.resize(offset);
+			for (size_t p = 0; p < range.pairs.size(); p += 2)
+			{
+				range.indices[range.cursors[range.pairs[p]]++] = range.pairs[p + 1];
+			}
+		}
+	}
+
+	inline void PerformClusterAssignTask(const cliqCity::multicore::TaskData& data)
+	{
+		AssignClusterSlices(*reinterpret_cast<ClusterAssignRange*>(data.mKernelData));
+	}
+
+	// Concatenates the per range index lists in slice order and rebases cluster offsets. Output is identical
+	// regardless of how the slices were split.
+	inline void MergeClusterRanges(ClusterGrid& grid, ClusterAssignRange* ranges, const uint32_t& rangeCount)
+	{
+		grid.lightIndices.clear();
+		grid.statistics.maxLightsPerCluster = 0;
+
+		uint32_t sliceSize = grid.dimensionX * grid.dimensionY;
+		for (uint32_t r = 0; r < rangeCount; r++)
+		{
+			uint32_t base = static_cast<uint32_t>(grid.lightIndices.size());
+			uint32_t first = ranges[r].firstSlice * sliceSize;
+			uint32_t end = first + ranges[r].sliceCount * sliceSize;
+
+			for (uint32_t c = first; c < end; c++)
+			{
+				grid.clusters[c].offset += base;
+				grid.statistics.maxLightsPerCluster = max(grid.statistics.maxLightsPerCluster, grid.clusters[c].count);
+			}
+
+			grid.lightIndices.insert(grid.lightIndices.end(), ranges[r].indices.begin(), ranges[r].indices.end());
+		}
+
+		grid.statistics.lightIndices = static_cast<uint32_t>(grid.lightIndices.size());
+	}
+
+	inline void AssignLights(ClusterGrid& grid, const ClusteredLight* lights, const uint32_t& count, const mat4f& view, ClusterAssignRange& range)
+	{
+		PrepareClusterLights(grid, lights, count, view);
+
+		range.grid = &grid;
+		range.firstSlice = 0;
+		range.sliceCount = grid.dimensionZ;
+		AssignClusterSlices(range);
+
+		MergeClusterRanges(grid, &range, 1);
+	}
+
+	// Splits the depth slices across at most rangeCount tasks and waits for them. ranges is caller owned
+	// and should persist between frames so its vectors are not reallocated.
+	inline void AssignLightsParallel(cliqCity::multicore::TaskDispatcher& dispatcher, ClusterGrid& grid, const ClusteredLight* lights, const uint32_t& count, const mat4f& view, ClusterAssignRange* ranges, const uint32_t& rangeCount)
+	{
+		PrepareClusterLights(grid, lights, count, view);
+
+		uint32_t rangeSize = (grid.dimensionZ + rangeCount - 1) / rangeCount;
+
+		cliqCity::multicore::TaskData data;
+		uint32_t taskCount = 0;
+		for (uint32_t first = 0; first < grid.dimensionZ; first += rangeSize, taskCount++)
+		{
+			ClusterAssignRange& range = ranges[taskCount];
+			range.grid = &grid;
+			range.firstSlice = first;
+			range.sliceCount = min(rangeSize, grid.dimensionZ - first);
+
+			data.mKernelData = &range;
+			range.taskID = dispatcher.AddTask(data, PerformClusterAssignTask);
+		}
+
+		for (uint32_t i = 0; i < taskCount; i++)
+		{
+			dispatcher.WaitForTask(ranges[i].taskID);
+		}
+
+		MergeClusterRanges(grid, ranges, taskCount);
+	}
+
+	// Brute force reference for debug builds. Rebuilds every froxel from the grid parameters and tests every visible
+	// light against it with a closest point test, sharing neither the slice ranges, the row and column scans nor
+	// IntersectClusterSphere with the assignment. Each cluster must list its lights once, in ascending order, and
+	// exactly the ones that overlap it; lights within a relative 1e-3 of touching may go either way.
+	inline bool ValidateLightClusters(const ClusterGrid& grid)
+	{
+		uint32_t lightCount = static_cast<uint32_t>(grid.viewLights.size());
+		std::vector<uint8_t> listed(lightCount);
+
+		for (uint32_t k = 0; k < grid.dimensionZ; k++)
+		{
+			float zNear = grid.nearZ * powf(grid.farZ / grid.nearZ, static_cast<float>(k) / grid.dimensionZ);
+			float zFar = grid.nearZ * powf(grid.farZ / grid.nearZ, static_cast<float>(k + 1) / grid.dimensionZ);
+
+			for (uint32_t i = 0; i < grid.dimensionY; i++)
+			{
+				for (uint32_t j = 0; j < grid.dimensionX; j++)
+				{
+					// Froxel corners lie on the side planes through the eye, so the box spans both depths.
+					float x0 = (-1.0f + 2.0f * j / grid.dimensionX) * grid.tanHalfFovX;
+					float x1 = (-1.0f + 2.0f * (j + 1) / grid.dimensionX) * grid.tanHalfFovX;
+					float y0 = (-1.0f + 2.0f * i / grid.dimensionY) * grid.tanHalfFovY;
+					float y1 = (-1.0f + 2.0f * (i + 1) / grid.dimensionY) * grid.tanHalfFovY;
+
+					vec3f minimum = { min(x0 * zNear, x0 * zFar), min(y0 * zNear, y0 * zFar), zNear };
+					vec3f maximum = { max(x1 * zNear, x1 * zFar), max(y1 * zNear, y1 * zFar), zFar };
+
+					const LightCluster& cluster = grid.clusters[(k * grid.dimensionY + i) * grid.dimensionX + j];
+					if (cluster.offset + cluster.count > grid.lightIndices.size())
+					{
+						return false;
+					}
+
+					memset(listed.data(), 0, lightCount);
+					for (uint32_t c = 0; c < cluster.count; c++)
+					{
+						uint32_t l = grid.lightIndices[cluster.offset + c];
+						if (l >= lightCount || (c > 0 && l <= grid.lightIndices[cluster.offset + c - 1]))
+						{
+							return false;
+						}
+
+						listed[l] = 1;
+					}
+
+					for (uint32_t l = 0; l < lightCount; l++)
+					{
+						const vec4f& sphere = grid.viewLights[l];
+
+						float distanceSquared = 0.0f;
+						for (int e = 0; e < 3; e++)
+						{
+							float closest = max(minimum[e], min(sphere[e], maximum[e]));
+							distanceSquared += (sphere[e] - closest) * (sphere[e] - closest);
+						}
+
+						float radiusSquared = sphere.w * sphere.w;
+						if ((distanceSquared < radiusSquared * 0.999f && !listed[l]) || (distanceSquared > radiusSquared * 1.001f && listed[l]))
+						{
+							return false;
+						}
+					}
+				}
+			}
+		}
+
+		return true;
+	}
+
+#pragma endregion
+}
@@ -3,7 +3,7 @@
 
 using namespace Rig3D;
 
-DX11Mesh::DX11Mesh() : mVertexBuffer(nullptr), mIndexBuffer(nullptr)
+DX11Mesh::DX11Mesh() : mVertexBuffer(nullptr), mAttributeBuffer(nullptr), mIndexBuffer(nullptr)
 {
 
 }
@@ -11,5 +11,6 @@ DX11Mesh::DX11Mesh() : mVertexBuffer(nullptr), mIndexBuffer(nullptr)
 DX11Mesh::~DX11Mesh()
 {
 	ReleaseMacro(mVertexBuffer);
+	ReleaseMacro(mAttributeBuffer);
 	ReleaseMacro(mIndexBuffer);
 }
@@ -20,6 +20,7 @@ namespace Rig3D
 
 	protected:
 		ID3D11Buffer*	mVertexBuffer;
+		ID3D11Buffer*	mAttributeBuffer;
 		ID3D11Buffer*	mIndexBuffer;
 		
 		friend class DX3D11Renderer;
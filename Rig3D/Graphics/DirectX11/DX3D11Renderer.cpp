@@ -8,6 +8,7 @@
 #include "Rig3D\Graphics\DirectX11\DirectXTK\Inc\DDSTextureLoader.h"
 #include <WindowsX.h>
 #include <sstream>
+#include <utility>
 #include <d3dcompiler.h>
 #include <d3d11shader.h>
 
@@ -293,13 +294,13 @@ void DX3D11Renderer::VCreateDynamicVertexBuffer(void* buffer, void* vertices, co
 	mDevice->CreateBuffer(&vbd, pVertexData, reinterpret_cast<ID3D11Buffer**>(buffer));
 }
 
-void DX3D11Renderer::VCreateIndexBuffer(void* buffer, uint16_t* indices, const uint32_t& count)
+void DX3D11Renderer::CreateIndexBuffer(void* buffer, void* indices, const uint32_t& size, const D3D11_USAGE& usage, const UINT& cpuAccessFlags)
 {
 	D3D11_BUFFER_DESC ibd;
-	ibd.Usage = D3D11_USAGE_DEFAULT;
-	ibd.ByteWidth = sizeof(uint16_t) * count;
+	ibd.Usage = usage;
+	ibd.ByteWidth = size;
 	ibd.BindFlags = D3D11_BIND_INDEX_BUFFER;
-	ibd.CPUAccessFlags = 0;
+	ibd.CPUAccessFlags = cpuAccessFlags;
 	ibd.MiscFlags = 0;
 	ibd.StructureByteStride = 0;	// Not used for Vertex Input
 
@@ -314,46 +315,34 @@ void DX3D11Renderer::VCreateIndexBuffer(void* buffer, uint16_t* indices, const u
 	mDevice->CreateBuffer(&ibd, pIndexData, reinterpret_cast<ID3D11Buffer**>(buffer));
 }
 
-void DX3D11Renderer::VCreateStaticIndexBuffer(void* buffer, uint16_t* indices, const uint32_t& count)
+void DX3D11Renderer::VCreateIndexBuffer(void* buffer, uint16_t* indices, const uint32_t& count)
 {
-	D3D11_BUFFER_DESC ibd;
-	ibd.Usage = D3D11_USAGE_IMMUTABLE;
-	ibd.ByteWidth = sizeof(uint16_t) * count;
-	ibd.BindFlags = D3D11_BIND_INDEX_BUFFER;
-	ibd.CPUAccessFlags = 0;
-	ibd.MiscFlags = 0;
-	ibd.StructureByteStride = 0;	// Not used for Vertex Input
-
-	D3D11_SUBRESOURCE_DATA* pIndexData = nullptr;
-	if (indices)
-	{
-		D3D11_SUBRESOURCE_DATA indexData;
-		indexData.pSysMem = indices;
-		pIndexData = &indexData;
-	}
+	CreateIndexBuffer(buffer, indices, sizeof(uint16_t) * count, D3D11_USAGE_DEFAULT, 0);
+}
 
-	mDevice->CreateBuffer(&ibd, pIndexData, reinterpret_cast<ID3D11Buffer**>(buffer));
+void DX3D11Renderer::VCreateStaticIndexBuffer(void* buffer, uint16_t* indices, const uint32_t& count)
+{
+	CreateIndexBuffer(buffer, indices, sizeof(uint16_t) * count, D3D11_USAGE_IMMUTABLE, 0);
 }
 
 void DX3D11Renderer::VCreateDynamicIndexBuffer(void* buffer, uint16_t* indices, const uint32_t& count)
 {
-	D3D11_BUFFER_DESC ibd;
-	ibd.Usage = D3D11_USAGE_DYNAMIC;
-	ibd.ByteWidth = sizeof(uint16_t) * count;
-	ibd.BindFlags = D3D11_BIND_INDEX_BUFFER;
-	ibd.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
-	ibd.MiscFlags = 0;
-	ibd.StructureByteStride = 0;	// Not used for Vertex Input
+	CreateIndexBuffer(buffer, indices, sizeof(uint16_t) * count, D3D11_USAGE_DYNAMIC, D3D11_CPU_ACCESS_WRITE);
+}
 
-	D3D11_SUBRESOURCE_DATA* pIndexData = nullptr;
-	if (indices)
-	{
-		D3D11_SUBRESOURCE_DATA indexData;
-		indexData.pSysMem = indices;
-		pIndexData = &indexData;
-	}
+void DX3D11Renderer::VCreateIndexBuffer(void* buffer, uint32_t* indices, const uint32_t& count)
+{
+	CreateIndexBuffer(buffer, indices, sizeof(uint32_t) * count, D3D11_USAGE_DEFAULT, 0);
+}
 
-	mDevice->CreateBuffer(&ibd, pIndexData, reinterpret_cast<ID3D11Buffer**>(buffer));
+void DX3D11Renderer::VCreateStaticIndexBuffer(void* buffer, uint32_t* indices, const uint32_t& count)
+{
+	CreateIndexBuffer(buffer, indices, sizeof(uint32_t) * count, D3D11_USAGE_IMMUTABLE, 0);
+}
+
+void DX3D11Renderer::VCreateDynamicIndexBuffer(void* buffer, uint32_t* indices, const uint32_t& count)
+{
+	CreateIndexBuffer(buffer, indices, sizeof(uint32_t) * count, D3D11_USAGE_DYNAMIC, D3D11_CPU_ACCESS_WRITE);
 }
 
 void DX3D11Renderer::VCreateInstanceBuffer(void* buffer, void* data, const size_t& size)
@@ -536,6 +525,33 @@ void DX3D11Renderer::VCreateNativeFormat(void* nativeFormat, InputFormat texture
 	case RGBA_TYPELESS8:
 		format = DXGI_FORMAT_R8G8B8A8_TYPELESS;
 		break;
+	case R_FLOAT16:
+		format = DXGI_FORMAT_R16_FLOAT;
+		break;
+	case RG_FLOAT16:
+		format = DXGI_FORMAT_R16G16_FLOAT;
+		break;
+	case RGBA_FLOAT16:
+		format = DXGI_FORMAT_R16G16B16A16_FLOAT;
+		break;
+	case R_UNORM16:
+		format = DXGI_FORMAT_R16_UNORM;
+		break;
+	case RG_UNORM16:
+		format = DXGI_FORMAT_R16G16_UNORM;
+		break;
+	case RGBA_UNORM16:
+		format = DXGI_FORMAT_R16G16B16A16_UNORM;
+		break;
+	case R_SNORM16:
+		format = DXGI_FORMAT_R16_SNORM;
+		break;
+	case RG_SNORM16:
+		format = DXGI_FORMAT_R16G16_SNORM;
+		break;
+	case RGBA_SNORM16:
+		format = DXGI_FORMAT_R16G16B16A16_SNORM;
+		break;
 	}
 }
 
@@ -768,10 +784,18 @@ void DX3D11Renderer::VSetDynamicMeshVertexBuffer(IMesh* mesh, void* vertices, co
 	VCreateDynamicVertexBuffer(&DXMesh->mVertexBuffer, vertices, size);
 }
 
+void DX3D11Renderer::VSetStaticMeshAttributeBuffer(IMesh* mesh, void* attributes, const size_t& size, const size_t& stride)
+{
+	DX11Mesh* DXMesh = static_cast<DX11Mesh*>(mesh);
+	DXMesh->mAttributeStride = stride;
+	VCreateStaticVertexBuffer(&DXMesh->mAttributeBuffer, attributes, size);
+}
+
 void DX3D11Renderer::VSetMeshIndexBuffer(IMesh* mesh, uint16_t* indices, const uint32_t& count)
 {
 	DX11Mesh* DXMesh = static_cast<DX11Mesh*>(mesh);
 	DXMesh->mIndexCount = count;
+	DXMesh->mIndexSize = sizeof(uint16_t);
 	VCreateIndexBuffer(&DXMesh->mIndexBuffer, indices, count);
 }
 
@@ -779,6 +803,7 @@ void DX3D11Renderer::VSetStaticMeshIndexBuffer(IMesh* mesh, uint16_t* indices, c
 {
 	DX11Mesh* DXMesh = static_cast<DX11Mesh*>(mesh);
 	DXMesh->mIndexCount = count;
+	DXMesh->mIndexSize = sizeof(uint16_t);
 	VCreateStaticIndexBuffer(&DXMesh->mIndexBuffer, indices, count);
 }
 
@@ -786,6 +811,31 @@ void DX3D11Renderer::VSetDynamicMeshIndexBuffer(IMesh* mesh, uint16_t* indices,
 {
 	DX11Mesh* DXMesh = static_cast<DX11Mesh*>(mesh);
 	DXMesh->mIndexCount = count;
+	DXMesh->mIndexSize = sizeof(uint16_t);
+	VCreateDynamicIndexBuffer(&DXMesh->mIndexBuffer, indices, count);
+}
+
+void DX3D11Renderer::VSetMeshIndexBuffer(IMesh* mesh, uint32_t* indices, const uint32_t& count)
+{
+	DX11Mesh* DXMesh = static_cast<DX11Mesh*>(mesh);
+	DXMesh->mIndexCount = count;
+	DXMesh->mIndexSize = sizeof(uint32_t);
+	VCreateIndexBuffer(&DXMesh->mIndexBuffer, indices, count);
+}
+
+void DX3D11Renderer::VSetStaticMeshIndexBuffer(IMesh* mesh, uint32_t* indices, const uint32_t& count)
+{
+	DX11Mesh* DXMesh = static_cast<DX11Mesh*>(mesh);
+	DXMesh->mIndexCount = count;
+	DXMesh->mIndexSize = sizeof(uint32_t);
+	VCreateStaticIndexBuffer(&DXMesh->mIndexBuffer, indices, count);
+}
+
+void DX3D11Renderer::VSetDynamicMeshIndexBuffer(IMesh* mesh, uint32_t* indices, const uint32_t& count)
+{
+	DX11Mesh* DXMesh = static_cast<DX11Mesh*>(mesh);
+	DXMesh->mIndexCount = count;
+	DXMesh->mIndexSize = sizeof(uint32_t);
 	VCreateDynamicIndexBuffer(&DXMesh->mIndexBuffer, indices, count);
 }
 
@@ -798,15 +848,58 @@ void DX3D11Renderer::VUpdateMeshVertexBuffer(IMesh* mesh, void* data, const size
 void DX3D11Renderer::VUpdateMeshIndexBuffer(IMesh* mesh, void* data, const uint32_t& count)
 {
 	DX11Mesh* DXMesh = static_cast<DX11Mesh*>(mesh);
-	VUpdateBuffer(DXMesh->mIndexBuffer, data, sizeof(uint16_t) * count);
+	VUpdateBuffer(DXMesh->mIndexBuffer, data, DXMesh->mIndexSize * count);
+}
+
+void DX3D11Renderer::VReleaseMesh(IMesh* mesh)
+{
+	DX11Mesh* DXMesh = static_cast<DX11Mesh*>(mesh);
+	ReleaseMacro(DXMesh->mVertexBuffer);
+	ReleaseMacro(DXMesh->mAttributeBuffer);
+	ReleaseMacro(DXMesh->mIndexBuffer);
+	DXMesh->mAttributeStride = 0;
+	DXMesh->mIndexCount = 0;
+}
+
+void DX3D11Renderer::VSwapMesh(IMesh* a, IMesh* b)
+{
+	DX11Mesh* DXMeshA = static_cast<DX11Mesh*>(a);
+	DX11Mesh* DXMeshB = static_cast<DX11Mesh*>(b);
+	std::swap(DXMeshA->mVertexBuffer, DXMeshB->mVertexBuffer);
+	std::swap(DXMeshA->mAttributeBuffer, DXMeshB->mAttributeBuffer);
+	std::swap(DXMeshA->mIndexBuffer, DXMeshB->mIndexBuffer);
+	std::swap(DXMeshA->mVertexStride, DXMeshB->mVertexStride);
+	std::swap(DXMeshA->mAttributeStride, DXMeshB->mAttributeStride);
+	std::swap(DXMeshA->mIndexCount, DXMeshB->mIndexCount);
+	std::swap(DXMeshA->mIndexSize, DXMeshB->mIndexSize);
 }
 
 void DX3D11Renderer::VBindMesh(IMesh* mesh)
+{
+	DX11Mesh* dxMesh = static_cast<DX11Mesh*>(mesh);
+	if (dxMesh->mAttributeBuffer)
+	{
+		ID3D11Buffer* buffers[2] = { dxMesh->mVertexBuffer, dxMesh->mAttributeBuffer };
+		uint32_t strides[2] = { dxMesh->mVertexStride, dxMesh->mAttributeStride };
+		uint32_t offsets[2] = { 0, 0 };
+		mDeviceContext->IASetVertexBuffers(0, 2, buffers, strides, offsets);
+	}
+	else
+	{
+		uint32_t offset = 0;
+		mDeviceContext->IASetVertexBuffers(0, 1, &dxMesh->mVertexBuffer, &dxMesh->mVertexStride, &offset);
+	}
+
+	mDeviceContext->IASetIndexBuffer(dxMesh->mIndexBuffer, (dxMesh->mIndexSize == sizeof(uint32_t)) ? DXGI_FORMAT_R32_UINT : DXGI_FORMAT_R16_UINT, 0);
+}
+
+// Binds slot 0 only, for depth and shadow passes over split meshes. The input layout must read POSITION alone.
+void DX3D11Renderer::VBindMeshPositions(IMesh* mesh)
 {
 	DX11Mesh* dxMesh = static_cast<DX11Mesh*>(mesh);
 	uint32_t offset = 0;
 	mDeviceContext->IASetVertexBuffers(0, 1, &dxMesh->mVertexBuffer, &dxMesh->mVertexStride, &offset);
-	mDeviceContext->IASetIndexBuffer(dxMesh->mIndexBuffer, DXGI_FORMAT_R16_UINT, 0);
+	mDeviceContext->IASetIndexBuffer(dxMesh->mIndexBuffer, (dxMesh->mIndexSize == sizeof(uint32_t)) ? DXGI_FORMAT_R32_UINT : DXGI_FORMAT_R16_UINT, 0);
 }
 
 #pragma endregion
@@ -860,21 +953,7 @@ void DX3D11Renderer::LoadInputLayout(IShader* vertexShader, const void* byteCode
 			inputDescription[i].AlignedByteOffset = D3D11_APPEND_ALIGNED_ELEMENT;
 			inputDescription[i].InstanceDataStepRate = inputElements[i].InstanceStepRate;
 
-			switch (inputElements[i].Format)
-			{
-			case RG_FLOAT32:
-				inputDescription[i].Format = DXGI_FORMAT_R32G32_FLOAT;
-				break;
-			case RGB_FLOAT32:
-				inputDescription[i].Format = DXGI_FORMAT_R32G32B32_FLOAT;
-				break;
-			case RGBA_FLOAT32:
-				inputDescription[i].Format = DXGI_FORMAT_R32G32B32A32_FLOAT;
-				break;
-			default:
-				inputDescription[i].Format = DXGI_FORMAT_R32_FLOAT;
-				break;
-			}
+			VCreateNativeFormat(&inputDescription[i].Format, inputElements[i].Format);
 
 			switch (inputElements[i].InputSlotClass)
 			{
@@ -65,6 +65,10 @@ namespace Rig3D
 		void	VCreateStaticIndexBuffer(void* buffer, uint16_t* indices, const uint32_t& count);
 		void	VCreateDynamicIndexBuffer(void* buffer, uint16_t* indices, const uint32_t& count);
 
+		void	VCreateIndexBuffer(void* buffer, uint32_t* indices, const uint32_t& count);
+		void	VCreateStaticIndexBuffer(void* buffer, uint32_t* indices, const uint32_t& count);
+		void	VCreateDynamicIndexBuffer(void* buffer, uint32_t* indices, const uint32_t& count);
+
 		void	VCreateInstanceBuffer(void* buffer, void* data, const size_t& size);
 		void	VCreateStaticInstanceBuffer(void* buffer, void* data, const size_t& size);
 		void	VCreateDynamicInstanceBuffer(void* buffer, void* data, const size_t& size);
@@ -110,14 +114,29 @@ namespace Rig3D
 		void	VSetStaticMeshVertexBuffer(IMesh* mesh, void* vertices, const size_t& size, const size_t& stride);
 		void	VSetDynamicMeshVertexBuffer(IMesh* mesh, void* vertices, const size_t& size, const size_t& stride);
 
+		// Second stream for split meshes; the vertex buffer then holds positions only.
+		void	VSetStaticMeshAttributeBuffer(IMesh* mesh, void* attributes, const size_t& size, const size_t& stride);
+
 		void	VSetMeshIndexBuffer(IMesh* mesh, uint16_t* indices, const uint32_t& count);
 		void	VSetStaticMeshIndexBuffer(IMesh* mesh, uint16_t* indices, const uint32_t& count);
 		void	VSetDynamicMeshIndexBuffer(IMesh* mesh, uint16_t* indices, const uint32_t& count);
 
+		// 32 bit indices for meshes over 65536 vertices. The mesh records its index size for binding.
+		void	VSetMeshIndexBuffer(IMesh* mesh, uint32_t* indices, const uint32_t& count);
+		void	VSetStaticMeshIndexBuffer(IMesh* mesh, uint32_t* indices, const uint32_t& count);
+		void	VSetDynamicMeshIndexBuffer(IMesh* mesh, uint32_t* indices, const uint32_t& count);
+
 		void	VUpdateMeshVertexBuffer(IMesh* mesh, void* data, const size_t& size);
 		void	VUpdateMeshIndexBuffer(IMesh* mesh, void* data, const uint32_t& count);
 
 		void    VBindMesh(IMesh* mesh);
+		void    VBindMeshPositions(IMesh* mesh);
+
+		// Releases the mesh's buffers but keeps the mesh, so the VSet*Buffer functions can refill it later.
+		void	VReleaseMesh(IMesh* mesh);
+
+		// Exchanges the two meshes' buffers and formats, e.g. to build new buffers before giving up the old ones.
+		void	VSwapMesh(IMesh* a, IMesh* b);
 
 #pragma endregion 
 
@@ -260,6 +279,7 @@ namespace Rig3D
 		void SetVertexShaderInputLayout(ID3D11ShaderReflection* reflection, ID3DBlob* vsBlob, D3D11_SHADER_DESC* shaderDesc, DX11Shader* vertexShader);
 		void SetShaderConstantBuffers(ID3D11ShaderReflection* reflection, D3D11_SHADER_DESC* shaderDesc, DX11Shader* shader, LinearAllocator* allocator);
 		void SetShaderResources(ID3D11ShaderReflection* reflection, D3D11_SHADER_DESC* shaderDesc, DX11Shader* shader);
+		void CreateIndexBuffer(void* buffer, void* indices, const uint32_t& size, const D3D11_USAGE& usage, const UINT& cpuAccessFlags);
 	};
 }
 
@@ -2,7 +2,7 @@
 
 using namespace Rig3D;
 
-IMesh::IMesh() : mIndexCount(0), mVertexStride(0)
+IMesh::IMesh() : mIndexCount(0), mVertexStride(0), mAttributeStride(0), mIndexSize(sizeof(uint16_t))
 {
 }
 
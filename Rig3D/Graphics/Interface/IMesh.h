@@ -18,10 +18,14 @@ namespace Rig3D
 
 		inline uint32_t GetIndexCount()		const { return mIndexCount; };
 		inline uint32_t GetVertexStride()	const { return mVertexStride; };
+		inline uint32_t GetAttributeStride()	const { return mAttributeStride; };
+		inline uint32_t GetIndexSize()		const { return mIndexSize; };
 
 	protected:
 		uint32_t		mVertexStride;
+		uint32_t		mAttributeStride;	// 0 unless the mesh has a separate attribute stream
 		uint32_t		mIndexCount;
+		uint32_t		mIndexSize;			// 2 or 4 bytes, set with the index buffer
 	};
 }
 
@@ -36,7 +36,16 @@ namespace Rig3D
 		RGBA_SNORM8,
 		R_TYPELESS8,
 		RG_TYPELESS8,
-		RGBA_TYPELESS8
+		RGBA_TYPELESS8,
+		R_FLOAT16,
+		RG_FLOAT16,
+		RGBA_FLOAT16,
+		R_UNORM16,
+		RG_UNORM16,
+		RGBA_UNORM16,
+		R_SNORM16,
+		RG_SNORM16,
+		RGBA_SNORM16
 	};
 
 	struct InputElement
@@ -0,0 +1,306 @@
+#pragma once
+#include "GraphicsMath/cgm.h"
+#include "Rig3D/TaskDispatch/TaskDispatcher.h"
+#include <vector>
+#include <algorithm>
+#include <float.h>
+#include <math.h>
+#include <string.h>
+
+#define RIG_LOD_MAX_LEVELS 8
+
+// Level of detail selection. A mesh keeps every level in one vertex / index buffer pair and each level is a range
+// of it, ordered finest (0) to coarsest. Each level stores its geometric error: the largest object space distance
+// between its surface and the full resolution surface. Selection projects that error to pixels and picks the
+// coarsest level under the threshold.
+namespace Rig3D
+{
+	struct LODLevel
+	{
+		uint32_t	indexStart;
+		uint32_t	indexCount;
+		uint32_t	vertexStart;
+		uint32_t	vertexCount;
+		float		error;
+	};
+
+	struct LODMesh
+	{
+		LODLevel	levels[RIG_LOD_MAX_LEVELS];
+		uint32_t	levelCount;
+
+		LODMesh() : levelCount(0) {};
+	};
+
+	// Per object selection state. center and radius are the world space bounding sphere and scale the
+	// largest world scale of the object; the caller refreshes them before selection.
+	struct LODInstance
+	{
+		const LODMesh*	mesh;
+		vec3f			center;
+		float			radius;
+		float			scale;
+		uint32_t		level;
+		float			errorScale;		// Pixels per unit of object space error, written by selection
+	};
+
+	struct LODParameters
+	{
+		vec3f		cameraPosition;
+		float		projectionScale;	// viewport height / (2 * tan(fovY / 2)): pixels per unit at distance 1
+		float		nearZ;
+		float		threshold;			// Allowed error in pixels
+		float		hysteresis;			// Fraction of threshold; levels only change once the error leaves [t * (1 - h), t * (1 + h)]
+		uint32_t	triangleBudget;		// 0 for no budget
+	};
+
+	struct LODStatistics
+	{
+		uint32_t selectedTriangles;		// Before the budget pass
+		uint32_t triangles;				// After the budget pass
+		uint32_t budgetCoarsened;		// Level steps taken by the budget pass
+		uint32_t levelCounts[RIG_LOD_MAX_LEVELS];
+
+		LODStatistics() { Reset(); };
+
+		inline void Reset() { selectedTriangles = triangles = budgetCoarsened = 0; memset(levelCounts, 0, sizeof(levelCounts)); };
+	};
+
+	inline void InitializeLODParameters(LODParameters& parameters, const vec3f& cameraPosition, const float& fovY, const float& viewportHeight, const float& nearZ, const float& threshold)
+	{
+		parameters.cameraPosition = cameraPosition;
+		parameters.projectionScale = viewportHeight / (2.0f * tanf(fovY * 0.5f));
+		parameters.nearZ = nearZ;
+		parameters.threshold = threshold;
+		parameters.hysteresis = 0.15f;
+		parameters.triangleBudget = 0;
+	}
+
+	inline void AddLODLevel(LODMesh& mesh, const uint32_t& indexStart, const uint32_t& indexCount, const uint32_t& vertexStart, const uint32_t& vertexCount, const float& error)
+	{
+		if (mesh.levelCount == RIG_LOD_MAX_LEVELS)
+		{
+			return;
+		}
+
+		LODLevel& level = mesh.levels[mesh.levelCount++];
+		level.indexStart = indexStart;
+		level.indexCount = indexCount;
+		level.vertexStart = vertexStart;
+		level.vertexCount = vertexCount;
+		level.error = error;
+	}
+
+#pragma region Selection
+
+	// Pixels per unit of object space error for this instance. Distance is measured to the nearest point of the
+	// bounding sphere so the estimate is conservative.
+	inline float GetLODErrorScale(const LODInstance& instance, const LODParameters& parameters)
+	{
+		vec3f offset = instance.center - parameters.cameraPosition;
+		float distance = sqrtf(cliqCity::graphicsMath::dot(offset, offset)) - instance.radius;
+
+		return instance.scale * parameters.projectionScale / max(distance, parameters.nearZ);
+	}
+
+	// Coarsest level whose projected error is within limit.
+	inline uint32_t GetCoarsestLOD(const LODMesh& mesh, const float& errorScale, const float& limit)
+	{
+		uint32_t level = 0;
+		for (uint32_t l = 1; l < mesh.levelCount; l++)
+		{
+			if (mesh.levels[l].error * errorScale <= limit)
+			{
+				level = l;
+			}
+		}
+
+		return level;
+	}
+
+	// Projected error added by stepping to the next coarser level, FLT_MAX when the instance is already at its
+	// coarsest.
+	inline float GetCoarserLODErrorIncrease(const LODInstance& instance)
+	{
+		const LODMesh& mesh = *instance.mesh;
+		return (instance.level + 1 < mesh.levelCount) ? (mesh.levels[instance.level + 1].error - mesh.levels[instance.level].error) * instance.errorScale : FLT_MAX;
+	}
+
+	inline void SelectLOD(LODInstance& instance, const LODParameters& parameters)
+	{
+		const LODMesh& mesh = *instance.mesh;
+		float errorScale = GetLODErrorScale(instance, parameters);
+		instance.errorScale = errorScale;
+
+		if (mesh.levelCount == 0)
+		{
+			instance.level = 0;
+			return;
+		}
+
+		uint32_t current = min(instance.level, mesh.levelCount - 1);
+		float refineLimit = parameters.threshold * (1.0f + parameters.hysteresis);
+		float coarsenLimit = parameters.threshold * (1.0f - parameters.hysteresis);
+
+		if (mesh.levels[current].error * errorScale > refineLimit)
+		{
+			instance.level = GetCoarsestLOD(mesh, errorScale, parameters.threshold);
+		}
+		else if (current + 1 < mesh.levelCount && mesh.levels[current + 1].error * errorScale <= coarsenLimit)
+		{
+			instance.level = GetCoarsestLOD(mesh, errorScale, coarsenLimit);
+		}
+		else
+		{
+			instance.level = current;
+		}
+	}
+
+	// Selects levels for the visible instances [first, first + count) of a culled index list.
+	inline void SelectLODs(LODInstance* instances, const uint32_t* visible, const uint32_t& first, const uint32_t& count, const LODParameters& parameters)
+	{
+		for (uint32_t i = first; i < first + count; i++)
+		{
+			SelectLOD(instances[visible[i]], parameters);
+		}
+	}
+
+	// Coarsens the instances with the smallest projected error increase first until the triangle count fits the
+	// budget or every instance is at its coarsest level. scratch is reused between frames.
+	inline uint32_t ApplyTriangleBudget(LODInstance* instances, const uint32_t* visible, const uint32_t& visibleCount, const uint32_t& budget, const uint32_t& triangles, std::vector<uint32_t>& scratch, LODStatistics* statistics = nullptr)
+	{
+		uint32_t total = triangles;
+
+		for (uint32_t pass = 0; pass < RIG_LOD_MAX_LEVELS && total > budget; pass++)
+		{
+			scratch.clear();
+			for (uint32_t i = 0; i < visibleCount; i++)
+			{
+				if (instances[visible[i]].level + 1 < instances[visible[i]].mesh->levelCount)
+				{
+					scratch.push_back(visible[i]);
+				}
+			}
+
+			if (scratch.empty())
+			{
+				break;
+			}
+
+			std::sort(scratch.begin(), scratch.end(), [instances](const uint32_t& a, const uint32_t& b)
+			{
+				return GetCoarserLODErrorIncrease(instances[a]) < GetCoarserLODErrorIncrease(instances[b]);
+			});
+
+			for (uint32_t i = 0; i < scratch.size() && total > budget; i++)
+			{
+				LODInstance& instance = instances[scratch[i]];
+				const LODMesh& mesh = *instance.mesh;
+
+				// Levels are not required to shrink, so swap the counts rather than subtract their difference
+				uint32_t current = mesh.levels[instance.level].indexCount / 3;
+				uint32_t coarser = mesh.levels[instance.level + 1].indexCount / 3;
+				total = ((total > current) ? total - current : 0) + coarser;
+				instance.level++;
+
+				if (statistics)
+				{
+					statistics->budgetCoarsened++;
+				}
+			}
+		}
+
+		return total;
+	}
+
+	inline uint32_t CountLODTriangles(const LODInstance* instances, const uint32_t* visible, const uint32_t& visibleCount, LODStatistics* statistics = nullptr)
+	{
+		uint32_t triangles = 0;
+		for (uint32_t i = 0; i < visibleCount; i++)
+		{
+			const LODInstance& instance = instances[visible[i]];
+			if (instance.mesh->levelCount == 0)
+			{
+				continue;
+			}
+
+			triangles += instance.mesh->levels[instance.level].indexCount / 3;
+
+			if (statistics)
+			{
+				statistics->levelCounts[instance.level]++;
+			}
+		}
+
+		return triangles;
+	}
+
+	struct LODSelectRange
+	{
+		LODInstance*				instances;
+		const uint32_t*				visible;
+		const LODParameters*		parameters;
+		uint32_t					first;
+		uint32_t					count;
+		cliqCity::multicore::TaskID	taskID;
+	};
+
+	inline void PerformLODSelectTask(const cliqCity::multicore::TaskData& data)
+	{
+		LODSelectRange* range = reinterpret_cast<LODSelectRange*>(data.mKernelData);
+		SelectLODs(range->instances, range->visible, range->first, range->count, *range->parameters);
+	}
+
+	// Batch selection for the survivors of a cull pass, split across rangeCount tasks, followed by the serial
+	// budget pass. Returns the final triangle count. ranges is caller owned scratch with rangeCount elements.
+	// Call once per frame; statistics are reset on entry.
+	inline uint32_t SelectLODsParallel(cliqCity::multicore::TaskDispatcher& dispatcher, LODInstance* instances, const uint32_t* visible, const uint32_t& visibleCount, const LODParameters& parameters, LODSelectRange* ranges, const uint32_t& rangeCount, std::vector<uint32_t>& scratch, LODStatistics* statistics = nullptr)
+	{
+		if (statistics)
+		{
+			statistics->Reset();
+		}
+
+		uint32_t rangeSize = (visibleCount + rangeCount - 1) / rangeCount;
+
+		cliqCity::multicore::TaskData data;
+		uint32_t taskCount = 0;
+		for (uint32_t first = 0; first < visibleCount; first += rangeSize, taskCount++)
+		{
+			LODSelectRange& range = ranges[taskCount];
+			range.instances = instances;
+			range.visible = visible;
+			range.parameters = &parameters;
+			range.first = first;
+			range.count = min(rangeSize, visibleCount - first);
+
+			data.mKernelData = &range;
+			range.taskID = dispatcher.AddTask(data, PerformLODSelectTask);
+		}
+
+		for (uint32_t i = 0; i < taskCount; i++)
+		{
+			dispatcher.WaitForTask(ranges[i].taskID);
+		}
+
+		uint32_t triangles = CountLODTriangles(instances, visible, visibleCount);
+		if (statistics)
+		{
+			statistics->selectedTriangles = triangles;
+		}
+
+		if (parameters.triangleBudget != 0 && triangles > parameters.triangleBudget)
+		{
+			triangles = ApplyTriangleBudget(instances, visible, visibleCount, parameters.triangleBudget, triangles, scratch, statistics);
+		}
+
+		if (statistics)
+		{
+			statistics->triangles = CountLODTriangles(instances, visible, visibleCount, statistics);
+		}
+
+		return triangles;
+	}
+
+#pragma endregion
+}
@@ -0,0 +1,302 @@
+#pragma once
+#include "Rig3D/Common/MemoryMappedFile.h"
+#include "Rig3D/Graphics/LevelOfDetail.h"
+#include "Rig3D/Graphics/Meshlet.h"
+#include <vector>
+#include <fstream>
+#include <algorithm>
+#include <float.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdint.h>
+
+#define RIG_MESH_CACHE_MAGIC		0x48534d52	// "RMSH"
+#define RIG_MESH_CACHE_VERSION		2
+#define RIG_MESH_CACHE_ALIGNMENT	64
+
+// Binary mesh container. A fixed header is followed by blobs aligned to RIG_MESH_CACHE_ALIGNMENT, so a mapped file
+// can hand its vertex and index blobs straight to the renderer. The header records a hash of the source file plus
+// the vertex stride and attribute layout it was built with; a cache that disagrees with any of them is stale, as is
+// one written by another RIG_MESH_CACHE_VERSION.
+namespace Rig3D
+{
+	enum MeshCacheSection
+	{
+		MESH_CACHE_VERTICES,
+		MESH_CACHE_INDICES,
+		MESH_CACHE_LODS,
+		MESH_CACHE_MESHLETS,
+		MESH_CACHE_MESHLET_BOUNDS,
+		MESH_CACHE_MESHLET_VERTICES,
+		MESH_CACHE_MESHLET_TRIANGLES,
+		MESH_CACHE_SECTION_COUNT
+	};
+
+	struct MeshCacheBlob
+	{
+		uint64_t offset;
+		uint64_t size;
+	};
+
+	struct MeshCacheHeader
+	{
+		uint32_t		magic;
+		uint32_t		version;
+		uint64_t		sourceHash;
+		uint64_t		vertexLayout;
+		uint32_t		vertexStride;
+		uint32_t		vertexCount;
+		uint32_t		indexSize;
+		uint32_t		indexCount;
+		float			boundsMin[3];
+		float			boundsMax[3];
+		uint32_t		lodLevelCount;
+		uint32_t		meshletTriangleCount;
+		MeshCacheBlob	blobs[MESH_CACHE_SECTION_COUNT];
+	};
+
+	struct MeshCache
+	{
+		MemoryMappedFile		file;
+		const MeshCacheHeader*	header;
+
+		MeshCache() : header(nullptr) {};
+	};
+
+	// Content hash for cache keys; not cryptographic.
+	inline uint64_t HashMeshSource(const void* data, const size_t& size)
+	{
+		const uint8_t* bytes = static_cast<const uint8_t*>(data);
+		uint64_t hash = 14695981039346656037ull ^ size;
+
+		size_t i = 0;
+		for (; i + 8 <= size; i += 8)
+		{
+			uint64_t word;
+			memcpy(&word, bytes + i, sizeof(word));
+			hash = (hash ^ word) * 1099511628211ull;
+			hash ^= hash >> 29;
+		}
+
+		for (; i < size; i++)
+		{
+			hash = (hash ^ bytes[i]) * 1099511628211ull;
+		}
+
+		return hash;
+	}
+
+	inline bool HashMeshSourceFile(const char* filename, uint64_t& hash)
+	{
+		MemoryMappedFile file;
+		if (!file.Open(filename))
+		{
+			return false;
+		}
+
+		hash = HashMeshSource(file.GetData(), file.GetSize());
+		return true;
+	}
+
+	// Offset and size of each attribute a cached Vertex may declare, so reordering or resizing members invalidates
+	// caches of the same stride. Members absent from Vertex fall through to the overload that hashes nothing.
+#define RIG_MESH_CACHE_ATTRIBUTE(name, tag)																\
+	template<class Vertex>																				\
+	inline void GetMeshCacheAttribute##name(uint32_t* layout, decltype(&Vertex::name))					\
+	{																									\
+		layout[0] = tag;																				\
+		layout[1] = static_cast<uint32_t>(offsetof(Vertex, name));										\
+		layout[2] = static_cast<uint32_t>(sizeof(static_cast<Vertex*>(nullptr)->name));					\
+	}																									\
+	template<class Vertex>																				\
+	inline void GetMeshCacheAttribute##name(uint32_t*, ...)											\
+	{																									\
+	}
+
+	RIG_MESH_CACHE_ATTRIBUTE(Position, 1)
+	RIG_MESH_CACHE_ATTRIBUTE(UV, 2)
+	RIG_MESH_CACHE_ATTRIBUTE(Normal, 3)
+	RIG_MESH_CACHE_ATTRIBUTE(Tangent, 4)
+
+#undef RIG_MESH_CACHE_ATTRIBUTE
+
+	template<class Vertex>
+	inline uint64_t GetMeshCacheVertexLayout()
+	{
+		uint32_t layout[13] = { static_cast<uint32_t>(sizeof(Vertex)) };
+		GetMeshCacheAttributePosition<Vertex>(layout + 1, nullptr);
+		GetMeshCacheAttributeUV<Vertex>(layout + 4, nullptr);
+		GetMeshCacheAttributeNormal<Vertex>(layout + 7, nullptr);
+		GetMeshCacheAttributeTangent<Vertex>(layout + 10, nullptr);
+
+		return HashMeshSource(layout, sizeof(layout));
+	}
+
+	// Maps filename and validates it against the expected source hash, vertex stride and vertex layout (see
+	// GetMeshCacheVertexLayout). Indices may be 16 or 32 bit; check header->indexSize. On failure the cache is closed.
+	inline bool OpenMeshCache(MeshCache& cache, const char* filename, const uint64_t& sourceHash, const uint32_t& vertexStride, const uint64_t& vertexLayout)
+	{
+		cache.header = nullptr;
+		if (!cache.file.Open(filename) || cache.file.GetSize() < sizeof(MeshCacheHeader))
+		{
+			cache.file.Close();
+			return false;
+		}
+
+		const MeshCacheHeader* header = reinterpret_cast<const MeshCacheHeader*>(cache.file.GetData());
+		bool valid =
+			header->magic == RIG_MESH_CACHE_MAGIC &&
+			header->version == RIG_MESH_CACHE_VERSION &&
+			header->sourceHash == sourceHash &&
+			header->vertexLayout == vertexLayout &&
+			header->vertexStride == vertexStride &&
+			(header->indexSize == sizeof(uint16_t) || header->indexSize == sizeof(uint32_t)) &&
+			header->blobs[MESH_CACHE_VERTICES].size == static_cast<uint64_t>(header->vertexCount) * vertexStride &&
+			header->blobs[MESH_CACHE_INDICES].size == static_cast<uint64_t>(header->indexCount) * header->indexSize;
+
+		// A truncated write leaves blobs past the end of the file
+		for (uint32_t s = 0; s < MESH_CACHE_SECTION_COUNT && valid; s++)
+		{
+			const MeshCacheBlob& blob = header->blobs[s];
+			valid = blob.offset <= cache.file.GetSize() && blob.size <= cache.file.GetSize() - blob.offset;
+		}
+
+		if (!valid)
+		{
+			cache.file.Close();
+			return false;
+		}
+
+		cache.header = header;
+		return true;
+	}
+
+	inline const void* GetMeshCacheBlob(const MeshCache& cache, const MeshCacheSection& section, uint64_t* size = nullptr)
+	{
+		const MeshCacheBlob& blob = cache.header->blobs[section];
+		if (size)
+		{
+			*size = blob.size;
+		}
+
+		return (blob.size > 0) ? cache.file.GetData() + blob.offset : nullptr;
+	}
+
+	inline bool ReadMeshCacheLODs(const MeshCache& cache, LODMesh& lods)
+	{
+		uint64_t size;
+		const void* blob = GetMeshCacheBlob(cache, MESH_CACHE_LODS, &size);
+		if (!blob || cache.header->lodLevelCount > RIG_LOD_MAX_LEVELS || size != cache.header->lodLevelCount * sizeof(LODLevel))
+		{
+			return false;
+		}
+
+		memcpy(lods.levels, blob, size);
+		lods.levelCount = cache.header->lodLevelCount;
+		return true;
+	}
+
+	template<class Element>
+	inline void ReadMeshCacheVector(const MeshCache& cache, const MeshCacheSection& section, std::vector<Element>& elements)
+	{
+		uint64_t size;
+		const Element* blob = static_cast<const Element*>(GetMeshCacheBlob(cache, section, &size));
+		elements.assign(blob, blob + (blob ? size / sizeof(Element) : 0));
+	}
+
+	inline bool ReadMeshCacheMeshlets(const MeshCache& cache, MeshletMesh& mesh)
+	{
+		if (cache.header->blobs[MESH_CACHE_MESHLETS].size == 0)
+		{
+			return false;
+		}
+
+		ReadMeshCacheVector(cache, MESH_CACHE_MESHLETS, mesh.meshlets);
+		ReadMeshCacheVector(cache, MESH_CACHE_MESHLET_BOUNDS, mesh.bounds);
+		ReadMeshCacheVector(cache, MESH_CACHE_MESHLET_VERTICES, mesh.vertices);
+		ReadMeshCacheVector(cache, MESH_CACHE_MESHLET_TRIANGLES, mesh.triangles);
+		mesh.triangleCount = cache.header->meshletTriangleCount;
+
+		return mesh.bounds.size() == mesh.meshlets.size();
+	}
+
+	inline void WriteMeshCacheBlob(std::ofstream& file, MeshCacheHeader& header, const MeshCacheSection& section, const void* data, const uint64_t& size)
+	{
+		static const char padding[RIG_MESH_CACHE_ALIGNMENT] = {};
+
+		uint64_t offset = static_cast<uint64_t>(file.tellp());
+		uint64_t aligned = (offset + RIG_MESH_CACHE_ALIGNMENT - 1) & ~static_cast<uint64_t>(RIG_MESH_CACHE_ALIGNMENT - 1);
+		file.write(padding, static_cast<std::streamsize>(aligned - offset));
+
+		header.blobs[section].offset = (size > 0) ? aligned : 0;
+		header.blobs[section].size = size;
+		if (size > 0)
+		{
+			file.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+		}
+	}
+
+	// Writes a cache for Vertex with a vec3f Position. lods and meshlets are optional sections.
+	template<class Vertex, class Index>
+	bool WriteMeshCache(const char* filename, const uint64_t& sourceHash, const Vertex* vertices, const uint32_t& vertexCount, const Index* indices, const uint32_t& indexCount, const LODMesh* lods = nullptr, const MeshletMesh* meshlets = nullptr)
+	{
+		std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+		if (!file.is_open())
+		{
+			return false;
+		}
+
+		MeshCacheHeader header;
+		memset(&header, 0, sizeof(header));
+		header.magic = RIG_MESH_CACHE_MAGIC;
+		header.version = RIG_MESH_CACHE_VERSION;
+		header.sourceHash = sourceHash;
+		header.vertexLayout = GetMeshCacheVertexLayout<Vertex>();
+		header.vertexStride = sizeof(Vertex);
+		header.vertexCount = vertexCount;
+		header.indexSize = sizeof(Index);
+		header.indexCount = indexCount;
+
+		for (uint32_t c = 0; c < 3; c++)
+		{
+			header.boundsMin[c] = (vertexCount > 0) ? FLT_MAX : 0.0f;
+			header.boundsMax[c] = (vertexCount > 0) ? -FLT_MAX : 0.0f;
+		}
+
+		for (uint32_t i = 0; i < vertexCount; i++)
+		{
+			const float* p = &vertices[i].Position.x;
+			for (uint32_t c = 0; c < 3; c++)
+			{
+				header.boundsMin[c] = (std::min)(header.boundsMin[c], p[c]);
+				header.boundsMax[c] = (std::max)(header.boundsMax[c], p[c]);
+			}
+		}
+
+		// Header goes first as a placeholder and is rewritten once the blob offsets are known
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+		WriteMeshCacheBlob(file, header, MESH_CACHE_VERTICES, vertices, static_cast<uint64_t>(vertexCount) * sizeof(Vertex));
+		WriteMeshCacheBlob(file, header, MESH_CACHE_INDICES, indices, static_cast<uint64_t>(indexCount) * sizeof(Index));
+
+		if (lods && lods->levelCount > 0)
+		{
+			header.lodLevelCount = lods->levelCount;
+			WriteMeshCacheBlob(file, header, MESH_CACHE_LODS, lods->levels, lods->levelCount * sizeof(LODLevel));
+		}
+
+		if (meshlets && !meshlets->meshlets.empty())
+		{
+			header.meshletTriangleCount = meshlets->triangleCount;
+			WriteMeshCacheBlob(file, header, MESH_CACHE_MESHLETS, &meshlets->meshlets[0], meshlets->meshlets.size() * sizeof(Meshlet));
+			WriteMeshCacheBlob(file, header, MESH_CACHE_MESHLET_BOUNDS, &meshlets->bounds[0], meshlets->bounds.size() * sizeof(MeshletBounds));
+			WriteMeshCacheBlob(file, header, MESH_CACHE_MESHLET_VERTICES, meshlets->vertices.empty() ? nullptr : &meshlets->vertices[0], meshlets->vertices.size() * sizeof(uint32_t));
+			WriteMeshCacheBlob(file, header, MESH_CACHE_MESHLET_TRIANGLES, meshlets->triangles.empty() ? nullptr : &meshlets->triangles[0], meshlets->triangles.size());
+		}
+
+		file.seekp(0);
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+		return file.good();
+	}
+}
@@ -0,0 +1,63 @@
+#pragma once
+#include "Rig3D\Common\FileWatcher.h"
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <stdint.h>
+
+// Connects a FileWatcher to a MeshResidencyManager: when a watched source file settles after a write, every mesh
+// registered from it is reloaded. Pair it with CachedOBJResource so only the edited sources are parsed again and
+// their caches rewritten; everything else keeps loading from the cache.
+namespace Rig3D
+{
+	template<class Manager>
+	class MeshHotReload
+	{
+	public:
+		MeshHotReload(FileWatcher* watcher, Manager* manager) : mWatcher(watcher), mManager(manager)
+		{
+
+		}
+
+		// path is relative to the watched directory. Several meshes may share a source.
+		void Watch(const char* path, const uint32_t& handle)
+		{
+			NormalizeWatchPath(path, mPath);
+			mHandles.insert(std::make_pair(mPath, handle));
+		}
+
+		// Owner thread, once per frame before the manager's Update, which swaps the reloaded meshes in. Returns the
+		// number of meshes reloaded.
+		uint32_t Update()
+		{
+			mChanges.clear();
+			if (mWatcher->Poll(mChanges) == 0)
+			{
+				return 0;
+			}
+
+			uint32_t count = 0;
+			for (const std::string& path : mChanges)
+			{
+				auto range = mHandles.equal_range(path);
+				for (auto it = range.first; it != range.second; ++it)
+				{
+					mManager->ReloadMesh(it->second);
+					count++;
+				}
+			}
+
+			return count;
+		}
+
+	private:
+		FileWatcher*									mWatcher;
+		Manager*										mManager;
+		std::unordered_multimap<std::string, uint32_t>	mHandles;
+		std::vector<std::string>						mChanges;
+		std::string										mPath;
+
+		MeshHotReload(MeshHotReload const&) = delete;
+		void operator=(MeshHotReload const&) = delete;
+	};
+}
@@ -1,10 +1,15 @@
 #pragma once
 #include "Rig3D\rig_defines.h"
 #include "Rig3D\Graphics\DirectX11\DX11Mesh.h"
+#include "Rig3D\Graphics\MeshOptimization.h"
+#include "Rig3D\Graphics\VertexQuantization.h"
+#include "Rig3D\Graphics\VertexStreams.h"
+#include "Rig3D\Graphics\OBJParser.h"
+#include "Rig3D\Graphics\TangentFrame.h"
+#include "Rig3D\Graphics\MeshCache.h"
+#include "Rig3D\Common\MemoryMappedFile.h"
 #include "GraphicsMath\cgm.h"
 #include <vector>
-#include <map>
-#include <fstream>
 
 namespace Rig3D
 {
@@ -17,14 +22,19 @@ namespace Rig3D
 	{
 	public:
 		std::vector<Vertex>		mVertices;
-		std::vector<uint16_t>	mIndices;
+		std::vector<uint32_t>	mIndices;	// Narrowed to 16 bits on upload when the vertex count allows
 
 		uint32_t mVertexCount;
 		uint32_t mIndexCount;
 
 		const char* mFilename;
 
-		OBJBasicResource(const char* filename) : mVertexCount(0), mIndexCount(0), mFilename(filename)
+		cliqCity::multicore::TaskDispatcher* mDispatcher;
+
+		MeshOptimizationStatistics mOptimizationStatistics;
+
+		// With a dispatcher, large files are parsed in parallel chunks.
+		OBJBasicResource(const char* filename, cliqCity::multicore::TaskDispatcher* dispatcher = nullptr) : mVertexCount(0), mIndexCount(0), mFilename(filename), mDispatcher(dispatcher)
 		{
 
 		}
@@ -44,109 +54,21 @@ namespace Rig3D
 			mVertices.clear();
 			mIndices.clear();
 
-			// File input object
-			std::ifstream obj(mFilename);
-
-			// Check for successful open
-			if (!obj.is_open())
+			MemoryMappedFile file;
+			if (!file.Open(mFilename))
 			{
 				return false;
 			}
 
-			// Variables used while reading the file
-			std::vector<vec3f> positions;     // Positions from the file
-			std::vector<vec3f> normals;       // Normals from the file
-			std::vector<vec2f> uvs;           // UVs from the file
-			unsigned int triangleCounter = 0;    // Count of triangles/mIndices
-			char chars[100];                     // String for line reading
-
-												 // Still good?
-			while (obj.good())
+			OBJData data;
+			if (!ParseOBJ(data, file.GetData(), file.GetSize(), mDispatcher) || !BuildOBJMesh(mVertices, mIndices, data))
 			{
-				// Get the line (100 characters should be more than enough)
-				obj.getline(chars, 100);
-
-				// Check the type of line
-				if (chars[0] == 'v' && chars[1] == 'n')
-				{
-					// Read the 3 numbers directly into an XMFLOAT3
-					vec3f norm;
-					sscanf_s(
-						chars,
-						"vn %f %f %f",
-						&norm.x, &norm.y, &norm.z);
-
-					// Add to the list of normals
-					normals.push_back(norm);
-				}
-				else if (chars[0] == 'v' && chars[1] == 't')
-				{
-					// Read the 2 numbers directly into an XMFLOAT2
-					vec2f uv;
-					sscanf_s(
-						chars,
-						"vt %f %f",
-						&uv.x, &uv.y);
-
-					// Add to the list of uv's
-					uvs.push_back(uv);
-				}
-				else if (chars[0] == 'v')
-				{
-					// Read the 3 numbers directly into an XMFLOAT3
-					vec3f pos;
-					sscanf_s(
-						chars,
-						"v %f %f %f",
-						&pos.x, &pos.y, &pos.z);
-
-					// Add to the positions
-					positions.push_back(pos);
-				}
-				else if (chars[0] == 'f')
-				{
-					// Read the 9 face indices into an array
-					unsigned int i[9];
-					sscanf_s(
-						chars,
-						"f %d/%d/%d %d/%d/%d %d/%d/%d",
-						&i[0], &i[1], &i[2],
-						&i[3], &i[4], &i[5],
-						&i[6], &i[7], &i[8]);
-
-					// - Create the mVertices by looking up
-					//    corresponding data from vectors
-					// - OBJ File indices are 1-based, so
-					//    they need to be adusted
-					Vertex v1;
-					v1.Position = positions[i[0] - 1];
-					v1.UV = uvs[i[1] - 1];
-					v1.Normal = normals[i[2] - 1];
-
-					Vertex v2;
-					v2.Position = positions[i[3] - 1];
-					v2.UV = uvs[i[4] - 1];
-					v2.Normal = normals[i[5] - 1];
-
-					Vertex v3;
-					v3.Position = positions[i[6] - 1];
-					v3.UV = uvs[i[7] - 1];
-					v3.Normal = normals[i[8] - 1];
-
-					// Add the vertices to the vector
-					mVertices.push_back(v1);
-					mVertices.push_back(v2);
-					mVertices.push_back(v3);
-
-					// Add three more indices
-					mIndices.push_back(triangleCounter++);
-					mIndices.push_back(triangleCounter++);
-					mIndices.push_back(triangleCounter++);
-				}
+				return false;
 			}
 
-			// Close
-			obj.close();
+			OptimizeMesh(mVertices, mIndices, &mOptimizationStatistics);
+			mVertexCount = static_cast<uint32_t>(mVertices.size());
+			mIndexCount = static_cast<uint32_t>(mIndices.size());
 
 			return true;
 		}
@@ -157,14 +79,20 @@ namespace Rig3D
 	{
 	public:
 		std::vector<Vertex>		mVertices;
-		std::vector<uint16_t>	mIndices;
+		std::vector<uint32_t>	mIndices;	// Narrowed to 16 bits on upload when the vertex count allows
 
 		uint32_t mVertexCount;
 		uint32_t mIndexCount;
 
 		const char* mFilename;
 
-		OBJResource(const char* filename) : mVertexCount(0), mIndexCount(0), mFilename(filename)
+		cliqCity::multicore::TaskDispatcher* mDispatcher;
+
+		TangentFrameMode mTangentFrameMode;
+
+		MeshOptimizationStatistics mOptimizationStatistics;
+
+		OBJResource(const char* filename, cliqCity::multicore::TaskDispatcher* dispatcher = nullptr) : mVertexCount(0), mIndexCount(0), mFilename(filename), mDispatcher(dispatcher), mTangentFrameMode(TANGENT_FRAME_FACE_AVERAGE)
 		{
 
 		}
@@ -185,163 +113,111 @@ namespace Rig3D
 			mVertices.clear();
 			mIndices.clear();
 
-			// File input object
-			std::ifstream obj(mFilename);
+			MemoryMappedFile file;
+			if (!file.Open(mFilename))
+			{
+				return false;
+			}
 
-			// Check for successful open
-			if (!obj.is_open())
+			return Load(file.GetData(), file.GetSize());
+		}
+
+		// Builds the mesh from source text already in memory, e.g. a mapping the caller has also hashed.
+		bool Load(const char* source, const size_t& size)
+		{
+			mVertices.clear();
+			mIndices.clear();
+
+			OBJData data;
+			if (!ParseOBJ(data, source, size, mDispatcher) || !BuildOBJMesh(mVertices, mIndices, data))
 			{
 				return false;
 			}
 
-			// Variables used while reading the file
-			std::vector<vec3f> positions;     // Positions from the file
-			std::vector<vec3f> normals;       // Normals from the file
-			std::vector<vec2f> uvs;           // UVs from the file
-			std::map<int, std::vector<vec3f>> sharedTangentMap;
-			std::map<int, std::vector<vec3f>> sharedBitangentMap;
-			unsigned int triangleCounter = 0;    // Count of triangles/mIndices
-			char chars[100];                     // String for line reading
-
-												 // Still good?
-			while (obj.good())
+			GenerateTangentFrames(mVertices, mIndices, mTangentFrameMode);
+
+			OptimizeMesh(mVertices, mIndices, &mOptimizationStatistics);
+			mVertexCount = static_cast<uint32_t>(mVertices.size());
+			mIndexCount = static_cast<uint32_t>(mIndices.size());
+
+			return true;
+		}
+	};
+
+	// OBJResource that goes through a binary mesh cache: Load reads cacheFilename when it was built from the current
+	// source contents and tangent frame mode, and otherwise parses the source and rewrites the cache. Re-importing a changed file therefore
+	// pays the parse for that file only.
+	template<class Vertex>
+	class CachedOBJResource : public OBJResource<Vertex>
+	{
+	public:
+		const char* mCacheFilename;
+
+		bool mWasCached;
+
+		CachedOBJResource(const char* filename, const char* cacheFilename, cliqCity::multicore::TaskDispatcher* dispatcher = nullptr) : OBJResource<Vertex>(filename, dispatcher), mCacheFilename(cacheFilename), mWasCached(false)
+		{
+
+		}
+
+		CachedOBJResource() : CachedOBJResource(nullptr, nullptr)
+		{
+
+		}
+
+		bool Load()
+		{
+			mWasCached = false;
+
+			// Hashed and, on a miss, parsed from the same mapping
+			MemoryMappedFile source;
+			if (!source.Open(this->mFilename))
 			{
-				// Get the line (100 characters should be more than enough)
-				obj.getline(chars, 100);
+				return false;
+			}
 
-				// Check the type of line
-				if (chars[0] == 'v' && chars[1] == 'n')
-				{
-					// Read the 3 numbers directly into an XMFLOAT3
-					vec3f norm;
-					sscanf_s(
-						chars,
-						"vn %f %f %f",
-						&norm.x, &norm.y, &norm.z);
-
-					// Add to the list of normals
-					normals.push_back(norm);
-				}
-				else if (chars[0] == 'v' && chars[1] == 't')
-				{
-					// Read the 2 numbers directly into an XMFLOAT2
-					vec2f uv;
-					sscanf_s(
-						chars,
-						"vt %f %f",
-						&uv.x, &uv.y);
-
-					// Add to the list of uv's
-					uvs.push_back(uv);
-				}
-				else if (chars[0] == 'v')
+			// The tangents depend on the mode as well as the source, so both are in the key
+			uint64_t sourceHash = HashMeshSource(source.GetData(), source.GetSize()) ^ ((static_cast<uint64_t>(this->mTangentFrameMode) + 1) * 0x9e3779b97f4a7c15ull);
+
+			MeshCache cache;
+			if (OpenMeshCache(cache, mCacheFilename, sourceHash, sizeof(Vertex), GetMeshCacheVertexLayout<Vertex>()))
+			{
+				ReadMeshCacheVector(cache, MESH_CACHE_VERTICES, this->mVertices);
+				if (cache.header->indexSize == sizeof(uint32_t))
 				{
-					// Read the 3 numbers directly into an XMFLOAT3
-					vec3f pos;
-					sscanf_s(
-						chars,
-						"v %f %f %f",
-						&pos.x, &pos.y, &pos.z);
-
-					// Add to the positions
-					positions.push_back(pos);
+					ReadMeshCacheVector(cache, MESH_CACHE_INDICES, this->mIndices);
 				}
-				else if (chars[0] == 'f')
+				else
 				{
-					// Read the 9 face indices into an array
-					unsigned int i[9];
-					sscanf_s(
-						chars,
-						"f %d/%d/%d %d/%d/%d %d/%d/%d",
-						&i[0], &i[1], &i[2],
-						&i[3], &i[4], &i[5],
-						&i[6], &i[7], &i[8]);
-
-					// - Create the mVertices by looking up
-					//    corresponding data from vectors
-					// - OBJ File indices are 1-based, so
-					//    they need to be adusted
-					Vertex v1;
-					v1.Position = positions[i[0] - 1];
-					v1.UV = uvs[i[1] - 1];
-					v1.Normal = normals[i[2] - 1];
-
-					Vertex v2;
-					v2.Position = positions[i[3] - 1];
-					v2.UV = uvs[i[4] - 1];
-					v2.Normal = normals[i[5] - 1];
-
-					Vertex v3;
-					v3.Position = positions[i[6] - 1];
-					v3.UV = uvs[i[7] - 1];
-					v3.Normal = normals[i[8] - 1];
-
-					// Add the vertices to the vector
-					mVertices.push_back(v1);
-					mVertices.push_back(v2);
-					mVertices.push_back(v3);
-
-					// Add three more indices
-					mIndices.push_back(triangleCounter++);
-					mIndices.push_back(triangleCounter++);
-					mIndices.push_back(triangleCounter++);
-
-					float x1 = v2.Position.x - v1.Position.x;
-					float x2 = v3.Position.x - v1.Position.x;
-					float y1 = v2.Position.y - v1.Position.y;
-					float y2 = v3.Position.y - v1.Position.y;
-					float z1 = v2.Position.z - v1.Position.z;
-					float z2 = v3.Position.z - v1.Position.z;
-
-					float s1 = v2.UV.x - v1.UV.x;
-					float s2 = v3.UV.x - v1.UV.x;
-					float t1 = v2.UV.y - v1.UV.y;
-					float t2 = v3.UV.y - v1.UV.y;
-
-					float r = 1.0f / ((s1 * t2) - (s2 * t1));
-					vec3f tangent = { (((t2 * x1) - (t1 * x2)) * r), (((t2 * y1) - (t1 * y2)) * r), (((t2 * z1) - (t1 * z2)) * r) };
-					vec3f bitangent = { (((s2 * x1) - (s1 * x2)) * r), (((s2 * y1) - (s1 * y2)) * r), (((s2 * z1) - (s1 * z2)) * r) };
-
-					for (int j = 3; j >= 0; j--) {
-						int index = triangleCounter - j;
-						if (sharedTangentMap.find(index) == sharedTangentMap.end()) {
-							std::vector<vec3f> tangents = { tangent };
-							std::vector<vec3f> bitangents = { bitangent };
-							sharedTangentMap.insert({ index, tangents });
-							sharedBitangentMap.insert({ index, bitangents });
-						}
-						else {
-							sharedTangentMap.at(index).push_back(tangent);
-							sharedBitangentMap.at(index).push_back(bitangent);
-						}
-					}
+					std::vector<uint16_t> indices;
+					ReadMeshCacheVector(cache, MESH_CACHE_INDICES, indices);
+					this->mIndices.assign(indices.begin(), indices.end());
 				}
+
+				this->mVertexCount = static_cast<uint32_t>(this->mVertices.size());
+				this->mIndexCount = static_cast<uint32_t>(this->mIndices.size());
+				mWasCached = true;
+				return true;
 			}
 
-			for (unsigned int i = 0; i < mVertices.size(); i++)
+			// A mesh with no faces has nothing to draw or cache
+			if (!OBJResource<Vertex>::Load(source.GetData(), source.GetSize()) || this->mVertices.empty() || this->mIndices.empty())
 			{
-				std::vector<vec3f>& faceTangents = sharedTangentMap.at(i);
-				std::vector<vec3f>& faceBitangents = sharedBitangentMap.at(i);
-				vec3f vertexTangent = { 0.0f, 0.0f, 0.0f };
-				vec3f vertexBitangent = { 0.0f, 0.0f, 0.0f };
-				vec3f& vertexNormal = mVertices[i].Normal;
-
-				for (unsigned int j = 0; j < faceTangents.size(); j++) {
-					vertexTangent += vec4f(faceTangents[j]);
-					vertexBitangent += vec4f(faceBitangents[j]);
-				}
+				return false;
+			}
 
-				vertexBitangent /= (float)faceBitangents.size();
-				vertexTangent = cliqCity::graphicsMath::normalize(vertexTangent / (float)faceTangents.size());
-				vertexTangent = cliqCity::graphicsMath::normalize((vertexTangent - vertexNormal * cliqCity::graphicsMath::dot(vertexNormal, vertexTangent)));
-				mVertices[i].Tangent = vec4f(vertexTangent, 0.0f);
-				mVertices[i].Tangent.w = cliqCity::graphicsMath::dot(cliqCity::graphicsMath::cross(vertexNormal, vertexTangent), vertexBitangent);
-				mVertices[i].Tangent.w = (mVertices[i].Tangent.w < 0.0f) ? -1.0f : 1.0f;
+			// Stored at the width the mesh will be uploaded with
+			if (GetIndexSize(this->mVertexCount) == sizeof(uint16_t))
+			{
+				std::vector<uint16_t> indices(this->mIndexCount);
+				ConvertIndices(&indices[0], &this->mIndices[0], this->mIndexCount);
+				WriteMeshCache(mCacheFilename, sourceHash, &this->mVertices[0], this->mVertexCount, &indices[0], this->mIndexCount);
+			}
+			else
+			{
+				WriteMeshCache(mCacheFilename, sourceHash, &this->mVertices[0], this->mVertexCount, &this->mIndices[0], this->mIndexCount);
 			}
 
-			// Close
-			obj.close();
-			
 			return true;
 		}
 	};
@@ -365,8 +241,44 @@ namespace Rig3D
 		//template<template<typename> class Resource, class Vertex>
 		//void LoadMesh(IMesh** mesh, IRenderer* renderer, Resource<Vertex>& resource);
 
+		// Returns false and leaves *mesh null if the resource fails to load.
+		template<template<typename> class BaseRenderer, class API, template<typename> class Resource, class Vertex>
+		bool LoadMesh(IMesh** mesh, TSingleton<BaseRenderer, API>* renderer, Resource<Vertex>& resource);
+
+		// Creates the mesh from a resource that is already loaded, e.g. parsed on a worker by AssetLoader. Call from
+		// the thread that owns the renderer and the allocator. Returns false and leaves *mesh null if it is empty.
+		template<template<typename> class BaseRenderer, class API, template<typename> class Resource, class Vertex>
+		bool UploadMesh(IMesh** mesh, TSingleton<BaseRenderer, API>* renderer, Resource<Vertex>& resource);
+
+		// Fills an existing mesh from a loaded resource, e.g. one whose buffers were released with VReleaseMesh.
+		// Returns false without touching the mesh if the resource is empty.
+		template<template<typename> class BaseRenderer, class API, template<typename> class Resource, class Vertex>
+		bool SetMeshBuffers(IMesh* mesh, TSingleton<BaseRenderer, API>* renderer, Resource<Vertex>& resource);
+
+		// Loads the resource and uploads it as QuantizedVertex3 or QuantizedTangentVertex. bounds selects UNORM16
+		// positions and receives the dequantization range; nullptr stores positions as half floats. Returns false and
+		// leaves *mesh null if the resource fails to load. The caller supplies the matching input layout and a vertex
+		// shader that decodes the format as described in VertexQuantization.h, including rebuilding position.w.
+		template<class QuantizedVertex, template<typename> class BaseRenderer, class API, template<typename> class Resource, class Vertex>
+		bool LoadQuantizedMesh(IMesh** mesh, TSingleton<BaseRenderer, API>* renderer, Resource<Vertex>& resource, VertexQuantizationBounds* bounds = nullptr, const bool& splitStreams = false);
+
+		// Loads the resource de-interleaved into a position stream and an attribute stream. Returns false and leaves
+		// *mesh null if the resource fails to load.
+		template<template<typename> class BaseRenderer, class API, template<typename> class Resource, class Vertex>
+		bool LoadSplitMesh(IMesh** mesh, TSingleton<BaseRenderer, API>* renderer, Resource<Vertex>& resource);
+
+		// Uploads straight out of a mapped cache file when it matches the resource's source file; otherwise loads
+		// the resource and rewrites the cache. Returns false if neither the cache nor the resource can be loaded.
 		template<template<typename> class BaseRenderer, class API, template<typename> class Resource, class Vertex>
-		void LoadMesh(IMesh** mesh, TSingleton<BaseRenderer, API>* renderer, Resource<Vertex>& resource);
+		bool LoadCachedMesh(IMesh** mesh, TSingleton<BaseRenderer, API>* renderer, Resource<Vertex>& resource, const char* cacheFilename);
+
+		// Uploads a static index buffer of the narrowest width that addresses vertexCount vertices.
+		template<template<typename> class BaseRenderer, class API, class Index>
+		void SetMeshIndexBuffer(IMesh* mesh, TSingleton<BaseRenderer, API>* renderer, Index* indices, const uint32_t& indexCount, const uint32_t& vertexCount);
+
+	private:
+		template<template<typename> class BaseRenderer, class API, class Vertex>
+		void SetSplitMeshVertexBuffers(IMesh* mesh, TSingleton<BaseRenderer, API>* renderer, const std::vector<Vertex>& vertices);
 	};
 
 	template<class Allocator>
@@ -419,13 +331,195 @@ namespace Rig3D
 
 	template<class Allocator>
 	template<template<typename> class BaseRenderer, class API, template<typename> class Resource, class Vertex>
-	void MeshLibrary<Allocator>::LoadMesh(IMesh** mesh, TSingleton<BaseRenderer, API>* renderer, Resource<Vertex>& resource)
+	bool MeshLibrary<Allocator>::LoadMesh(IMesh** mesh, TSingleton<BaseRenderer, API>* renderer, Resource<Vertex>& resource)
 	{
-		resource.Load();
+		if (!resource.Load())
+		{
+			*mesh = nullptr;
+			return false;
+		}
 
-		(renderer->GetGraphicsAPI() == GRAPHICS_API_DIRECTX11) ? RIG_NEW(DX11Mesh, mAllocator, *mesh)() : RIG_NEW(DX11Mesh, mAllocator, *mesh)();
-		renderer->VSetStaticMeshVertexBuffer(*mesh, &resource.mVertices[0], sizeof(Vertex) * resource.mVertices.size(), sizeof(Vertex));
-		renderer->VSetStaticMeshIndexBuffer(*mesh, &resource.mIndices[0], resource.mIndices.size());
+		return UploadMesh(mesh, renderer, resource);
+	}
+
+	template<class Allocator>
+	template<template<typename> class BaseRenderer, class API, template<typename> class Resource, class Vertex>
+	bool MeshLibrary<Allocator>::UploadMesh(IMesh** mesh, TSingleton<BaseRenderer, API>* renderer, Resource<Vertex>& resource)
+	{
+		// Checked before allocating, the library allocator cannot give the mesh back
+		if (resource.mVertices.empty() || resource.mIndices.empty())
+		{
+			*mesh = nullptr;
+			return false;
+		}
+
+		NewMesh(mesh, renderer);
+		return SetMeshBuffers(*mesh, renderer, resource);
+	}
+
+	template<class Allocator>
+	template<template<typename> class BaseRenderer, class API, template<typename> class Resource, class Vertex>
+	bool MeshLibrary<Allocator>::SetMeshBuffers(IMesh* mesh, TSingleton<BaseRenderer, API>* renderer, Resource<Vertex>& resource)
+	{
+		if (resource.mVertices.empty() || resource.mIndices.empty())
+		{
+			return false;
+		}
+
+		renderer->VSetStaticMeshVertexBuffer(mesh, &resource.mVertices[0], sizeof(Vertex) * resource.mVertices.size(), sizeof(Vertex));
+		SetMeshIndexBuffer(mesh, renderer, &resource.mIndices[0], static_cast<uint32_t>(resource.mIndices.size()), static_cast<uint32_t>(resource.mVertices.size()));
+		return true;
+	}
+
+	template<class Allocator>
+	template<class QuantizedVertex, template<typename> class BaseRenderer, class API, template<typename> class Resource, class Vertex>
+	bool MeshLibrary<Allocator>::LoadQuantizedMesh(IMesh** mesh, TSingleton<BaseRenderer, API>* renderer, Resource<Vertex>& resource, VertexQuantizationBounds* bounds, const bool& splitStreams)
+	{
+		if (!resource.Load() || resource.mVertices.empty() || resource.mIndices.empty())
+		{
+			*mesh = nullptr;
+			return false;
+		}
+
+		uint32_t vertexCount = static_cast<uint32_t>(resource.mVertices.size());
+		if (bounds)
+		{
+			*bounds = GetQuantizationBounds(&resource.mVertices[0], vertexCount);
+		}
+
+		std::vector<QuantizedVertex> vertices(vertexCount);
+		QuantizeVertices(&vertices[0], &resource.mVertices[0], vertexCount, bounds);
+
+		NewMesh(mesh, renderer);
+		if (splitStreams)
+		{
+			SetSplitMeshVertexBuffers(*mesh, renderer, vertices);
+		}
+		else
+		{
+			renderer->VSetStaticMeshVertexBuffer(*mesh, &vertices[0], sizeof(QuantizedVertex) * vertices.size(), sizeof(QuantizedVertex));
+		}
+		SetMeshIndexBuffer(*mesh, renderer, &resource.mIndices[0], static_cast<uint32_t>(resource.mIndices.size()), static_cast<uint32_t>(resource.mVertices.size()));
+		return true;
+	}
+
+	template<class Allocator>
+	template<template<typename> class BaseRenderer, class API, template<typename> class Resource, class Vertex>
+	bool MeshLibrary<Allocator>::LoadSplitMesh(IMesh** mesh, TSingleton<BaseRenderer, API>* renderer, Resource<Vertex>& resource)
+	{
+		if (!resource.Load() || resource.mVertices.empty() || resource.mIndices.empty())
+		{
+			*mesh = nullptr;
+			return false;
+		}
+
+		NewMesh(mesh, renderer);
+		SetSplitMeshVertexBuffers(*mesh, renderer, resource.mVertices);
+		SetMeshIndexBuffer(*mesh, renderer, &resource.mIndices[0], static_cast<uint32_t>(resource.mIndices.size()), static_cast<uint32_t>(resource.mVertices.size()));
+		return true;
+	}
+
+	template<class Allocator>
+	template<template<typename> class BaseRenderer, class API, template<typename> class Resource, class Vertex>
+	bool MeshLibrary<Allocator>::LoadCachedMesh(IMesh** mesh, TSingleton<BaseRenderer, API>* renderer, Resource<Vertex>& resource, const char* cacheFilename)
+	{
+		uint64_t sourceHash;
+		if (!HashMeshSourceFile(resource.mFilename, sourceHash))
+		{
+			return false;
+		}
+
+		MeshCache cache;
+		if (OpenMeshCache(cache, cacheFilename, sourceHash, sizeof(Vertex), GetMeshCacheVertexLayout<Vertex>()))
+		{
+			uint64_t vertexSize;
+			void* vertices = const_cast<void*>(GetMeshCacheBlob(cache, MESH_CACHE_VERTICES, &vertexSize));
+			void* indices = const_cast<void*>(GetMeshCacheBlob(cache, MESH_CACHE_INDICES));
+
+			// Buffers are created with the blobs as initial data, so the mapping can close once they exist
+			NewMesh(mesh, renderer);
+			renderer->VSetStaticMeshVertexBuffer(*mesh, vertices, static_cast<size_t>(vertexSize), sizeof(Vertex));
+			if (cache.header->indexSize == sizeof(uint32_t))
+			{
+				SetMeshIndexBuffer(*mesh, renderer, static_cast<uint32_t*>(indices), cache.header->indexCount, cache.header->vertexCount);
+			}
+			else
+			{
+				SetMeshIndexBuffer(*mesh, renderer, static_cast<uint16_t*>(indices), cache.header->indexCount, cache.header->vertexCount);
+			}
+			return true;
+		}
+
+		if (!resource.Load() || resource.mVertices.empty() || resource.mIndices.empty())
+		{
+			*mesh = nullptr;
+			return false;
+		}
+
+		uint32_t vertexCount = static_cast<uint32_t>(resource.mVertices.size());
+		uint32_t indexCount = static_cast<uint32_t>(resource.mIndices.size());
+
+		NewMesh(mesh, renderer);
+		renderer->VSetStaticMeshVertexBuffer(*mesh, &resource.mVertices[0], sizeof(Vertex) * vertexCount, sizeof(Vertex));
+
+		// The cache stores indices at the width they are uploaded with, so the narrowed copy is uploaded as is
+		if (GetIndexSize(vertexCount) == sizeof(uint16_t))
+		{
+			std::vector<uint16_t> indices(indexCount);
+			ConvertIndices(&indices[0], &resource.mIndices[0], indexCount);
+			WriteMeshCache(cacheFilename, sourceHash, &resource.mVertices[0], vertexCount, &indices[0], indexCount);
+			SetMeshIndexBuffer(*mesh, renderer, &indices[0], indexCount, vertexCount);
+		}
+		else
+		{
+			WriteMeshCache(cacheFilename, sourceHash, &resource.mVertices[0], vertexCount, &resource.mIndices[0], indexCount);
+			SetMeshIndexBuffer(*mesh, renderer, &resource.mIndices[0], indexCount, vertexCount);
+		}
+
+		return true;
+	}
+
+	template<class Allocator>
+	template<template<typename> class BaseRenderer, class API, class Index>
+	void MeshLibrary<Allocator>::SetMeshIndexBuffer(IMesh* mesh, TSingleton<BaseRenderer, API>* renderer, Index* indices, const uint32_t& indexCount, const uint32_t& vertexCount)
+	{
+		if (GetIndexSize(vertexCount) == sizeof(uint16_t))
+		{
+			if (sizeof(Index) == sizeof(uint16_t))
+			{
+				renderer->VSetStaticMeshIndexBuffer(mesh, reinterpret_cast<uint16_t*>(indices), indexCount);
+				return;
+			}
+
+			std::vector<uint16_t> narrow(indexCount);
+			ConvertIndices(&narrow[0], indices, indexCount);
+			renderer->VSetStaticMeshIndexBuffer(mesh, &narrow[0], indexCount);
+		}
+		else
+		{
+			if (sizeof(Index) == sizeof(uint32_t))
+			{
+				renderer->VSetStaticMeshIndexBuffer(mesh, reinterpret_cast<uint32_t*>(indices), indexCount);
+				return;
+			}
+
+			std::vector<uint32_t> wide(indexCount);
+			ConvertIndices(&wide[0], indices, indexCount);
+			renderer->VSetStaticMeshIndexBuffer(mesh, &wide[0], indexCount);
+		}
+	}
+
+	template<class Allocator>
+	template<template<typename> class BaseRenderer, class API, class Vertex>
+	void MeshLibrary<Allocator>::SetSplitMeshVertexBuffers(IMesh* mesh, TSingleton<BaseRenderer, API>* renderer, const std::vector<Vertex>& vertices)
+	{
+		VertexStreamLayout layout = GetVertexStreamLayout<Vertex>();
+		std::vector<uint8_t> positions;
+		std::vector<uint8_t> attributes;
+		SplitVertexStreams(positions, attributes, vertices);
+
+		renderer->VSetStaticMeshVertexBuffer(mesh, &positions[0], positions.size(), layout.positionStride);
+		renderer->VSetStaticMeshAttributeBuffer(mesh, &attributes[0], attributes.size(), layout.attributeStride);
 	}
 }
 
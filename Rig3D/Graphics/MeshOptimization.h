@@ -0,0 +1,425 @@
+#pragma once
+#include "Rig3D/TaskDispatch/TaskDispatcher.h"
+#include <vector>
+#include <stdint.h>
+#include <string.h>
+
+#define RIG_VERTEX_CACHE_SIZE 16
+
+// Index and vertex buffer processing for meshes loaded as triangle soup: exact vertex welding, index reordering for
+// the post transform vertex cache and vertex reordering for fetch locality. Functions work on any integral index
+// type and leave the set of triangles unchanged. They run in place so they can be called right after load or from
+// an offline cook step.
+namespace Rig3D
+{
+	struct MeshOptimizationStatistics
+	{
+		uint32_t	inputVertexCount;
+		uint32_t	outputVertexCount;
+		float		inputACMR;
+		float		outputACMR;
+		float		inputATVR;
+		float		outputATVR;
+	};
+
+#pragma region Vertex Cache
+
+	// Average cache miss ratio: transformed vertices per triangle for a FIFO cache of cacheSize entries. 0.5 is the
+	// ideal for large regular meshes, 3.0 is triangle soup.
+	template<class Index>
+	inline float GetACMR(const Index* indices, const uint32_t& indexCount, const uint32_t& vertexCount, const uint32_t& cacheSize = RIG_VERTEX_CACHE_SIZE)
+	{
+		if (indexCount < 3)
+		{
+			return 0.0f;
+		}
+
+		std::vector<uint32_t> cacheTimes(vertexCount, 0);
+		uint32_t time = cacheSize + 1;
+		uint32_t misses = 0;
+
+		for (uint32_t i = 0; i < indexCount; i++)
+		{
+			uint32_t v = static_cast<uint32_t>(indices[i]);
+			if (time - cacheTimes[v] > cacheSize)
+			{
+				cacheTimes[v] = time++;
+				misses++;
+			}
+		}
+
+		return static_cast<float>(misses) / static_cast<float>(indexCount / 3);
+	}
+
+	// Average transform to vertex ratio: transformed vertices per referenced vertex. 1.0 is ideal and, unlike
+	// ACMR, comparable between meshes of different topology.
+	template<class Index>
+	inline float GetATVR(const Index* indices, const uint32_t& indexCount, const uint32_t& vertexCount, const uint32_t& cacheSize = RIG_VERTEX_CACHE_SIZE)
+	{
+		if (indexCount < 3)
+		{
+			return 0.0f;
+		}
+
+		std::vector<uint32_t> cacheTimes(vertexCount, 0);
+		std::vector<uint8_t> referenced(vertexCount, 0);
+		uint32_t time = cacheSize + 1;
+		uint32_t misses = 0;
+		uint32_t referencedCount = 0;
+
+		for (uint32_t i = 0; i < indexCount; i++)
+		{
+			uint32_t v = static_cast<uint32_t>(indices[i]);
+			if (time - cacheTimes[v] > cacheSize)
+			{
+				cacheTimes[v] = time++;
+				misses++;
+			}
+
+			referencedCount += (referenced[v] == 0);
+			referenced[v] = 1;
+		}
+
+		return static_cast<float>(misses) / static_cast<float>(referencedCount);
+	}
+
+	// Tipsify (Sander, Nehab & Barczak 2007). Fans out around a focus vertex, then moves the focus to the adjacent
+	// vertex that will still be in the cache after its remaining triangles are emitted. Linear in the index count.
+	template<class Index>
+	inline void OptimizeVertexCache(Index* indices, const uint32_t& indexCount, const uint32_t& vertexCount, const uint32_t& cacheSize = RIG_VERTEX_CACHE_SIZE)
+	{
+		uint32_t triangleCount = indexCount / 3;
+		if (triangleCount == 0)
+		{
+			return;
+		}
+
+		std::vector<Index> input(indices, indices + triangleCount * 3);
+		std::vector<uint32_t> liveCounts(vertexCount, 0);
+		std::vector<uint32_t> offsets(vertexCount + 1, 0);
+		std::vector<uint32_t> adjacency(triangleCount * 3);
+		std::vector<uint32_t> cacheTimes(vertexCount, 0);
+		std::vector<uint8_t> emitted(triangleCount, 0);
+		std::vector<uint32_t> deadEnd;
+		std::vector<uint32_t> candidates;
+		deadEnd.reserve(triangleCount * 3);
+
+		// Vertex -> triangle adjacency as a counting sort
+		for (uint32_t i = 0; i < triangleCount * 3; i++)
+		{
+			liveCounts[input[i]]++;
+		}
+
+		for (uint32_t v = 0; v < vertexCount; v++)
+		{
+			offsets[v + 1] = offsets[v] + liveCounts[v];
+		}
+
+		for (uint32_t i = 0; i < triangleCount * 3; i++)
+		{
+			uint32_t v = static_cast<uint32_t>(input[i]);
+			adjacency[offsets[v] + cacheTimes[v]++] = i / 3;
+		}
+
+		memset(&cacheTimes[0], 0, sizeof(uint32_t) * vertexCount);
+
+		uint32_t time = cacheSize + 1;
+		uint32_t cursor = 0;
+		uint32_t out = 0;
+		uint32_t focus = static_cast<uint32_t>(input[0]);
+
+		while (true)
+		{
+			candidates.clear();
+			for (uint32_t a = offsets[focus]; a < offsets[focus + 1]; a++)
+			{
+				uint32_t t = adjacency[a];
+				if (emitted[t])
+				{
+					continue;
+				}
+
+				for (uint32_t k = 0; k < 3; k++)
+				{
+					uint32_t v = static_cast<uint32_t>(input[t * 3 + k]);
+					indices[out++] = static_cast<Index>(v);
+					deadEnd.push_back(v);
+					candidates.push_back(v);
+					liveCounts[v]--;
+
+					if (time - cacheTimes[v] > cacheSize)
+					{
+						cacheTimes[v] = time++;
+					}
+				}
+
+				emitted[t] = 1;
+			}
+
+			// Prefer the candidate that entered the cache earliest but will not be evicted before its fan completes
+			uint32_t next = UINT32_MAX;
+			int32_t bestPriority = -1;
+			for (uint32_t v : candidates)
+			{
+				if (liveCounts[v] == 0)
+				{
+					continue;
+				}
+
+				int32_t priority = 0;
+				if (time - cacheTimes[v] + 2 * liveCounts[v] <= cacheSize)
+				{
+					priority = static_cast<int32_t>(time - cacheTimes[v]);
+				}
+
+				if (priority > bestPriority)
+				{
+					bestPriority = priority;
+					next = v;
+				}
+			}
+
+			while (next == UINT32_MAX && !deadEnd.empty())
+			{
+				uint32_t v = deadEnd.back();
+				deadEnd.pop_back();
+				if (liveCounts[v] > 0)
+				{
+					next = v;
+				}
+			}
+
+			if (next == UINT32_MAX)
+			{
+				while (cursor < vertexCount && liveCounts[cursor] == 0)
+				{
+					cursor++;
+				}
+
+				if (cursor == vertexCount)
+				{
+					break;
+				}
+
+				next = cursor;
+			}
+
+			focus = next;
+		}
+	}
+
+	template<class Index>
+	struct VertexCacheRange
+	{
+		Index*						indices;
+		uint32_t					indexCount;
+		uint32_t					vertexCount;
+		cliqCity::multicore::TaskID	taskID;
+	};
+
+	template<class Index>
+	inline void PerformVertexCacheTask(const cliqCity::multicore::TaskData& data)
+	{
+		VertexCacheRange<Index>* range = reinterpret_cast<VertexCacheRange<Index>*>(data.mKernelData);
+		OptimizeVertexCache(range->indices, range->indexCount, range->vertexCount);
+	}
+
+	// Optimizes independent index ranges, e.g. the levels of a LOD chain, one task per range.
+	template<class Index>
+	inline void OptimizeVertexCacheParallel(cliqCity::multicore::TaskDispatcher& dispatcher, VertexCacheRange<Index>* ranges, const uint32_t& rangeCount)
+	{
+		cliqCity::multicore::TaskData data;
+		for (uint32_t i = 0; i < rangeCount; i++)
+		{
+			data.mKernelData = &ranges[i];
+			ranges[i].taskID = dispatcher.AddTask(data, PerformVertexCacheTask<Index>);
+		}
+
+		for (uint32_t i = 0; i < rangeCount; i++)
+		{
+			dispatcher.WaitForTask(ranges[i].taskID);
+		}
+	}
+
+#pragma endregion
+
+#pragma region Welding
+
+	// FNV-1a over the vertex bytes. Vertices are compared bit for bit, so the hash must be too.
+	inline uint32_t HashVertexBytes(const void* vertex, const size_t& size)
+	{
+		const uint8_t* bytes = reinterpret_cast<const uint8_t*>(vertex);
+		uint32_t hash = 2166136261u;
+		for (size_t i = 0; i < size; i++)
+		{
+			hash = (hash ^ bytes[i]) * 16777619u;
+		}
+
+		return hash;
+	}
+
+	// Merges vertices whose attributes are bitwise equal and remaps indices to the survivors. Unique vertices keep
+	// their first occurrence order at the front of the array. Returns the unique vertex count. Vertex must not
+	// contain padding.
+	template<class Vertex, class Index>
+	inline uint32_t WeldVertices(Vertex* vertices, const uint32_t& vertexCount, Index* indices, const uint32_t& indexCount)
+	{
+		uint32_t tableSize = 1;
+		while (tableSize < vertexCount * 2)
+		{
+			tableSize <<= 1;
+		}
+
+		std::vector<uint32_t> table(tableSize, UINT32_MAX);
+		std::vector<uint32_t> remap(vertexCount);
+		uint32_t uniqueCount = 0;
+
+		for (uint32_t v = 0; v < vertexCount; v++)
+		{
+			uint32_t slot = HashVertexBytes(&vertices[v], sizeof(Vertex)) & (tableSize - 1);
+			while (table[slot] != UINT32_MAX && memcmp(&vertices[table[slot]], &vertices[v], sizeof(Vertex)) != 0)
+			{
+				slot = (slot + 1) & (tableSize - 1);
+			}
+
+			if (table[slot] == UINT32_MAX)
+			{
+				vertices[uniqueCount] = vertices[v];
+				table[slot] = uniqueCount++;
+			}
+
+			remap[v] = table[slot];
+		}
+
+		for (uint32_t i = 0; i < indexCount; i++)
+		{
+			indices[i] = static_cast<Index>(remap[indices[i]]);
+		}
+
+		return uniqueCount;
+	}
+
+#pragma endregion
+
+#pragma region Vertex Fetch
+
+	// Reorders vertices by first use in the index buffer so the input assembler reads memory linearly, and drops
+	// unreferenced vertices. Run after OptimizeVertexCache. Returns the referenced vertex count.
+	template<class Vertex, class Index>
+	inline uint32_t OptimizeVertexFetch(Vertex* vertices, const uint32_t& vertexCount, Index* indices, const uint32_t& indexCount)
+	{
+		std::vector<uint32_t> remap(vertexCount, UINT32_MAX);
+		std::vector<Vertex> source(vertices, vertices + vertexCount);
+		uint32_t next = 0;
+
+		for (uint32_t i = 0; i < indexCount; i++)
+		{
+			uint32_t v = static_cast<uint32_t>(indices[i]);
+			if (remap[v] == UINT32_MAX)
+			{
+				vertices[next] = source[v];
+				remap[v] = next++;
+			}
+
+			indices[i] = static_cast<Index>(remap[v]);
+		}
+
+		return next;
+	}
+
+#pragma endregion
+
+#pragma region Pipeline
+
+	// Weld, vertex cache and vertex fetch passes in order. Returns the new vertex count; the index count is unchanged.
+	template<class Vertex, class Index>
+	inline uint32_t OptimizeMesh(Vertex* vertices, const uint32_t& vertexCount, Index* indices, const uint32_t& indexCount, MeshOptimizationStatistics* statistics = nullptr)
+	{
+		if (statistics)
+		{
+			statistics->inputVertexCount = vertexCount;
+			statistics->inputACMR = GetACMR(indices, indexCount, vertexCount);
+			statistics->inputATVR = GetATVR(indices, indexCount, vertexCount);
+		}
+
+		uint32_t count = WeldVertices(vertices, vertexCount, indices, indexCount);
+		OptimizeVertexCache(indices, indexCount, count);
+		count = OptimizeVertexFetch(vertices, count, indices, indexCount);
+
+		if (statistics)
+		{
+			statistics->outputVertexCount = count;
+			statistics->outputACMR = GetACMR(indices, indexCount, count);
+			statistics->outputATVR = GetATVR(indices, indexCount, count);
+		}
+
+		return count;
+	}
+
+	template<class Vertex, class Index>
+	inline void OptimizeMesh(std::vector<Vertex>& vertices, std::vector<Index>& indices, MeshOptimizationStatistics* statistics = nullptr)
+	{
+		if (vertices.empty() || indices.empty())
+		{
+			return;
+		}
+
+		uint32_t count = OptimizeMesh(&vertices[0], static_cast<uint32_t>(vertices.size()), &indices[0], static_cast<uint32_t>(indices.size()), statistics);
+		vertices.resize(count);
+	}
+
+	template<class Vertex, class Index>
+	struct MeshOptimizationJob
+	{
+		std::vector<Vertex>*		vertices;
+		std::vector<Index>*			indices;
+		MeshOptimizationStatistics	statistics;
+		cliqCity::multicore::TaskID	taskID;
+	};
+
+	template<class Vertex, class Index>
+	inline void PerformMeshOptimizationTask(const cliqCity::multicore::TaskData& data)
+	{
+		MeshOptimizationJob<Vertex, Index>* job = reinterpret_cast<MeshOptimizationJob<Vertex, Index>*>(data.mKernelData);
+		OptimizeMesh(*job->vertices, *job->indices, &job->statistics);
+	}
+
+	// One task per mesh; the passes themselves are serial. jobs is caller owned with jobCount elements.
+	template<class Vertex, class Index>
+	inline void OptimizeMeshesParallel(cliqCity::multicore::TaskDispatcher& dispatcher, MeshOptimizationJob<Vertex, Index>* jobs, const uint32_t& jobCount)
+	{
+		cliqCity::multicore::TaskData data;
+		for (uint32_t i = 0; i < jobCount; i++)
+		{
+			data.mKernelData = &jobs[i];
+			jobs[i].taskID = dispatcher.AddTask(data, PerformMeshOptimizationTask<Vertex, Index>);
+		}
+
+		for (uint32_t i = 0; i < jobCount; i++)
+		{
+			dispatcher.WaitForTask(jobs[i].taskID);
+		}
+	}
+
+#pragma endregion
+
+#pragma region Index Width
+
+	// Narrowest index size in bytes able to address vertexCount vertices.
+	inline uint32_t GetIndexSize(const uint32_t& vertexCount)
+	{
+		return (vertexCount <= 0x10000) ? sizeof(uint16_t) : sizeof(uint32_t);
+	}
+
+	// Converts between index widths. Narrowing assumes every index fits the output type (see GetIndexSize).
+	template<class Output, class Index>
+	inline void ConvertIndices(Output* output, const Index* indices, const uint32_t& indexCount)
+	{
+		for (uint32_t i = 0; i < indexCount; i++)
+		{
+			output[i] = static_cast<Output>(indices[i]);
+		}
+	}
+
+#pragma endregion
+}
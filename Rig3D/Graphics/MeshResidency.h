@@ -0,0 +1,461 @@
+#pragma once
+#include "Rig3D\Graphics\AssetLoader.h"
+#include "Rig3D\Graphics\MeshLibrary.h"
+#include <deque>
+#include <vector>
+#include <string.h>
+#include <stdint.h>
+
+#define RIG_MESH_RESIDENCY_NONE 0xffffffff
+
+// Streams meshes in and out under a byte budget. Each registered mesh is in one of two tiers, tracked by separate
+// least recently used lists: GPU resident (buffers exist, costed at their byte size) and CPU staged (the parsed
+// vertices and indices are still held, costed at their capacity). Meshes drawn in the current frame are never
+// evicted from the GPU. An evicted mesh with a staged copy re-uploads on the next Update; without one it re-streams
+// through an AssetLoader, so the refault costs a parse on a worker but never a stall on the render thread.
+// ReloadMesh re-imports a resident mesh the same way and swaps its buffers in Update, keeping the IMesh* stable.
+namespace Rig3D
+{
+	enum MeshResidencyState
+	{
+		MESH_RESIDENCY_EVICTED,
+		MESH_RESIDENCY_LOADING,
+		MESH_RESIDENCY_RESIDENT,
+		MESH_RESIDENCY_FAILED		// Load failed; retried only after ReloadMesh
+	};
+
+	enum MeshResidencyTier
+	{
+		MESH_RESIDENCY_TIER_GPU,
+		MESH_RESIDENCY_TIER_CPU,
+		MESH_RESIDENCY_TIER_COUNT
+	};
+
+	// Byte totals are current; counts are cumulative since construction.
+	struct MeshResidencyStatistics
+	{
+		uint64_t	gpuBytes;
+		uint64_t	cpuBytes;
+		uint64_t	gpuEvictedBytes;
+		uint64_t	cpuEvictedBytes;
+		uint32_t	residentCount;
+		uint32_t	loadingCount;
+		uint32_t	loads;				// First loads
+		uint32_t	refaults;			// Requests for a mesh that had been evicted
+		uint32_t	stagedRefaults;		// Refaults served from the CPU tier without a parse
+		uint32_t	gpuEvictions;
+		uint32_t	cpuEvictions;
+		uint32_t	failedLoads;
+		uint32_t	reloads;
+	};
+
+	template<class Resource, class Allocator, uint32_t Capacity = RIG_ASSET_LOADER_CAPACITY>
+	class MeshResidencyManager
+	{
+	public:
+		typedef AssetRequest<Resource>				Request;
+		typedef AssetLoader<Resource, Capacity>		Loader;
+
+		// Without a dispatcher, loads parse on the calling thread.
+		MeshResidencyManager(MeshLibrary<Allocator>* library, cliqCity::multicore::TaskDispatcher* dispatcher, const uint64_t& gpuBudget, const uint64_t& cpuBudget) :
+			mLoader(dispatcher),
+			mLibrary(library),
+			mSpareMesh(nullptr),
+			mFrame(0)
+		{
+			memset(&mStatistics, 0, sizeof(mStatistics));
+			SetBudget(gpuBudget, cpuBudget);
+
+			for (uint32_t t = 0; t < MESH_RESIDENCY_TIER_COUNT; t++)
+			{
+				mHead[t] = RIG_MESH_RESIDENCY_NONE;
+				mTail[t] = RIG_MESH_RESIDENCY_NONE;
+			}
+		}
+
+		// Budgets take effect on the next Update.
+		void SetBudget(const uint64_t& gpuBudget, const uint64_t& cpuBudget)
+		{
+			mBudget[MESH_RESIDENCY_TIER_GPU] = gpuBudget;
+			mBudget[MESH_RESIDENCY_TIER_CPU] = cpuBudget;
+		}
+
+		// Registers a mesh without loading it; the first RequestMesh starts the load. Returns its handle.
+		uint32_t AddMesh(const Resource& resource)
+		{
+			uint32_t handle = static_cast<uint32_t>(mEntries.size());
+			mEntries.emplace_back();
+
+			Entry& entry = mEntries.back();
+			entry.request.resource = resource;
+			entry.request.mesh = &entry.mesh;
+			entry.request.userData = reinterpret_cast<void*>(static_cast<uintptr_t>(handle));
+			return handle;
+		}
+
+		// Call for every mesh drawn this frame. Returns the mesh once resident, or nullptr while it loads; a mesh
+		// that is not resident is queued for loading.
+		IMesh* RequestMesh(const uint32_t& handle)
+		{
+			Entry& entry = mEntries[handle];
+			entry.lastUsedFrame = mFrame;
+
+			if (entry.state == MESH_RESIDENCY_RESIDENT)
+			{
+				Touch(handle);
+				return entry.mesh;
+			}
+
+			if (entry.state == MESH_RESIDENCY_LOADING || entry.state == MESH_RESIDENCY_FAILED)
+			{
+				return nullptr;
+			}
+
+			if (entry.isStaged)
+			{
+				mStaged.push_back(handle);
+				mStatistics.stagedRefaults++;
+			}
+			else if (!mLoader.Load(&entry.request))
+			{
+				// Loader is full; the next request tries again
+				return nullptr;
+			}
+
+			entry.state = MESH_RESIDENCY_LOADING;
+			mStatistics.loadingCount++;
+			(entry.wasLoaded) ? mStatistics.refaults++ : mStatistics.loads++;
+			return nullptr;
+		}
+
+		// Re-imports the mesh, e.g. after its source changed. A resident mesh keeps drawing with its current buffers
+		// until the new ones are swapped in by Update at the end of a frame; if the re-import fails it keeps the old
+		// ones. A mesh that is not resident drops its staged copy and imports fresh on its next request.
+		void ReloadMesh(const uint32_t& handle)
+		{
+			Entry& entry = mEntries[handle];
+
+			// A load in flight may have read the old source; reload again once it lands
+			if (entry.state == MESH_RESIDENCY_LOADING || entry.isReloading)
+			{
+				QueueReload(handle);
+				return;
+			}
+
+			if (entry.isStaged)
+			{
+				Unstage(handle);
+			}
+
+			if (entry.state != MESH_RESIDENCY_RESIDENT)
+			{
+				entry.state = MESH_RESIDENCY_EVICTED;
+				return;
+			}
+
+			if (!mLoader.Load(&entry.request))
+			{
+				QueueReload(handle);
+				return;
+			}
+
+			entry.isReloading = true;
+			mStatistics.reloads++;
+		}
+
+		// Owner thread, once per frame after drawing. Uploads staged refaults and finished loads, then evicts least
+		// recently used meshes until both tiers fit their budgets.
+		template<class Renderer>
+		void Update(Renderer* renderer)
+		{
+			for (uint32_t handle : mStaged)
+			{
+				Entry& entry = mEntries[handle];
+				mLibrary->SetMeshBuffers(entry.mesh, renderer, entry.request.resource);
+				MakeResident(handle);
+			}
+
+			mStaged.clear();
+
+			Request* completed[Capacity];
+			uint32_t count;
+			while ((count = mLoader.Upload(*this, renderer, completed, Capacity)) > 0)
+			{
+				for (uint32_t i = 0; i < count; i++)
+				{
+					uint32_t handle = static_cast<uint32_t>(reinterpret_cast<uintptr_t>(completed[i]->userData));
+					if (mEntries[handle].isReloading)
+					{
+						CompleteReload(handle, completed[i]->loaded);
+					}
+					else if (completed[i]->loaded)
+					{
+						Stage(handle);
+						MakeResident(handle);
+					}
+					else
+					{
+						mEntries[handle].state = MESH_RESIDENCY_FAILED;
+						mStatistics.loadingCount--;
+						mStatistics.failedLoads++;
+					}
+				}
+			}
+
+			std::vector<uint32_t> reloads;
+			reloads.swap(mReloads);
+			for (uint32_t handle : reloads)
+			{
+				mEntries[handle].isReloadQueued = false;
+				ReloadMesh(handle);
+			}
+
+			// The tail of the GPU list is the least recently drawn; stop at the first mesh drawn this frame
+			uint32_t handle = mTail[MESH_RESIDENCY_TIER_GPU];
+			while (mStatistics.gpuBytes > mBudget[MESH_RESIDENCY_TIER_GPU] && handle != RIG_MESH_RESIDENCY_NONE && mEntries[handle].lastUsedFrame != mFrame)
+			{
+				// Meshes being re-imported stay until their new buffers land
+				uint32_t previous = mEntries[handle].previous[MESH_RESIDENCY_TIER_GPU];
+				if (!mEntries[handle].isReloading)
+				{
+					EvictGPU(handle, renderer);
+				}
+
+				handle = previous;
+			}
+
+			// Staged copies are not needed to draw, so any of them may go
+			while (mStatistics.cpuBytes > mBudget[MESH_RESIDENCY_TIER_CPU] && mTail[MESH_RESIDENCY_TIER_CPU] != RIG_MESH_RESIDENCY_NONE)
+			{
+				EvictCPU(mTail[MESH_RESIDENCY_TIER_CPU]);
+			}
+
+			mFrame++;
+		}
+
+		// Called by AssetLoader::Upload. Refaults and reloads refill the existing mesh, so handles given out stay valid
+		// and the library allocator, which cannot free, is only used once per mesh. The new buffers are built on a
+		// spare mesh and swapped in, so an empty reparse returns false with the old buffers untouched.
+		template<class Renderer>
+		bool UploadMesh(IMesh** mesh, Renderer* renderer, Resource& resource)
+		{
+			if (!*mesh)
+			{
+				return mLibrary->UploadMesh(mesh, renderer, resource);
+			}
+
+			bool built = (mSpareMesh) ? mLibrary->SetMeshBuffers(mSpareMesh, renderer, resource) : mLibrary->UploadMesh(&mSpareMesh, renderer, resource);
+			if (!built)
+			{
+				return false;
+			}
+
+			renderer->VSwapMesh(*mesh, mSpareMesh);
+			renderer->VReleaseMesh(mSpareMesh);
+			return true;
+		}
+
+		inline MeshResidencyState				GetState(const uint32_t& handle)	const { return mEntries[handle].state; };
+		inline uint64_t							GetGPUBytes(const uint32_t& handle)	const { return mEntries[handle].bytes[MESH_RESIDENCY_TIER_GPU]; };
+		inline uint64_t							GetCPUBytes(const uint32_t& handle)	const { return mEntries[handle].bytes[MESH_RESIDENCY_TIER_CPU]; };
+		inline uint32_t							GetMeshCount()						const { return static_cast<uint32_t>(mEntries.size()); };
+		inline const MeshResidencyStatistics&	GetStatistics()						const { return mStatistics; };
+
+	private:
+		struct Entry
+		{
+			Request				request;
+			IMesh*				mesh;
+			uint64_t			bytes[MESH_RESIDENCY_TIER_COUNT];
+			uint64_t			lastUsedFrame;
+			uint32_t			previous[MESH_RESIDENCY_TIER_COUNT];
+			uint32_t			next[MESH_RESIDENCY_TIER_COUNT];
+			MeshResidencyState	state;
+			bool				isStaged;
+			bool				wasLoaded;
+			bool				isReloading;
+			bool				isReloadQueued;
+
+			Entry() : mesh(nullptr), lastUsedFrame(0), state(MESH_RESIDENCY_EVICTED), isStaged(false), wasLoaded(false), isReloading(false), isReloadQueued(false)
+			{
+				for (uint32_t t = 0; t < MESH_RESIDENCY_TIER_COUNT; t++)
+				{
+					bytes[t] = 0;
+					previous[t] = RIG_MESH_RESIDENCY_NONE;
+					next[t] = RIG_MESH_RESIDENCY_NONE;
+				}
+			}
+		};
+
+		Loader						mLoader;
+		std::deque<Entry>			mEntries;	// Deque so requests keep their address while meshes are added
+		std::vector<uint32_t>		mStaged;
+		std::vector<uint32_t>		mReloads;
+		MeshLibrary<Allocator>*		mLibrary;
+		IMesh*						mSpareMesh;	// Target for refills, allocated on the first one
+		uint64_t					mBudget[MESH_RESIDENCY_TIER_COUNT];
+		uint64_t					mFrame;
+		uint32_t					mHead[MESH_RESIDENCY_TIER_COUNT];
+		uint32_t					mTail[MESH_RESIDENCY_TIER_COUNT];
+		MeshResidencyStatistics		mStatistics;
+
+		void Link(const uint32_t& handle, const MeshResidencyTier& tier)
+		{
+			Entry& entry = mEntries[handle];
+			entry.previous[tier] = RIG_MESH_RESIDENCY_NONE;
+			entry.next[tier] = mHead[tier];
+
+			if (mHead[tier] != RIG_MESH_RESIDENCY_NONE)
+			{
+				mEntries[mHead[tier]].previous[tier] = handle;
+			}
+			else
+			{
+				mTail[tier] = handle;
+			}
+
+			mHead[tier] = handle;
+		}
+
+		void Unlink(const uint32_t& handle, const MeshResidencyTier& tier)
+		{
+			Entry& entry = mEntries[handle];
+			if (entry.previous[tier] != RIG_MESH_RESIDENCY_NONE)
+			{
+				mEntries[entry.previous[tier]].next[tier] = entry.next[tier];
+			}
+			else
+			{
+				mHead[tier] = entry.next[tier];
+			}
+
+			if (entry.next[tier] != RIG_MESH_RESIDENCY_NONE)
+			{
+				mEntries[entry.next[tier]].previous[tier] = entry.previous[tier];
+			}
+			else
+			{
+				mTail[tier] = entry.previous[tier];
+			}
+
+			entry.previous[tier] = RIG_MESH_RESIDENCY_NONE;
+			entry.next[tier] = RIG_MESH_RESIDENCY_NONE;
+		}
+
+		void Touch(const uint32_t& handle)
+		{
+			if (mHead[MESH_RESIDENCY_TIER_GPU] != handle)
+			{
+				Unlink(handle, MESH_RESIDENCY_TIER_GPU);
+				Link(handle, MESH_RESIDENCY_TIER_GPU);
+			}
+
+			if (mEntries[handle].isStaged && mHead[MESH_RESIDENCY_TIER_CPU] != handle)
+			{
+				Unlink(handle, MESH_RESIDENCY_TIER_CPU);
+				Link(handle, MESH_RESIDENCY_TIER_CPU);
+			}
+		}
+
+		// A fresh parse enters the CPU tier at the staging vectors' capacity.
+		void Stage(const uint32_t& handle)
+		{
+			Entry& entry = mEntries[handle];
+			const Resource& resource = entry.request.resource;
+
+			entry.bytes[MESH_RESIDENCY_TIER_CPU] =
+				resource.mVertices.capacity() * sizeof(resource.mVertices[0]) +
+				resource.mIndices.capacity() * sizeof(resource.mIndices[0]);
+			entry.isStaged = true;
+
+			mStatistics.cpuBytes += entry.bytes[MESH_RESIDENCY_TIER_CPU];
+			Link(handle, MESH_RESIDENCY_TIER_CPU);
+		}
+
+		void MakeResident(const uint32_t& handle)
+		{
+			Entry& entry = mEntries[handle];
+			entry.bytes[MESH_RESIDENCY_TIER_GPU] = GetMeshBytes(entry);
+			entry.state = MESH_RESIDENCY_RESIDENT;
+			entry.wasLoaded = true;
+
+			mStatistics.gpuBytes += entry.bytes[MESH_RESIDENCY_TIER_GPU];
+			mStatistics.residentCount++;
+			mStatistics.loadingCount--;
+			Link(handle, MESH_RESIDENCY_TIER_GPU);
+		}
+
+		template<class Renderer>
+		void EvictGPU(const uint32_t& handle, Renderer* renderer)
+		{
+			Entry& entry = mEntries[handle];
+			renderer->VReleaseMesh(entry.mesh);
+			Unlink(handle, MESH_RESIDENCY_TIER_GPU);
+
+			mStatistics.gpuBytes -= entry.bytes[MESH_RESIDENCY_TIER_GPU];
+			mStatistics.gpuEvictedBytes += entry.bytes[MESH_RESIDENCY_TIER_GPU];
+			mStatistics.gpuEvictions++;
+			mStatistics.residentCount--;
+
+			entry.bytes[MESH_RESIDENCY_TIER_GPU] = 0;
+			entry.state = MESH_RESIDENCY_EVICTED;
+		}
+
+		void Unstage(const uint32_t& handle)
+		{
+			Entry& entry = mEntries[handle];
+			Resource& resource = entry.request.resource;
+			decltype(resource.mVertices)().swap(resource.mVertices);
+			decltype(resource.mIndices)().swap(resource.mIndices);
+			Unlink(handle, MESH_RESIDENCY_TIER_CPU);
+
+			mStatistics.cpuBytes -= entry.bytes[MESH_RESIDENCY_TIER_CPU];
+			entry.bytes[MESH_RESIDENCY_TIER_CPU] = 0;
+			entry.isStaged = false;
+		}
+
+		void EvictCPU(const uint32_t& handle)
+		{
+			mStatistics.cpuEvictedBytes += mEntries[handle].bytes[MESH_RESIDENCY_TIER_CPU];
+			mStatistics.cpuEvictions++;
+			Unstage(handle);
+		}
+
+		void QueueReload(const uint32_t& handle)
+		{
+			if (!mEntries[handle].isReloadQueued)
+			{
+				mEntries[handle].isReloadQueued = true;
+				mReloads.push_back(handle);
+			}
+		}
+
+		// The new buffers are already in place when loaded; only the accounting changes.
+		void CompleteReload(const uint32_t& handle, const bool& loaded)
+		{
+			Entry& entry = mEntries[handle];
+			entry.isReloading = false;
+			if (!loaded)
+			{
+				mStatistics.failedLoads++;
+				return;
+			}
+
+			mStatistics.gpuBytes -= entry.bytes[MESH_RESIDENCY_TIER_GPU];
+			entry.bytes[MESH_RESIDENCY_TIER_GPU] = GetMeshBytes(entry);
+			mStatistics.gpuBytes += entry.bytes[MESH_RESIDENCY_TIER_GPU];
+			Stage(handle);
+		}
+
+		uint64_t GetMeshBytes(const Entry& entry) const
+		{
+			uint64_t vertexCount = entry.request.resource.mVertices.size();
+			return
+				vertexCount * (entry.mesh->GetVertexStride() + entry.mesh->GetAttributeStride()) +
+				static_cast<uint64_t>(entry.mesh->GetIndexCount()) * entry.mesh->GetIndexSize();
+		}
+
+		MeshResidencyManager(MeshResidencyManager const&) = delete;
+		void operator=(MeshResidencyManager const&) = delete;
+	};
+}
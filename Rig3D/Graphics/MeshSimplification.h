@@ -0,0 +1,643 @@
+#pragma once
+#include "GraphicsMath/cgm.h"
+#include "Rig3D/TaskDispatch/TaskDispatcher.h"
+#include "Rig3D/Graphics/LevelOfDetail.h"
+#include "Rig3D/Graphics/MeshOptimization.h"
+#include <vector>
+#include <algorithm>
+#include <float.h>
+#include <math.h>
+
+#define RIG_SIMPLIFY_VERTEX_MANIFOLD	0
+#define RIG_SIMPLIFY_VERTEX_LOCKED		1
+#define RIG_SIMPLIFY_VERTEX_COLLAPSED	2
+#define RIG_SIMPLIFY_MAX_CANDIDATES		32
+
+// Quadric error edge collapse simplification (Garland & Heckbert 1997). Collapses are half edge collapses onto
+// existing vertices, so every level of a chain indexes the original vertex buffer. Vertices on attribute seams
+// (several vertices at one position), open borders and non manifold edges are locked: they can receive collapses
+// but never move, which keeps UV and normal discontinuities intact.
+//
+// Simplification runs in passes. Each pass finds the cheapest valid collapse of every changed vertex (parallel),
+// then applies collapses in cost order; a vertex moves or receives at most one collapse per pass.
+namespace Rig3D
+{
+	struct SimplifierQuadric
+	{
+		float a2, b2, c2, ab, ac, bc, ad, bd, cd, d2;
+		float weight;
+	};
+
+	struct MeshSimplifier
+	{
+		std::vector<vec3f>				positions;		// Normalized to the unit cube
+		std::vector<SimplifierQuadric>	quadrics;
+		std::vector<uint8_t>			kinds;
+		std::vector<uint32_t>			indices;		// Current level
+		std::vector<uint32_t>			offsets;		// Vertex -> triangle adjacency, rebuilt every pass
+		std::vector<uint32_t>			adjacency;
+		std::vector<uint32_t>			targets;		// Cheapest collapse per vertex, UINT32_MAX for none
+		std::vector<float>				costs;
+		std::vector<uint64_t>			candidates;		// Cost bits and vertex, sortable as integers
+		std::vector<uint64_t>			sortScratch;
+		std::vector<uint32_t>			remap;
+		std::vector<uint8_t>			touched;		// Changed by the last pass; only these need new costs
+		std::vector<uint8_t>			locked;			// Moved or received a collapse in the current pass
+		uint32_t						vertexCount;
+		float							scale;			// Object space size of one normalized unit
+		float							error;			// Largest normalized collapse error so far
+	};
+
+	struct SimplifyCostRange
+	{
+		MeshSimplifier*				simplifier;
+		uint32_t					first;
+		uint32_t					count;
+		cliqCity::multicore::TaskID	taskID;
+	};
+
+#pragma region Quadrics
+
+	inline void AddQuadric(SimplifierQuadric& q, const SimplifierQuadric& r)
+	{
+		q.a2 += r.a2; q.b2 += r.b2; q.c2 += r.c2;
+		q.ab += r.ab; q.ac += r.ac; q.bc += r.bc;
+		q.ad += r.ad; q.bd += r.bd; q.cd += r.cd;
+		q.d2 += r.d2;
+		q.weight += r.weight;
+	}
+
+	// Plane through a, b and c weighted by triangle area.
+	inline void GetTriangleQuadric(SimplifierQuadric& q, const vec3f& a, const vec3f& b, const vec3f& c)
+	{
+		vec3f n = cliqCity::graphicsMath::cross(b - a, c - a);
+		float length = sqrtf(cliqCity::graphicsMath::dot(n, n));
+		float area = length * 0.5f;
+
+		if (length > 0.0f)
+		{
+			n /= length;
+		}
+
+		float d = -cliqCity::graphicsMath::dot(n, a);
+
+		q.a2 = n.x * n.x * area; q.b2 = n.y * n.y * area; q.c2 = n.z * n.z * area;
+		q.ab = n.x * n.y * area; q.ac = n.x * n.z * area; q.bc = n.y * n.z * area;
+		q.ad = n.x * d * area; q.bd = n.y * d * area; q.cd = n.z * d * area;
+		q.d2 = d * d * area;
+		q.weight = area;
+	}
+
+	// Area weighted mean squared distance from p to the planes accumulated in q.
+	inline float EvaluateQuadric(const SimplifierQuadric& q, const vec3f& p)
+	{
+		float e =
+			q.a2 * p.x * p.x + q.b2 * p.y * p.y + q.c2 * p.z * p.z +
+			2.0f * (q.ab * p.x * p.y + q.ac * p.x * p.z + q.bc * p.y * p.z) +
+			2.0f * (q.ad * p.x + q.bd * p.y + q.cd * p.z) +
+			q.d2;
+
+		return (q.weight > 0.0f) ? fabsf(e) / q.weight : 0.0f;
+	}
+
+#pragma endregion
+
+#pragma region Simplifier
+
+	inline void BuildSimplifierAdjacency(MeshSimplifier& simplifier)
+	{
+		uint32_t vertexCount = simplifier.vertexCount;
+		std::vector<uint32_t>& offsets = simplifier.offsets;
+		std::vector<uint32_t>& indices = simplifier.indices;
+
+		offsets.assign(vertexCount + 1, 0);
+		for (uint32_t i = 0; i < indices.size(); i++)
+		{
+			offsets[indices[i] + 1]++;
+		}
+
+		for (uint32_t v = 0; v < vertexCount; v++)
+		{
+			offsets[v + 1] += offsets[v];
+		}
+
+		simplifier.adjacency.resize(indices.size());
+		for (uint32_t i = 0; i < indices.size(); i++)
+		{
+			simplifier.adjacency[offsets[indices[i]]++] = i / 3;
+		}
+
+		// Shift back so offsets[v] is the start of v's list again
+		for (uint32_t v = vertexCount; v > 0; v--)
+		{
+			offsets[v] = offsets[v - 1];
+		}
+		offsets[0] = 0;
+	}
+
+	template<class Vertex, class Index>
+	inline void InitializeMeshSimplifier(MeshSimplifier& simplifier, const Vertex* vertices, const uint32_t& vertexCount, const Index* indices, const uint32_t& indexCount)
+	{
+		simplifier.vertexCount = vertexCount;
+		simplifier.error = 0.0f;
+
+		// Normalize positions so quadric terms stay in float range
+		vec3f minimum = vertices[0].Position;
+		vec3f maximum = vertices[0].Position;
+		for (uint32_t v = 1; v < vertexCount; v++)
+		{
+			const vec3f& p = vertices[v].Position;
+			minimum = { (std::min)(minimum.x, p.x), (std::min)(minimum.y, p.y), (std::min)(minimum.z, p.z) };
+			maximum = { (std::max)(maximum.x, p.x), (std::max)(maximum.y, p.y), (std::max)(maximum.z, p.z) };
+		}
+
+		vec3f extent = maximum - minimum;
+		simplifier.scale = (std::max)((std::max)(extent.x, extent.y), (std::max)(extent.z, FLT_MIN));
+		float inverseScale = 1.0f / simplifier.scale;
+
+		simplifier.positions.resize(vertexCount);
+		for (uint32_t v = 0; v < vertexCount; v++)
+		{
+			simplifier.positions[v] = (vertices[v].Position - minimum) * inverseScale;
+		}
+
+		simplifier.indices.clear();
+		simplifier.indices.reserve(indexCount);
+		for (uint32_t i = 0; i + 2 < indexCount; i += 3)
+		{
+			uint32_t a = static_cast<uint32_t>(indices[i]);
+			uint32_t b = static_cast<uint32_t>(indices[i + 1]);
+			uint32_t c = static_cast<uint32_t>(indices[i + 2]);
+			if (a != b && b != c && c != a)
+			{
+				simplifier.indices.push_back(a);
+				simplifier.indices.push_back(b);
+				simplifier.indices.push_back(c);
+			}
+		}
+
+		// Position classes: wedges of one position share the first vertex with that position as their id
+		std::vector<uint32_t> wedges(vertexCount);
+		std::vector<uint32_t> wedgeCounts(vertexCount, 0);
+		{
+			uint32_t tableSize = 1;
+			while (tableSize < vertexCount * 2)
+			{
+				tableSize <<= 1;
+			}
+
+			std::vector<uint32_t> table(tableSize, UINT32_MAX);
+			for (uint32_t v = 0; v < vertexCount; v++)
+			{
+				const vec3f& p = vertices[v].Position;
+				uint32_t slot = HashVertexBytes(&p, sizeof(vec3f)) & (tableSize - 1);
+				while (table[slot] != UINT32_MAX && memcmp(&vertices[table[slot]].Position, &p, sizeof(vec3f)) != 0)
+				{
+					slot = (slot + 1) & (tableSize - 1);
+				}
+
+				if (table[slot] == UINT32_MAX)
+				{
+					table[slot] = v;
+				}
+
+				wedges[v] = table[slot];
+				wedgeCounts[table[slot]]++;
+			}
+		}
+
+		// Every directed edge of a closed manifold has exactly one opposite edge in position space
+		std::vector<uint32_t>& indicesRef = simplifier.indices;
+		std::vector<uint8_t> nonManifold(vertexCount, 0);
+		{
+			std::vector<uint32_t> positionIndices(indicesRef.size());
+			for (uint32_t i = 0; i < indicesRef.size(); i++)
+			{
+				positionIndices[i] = wedges[indicesRef[i]];
+			}
+
+			std::vector<uint32_t> offsets(vertexCount + 1, 0);
+			std::vector<uint32_t> adjacency(positionIndices.size());
+			for (uint32_t i = 0; i < positionIndices.size(); i++)
+			{
+				offsets[positionIndices[i] + 1]++;
+			}
+
+			for (uint32_t v = 0; v < vertexCount; v++)
+			{
+				offsets[v + 1] += offsets[v];
+			}
+
+			std::vector<uint32_t> cursors(offsets.begin(), offsets.end() - 1);
+			for (uint32_t i = 0; i < positionIndices.size(); i++)
+			{
+				adjacency[cursors[positionIndices[i]]++] = i / 3;
+			}
+
+			// Around a manifold vertex every neighbor is reached once by an outgoing and once by an incoming edge
+			for (uint32_t v = 0; v < vertexCount; v++)
+			{
+				for (uint32_t a = offsets[v]; a < offsets[v + 1] && !nonManifold[v]; a++)
+				{
+					const uint32_t* triangle = &positionIndices[adjacency[a] * 3];
+					uint32_t k = (triangle[0] == v) ? 0 : ((triangle[1] == v) ? 1 : 2);
+					uint32_t next = triangle[(k + 1) % 3];
+					uint32_t previous = triangle[(k + 2) % 3];
+
+					uint32_t nextOut = 0, nextIn = 0, previousOut = 0, previousIn = 0;
+					for (uint32_t b = offsets[v]; b < offsets[v + 1]; b++)
+					{
+						const uint32_t* other = &positionIndices[adjacency[b] * 3];
+						uint32_t j = (other[0] == v) ? 0 : ((other[1] == v) ? 1 : 2);
+						uint32_t otherNext = other[(j + 1) % 3];
+						uint32_t otherPrevious = other[(j + 2) % 3];
+
+						nextOut += (otherNext == next);
+						nextIn += (otherPrevious == next);
+						previousOut += (otherNext == previous);
+						previousIn += (otherPrevious == previous);
+					}
+
+					nonManifold[v] = (nextOut != 1 || nextIn != 1 || previousOut != 1 || previousIn != 1);
+				}
+			}
+		}
+
+		simplifier.kinds.resize(vertexCount);
+		for (uint32_t v = 0; v < vertexCount; v++)
+		{
+			uint32_t w = wedges[v];
+			simplifier.kinds[v] = (nonManifold[w] || wedgeCounts[w] > 1) ? RIG_SIMPLIFY_VERTEX_LOCKED : RIG_SIMPLIFY_VERTEX_MANIFOLD;
+		}
+
+		SimplifierQuadric zero;
+		memset(&zero, 0, sizeof(SimplifierQuadric));
+		simplifier.quadrics.assign(vertexCount, zero);
+
+		for (uint32_t i = 0; i < indicesRef.size(); i += 3)
+		{
+			SimplifierQuadric q;
+			GetTriangleQuadric(q, simplifier.positions[indicesRef[i]], simplifier.positions[indicesRef[i + 1]], simplifier.positions[indicesRef[i + 2]]);
+
+			AddQuadric(simplifier.quadrics[indicesRef[i]], q);
+			AddQuadric(simplifier.quadrics[indicesRef[i + 1]], q);
+			AddQuadric(simplifier.quadrics[indicesRef[i + 2]], q);
+		}
+
+		simplifier.targets.assign(vertexCount, UINT32_MAX);
+		simplifier.costs.assign(vertexCount, FLT_MAX);
+		simplifier.remap.resize(vertexCount);
+		for (uint32_t v = 0; v < vertexCount; v++)
+		{
+			simplifier.remap[v] = v;
+		}
+
+		simplifier.touched.assign(vertexCount, 1);
+		simplifier.locked.resize(vertexCount);
+	}
+
+	// True when moving v to target flips or nearly degenerates none of v's remaining triangles. Corners are read
+	// through remap so collapses applied earlier in the same pass are taken into account.
+	inline bool IsCollapseValid(const MeshSimplifier& simplifier, const uint32_t& v, const uint32_t& target)
+	{
+		const vec3f& from = simplifier.positions[v];
+		const vec3f& to = simplifier.positions[target];
+
+		for (uint32_t a = simplifier.offsets[v]; a < simplifier.offsets[v + 1]; a++)
+		{
+			const uint32_t* triangle = &simplifier.indices[simplifier.adjacency[a] * 3];
+			uint32_t corners[3] = { simplifier.remap[triangle[0]], simplifier.remap[triangle[1]], simplifier.remap[triangle[2]] };
+
+			// Removed by this collapse or an earlier one
+			if (corners[0] == target || corners[1] == target || corners[2] == target ||
+				corners[0] == corners[1] || corners[1] == corners[2] || corners[2] == corners[0])
+			{
+				continue;
+			}
+
+			uint32_t k = (corners[0] == v) ? 0 : ((corners[1] == v) ? 1 : 2);
+			const vec3f& b = simplifier.positions[corners[(k + 1) % 3]];
+			const vec3f& c = simplifier.positions[corners[(k + 2) % 3]];
+
+			vec3f n0 = cliqCity::graphicsMath::cross(b - from, c - from);
+			vec3f n1 = cliqCity::graphicsMath::cross(b - to, c - to);
+
+			float d = cliqCity::graphicsMath::dot(n0, n1);
+			if (d <= 0.5f * sqrtf(cliqCity::graphicsMath::dot(n0, n0) * cliqCity::graphicsMath::dot(n1, n1)))
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	// Cheapest valid collapse for each vertex in [first, first + count) whose neighborhood changed in the last pass.
+	// Neighbors are tried in cost order so the flip test usually runs once. At most RIG_SIMPLIFY_MAX_CANDIDATES
+	// neighbor entries are considered for very high valence vertices.
+	inline void ComputeCollapseCosts(MeshSimplifier& simplifier, const uint32_t& first, const uint32_t& count)
+	{
+		float costs[RIG_SIMPLIFY_MAX_CANDIDATES];
+		uint32_t targets[RIG_SIMPLIFY_MAX_CANDIDATES];
+
+		for (uint32_t v = first; v < first + count; v++)
+		{
+			if (!simplifier.touched[v])
+			{
+				continue;
+			}
+
+			simplifier.targets[v] = UINT32_MAX;
+			simplifier.costs[v] = FLT_MAX;
+
+			if (simplifier.kinds[v] != RIG_SIMPLIFY_VERTEX_MANIFOLD)
+			{
+				continue;
+			}
+
+			const SimplifierQuadric& q = simplifier.quadrics[v];
+			uint32_t candidateCount = 0;
+			for (uint32_t a = simplifier.offsets[v]; a < simplifier.offsets[v + 1] && candidateCount < RIG_SIMPLIFY_MAX_CANDIDATES; a++)
+			{
+				// Each neighbor of a closed fan is the next corner of exactly one triangle
+				const uint32_t* triangle = &simplifier.indices[simplifier.adjacency[a] * 3];
+				uint32_t k = (triangle[0] == v) ? 0 : ((triangle[1] == v) ? 1 : 2);
+				uint32_t u = triangle[(k + 1) % 3];
+
+				targets[candidateCount] = u;
+				costs[candidateCount++] = EvaluateQuadric(q, simplifier.positions[u]);
+			}
+
+			for (uint32_t attempt = 0; attempt < candidateCount; attempt++)
+			{
+				uint32_t best = 0;
+				for (uint32_t c = 1; c < candidateCount; c++)
+				{
+					best = (costs[c] < costs[best]) ? c : best;
+				}
+
+				if (costs[best] == FLT_MAX)
+				{
+					break;
+				}
+
+				if (IsCollapseValid(simplifier, v, targets[best]))
+				{
+					simplifier.costs[v] = costs[best];
+					simplifier.targets[v] = targets[best];
+					break;
+				}
+
+				costs[best] = FLT_MAX;
+			}
+		}
+	}
+
+	inline void PerformSimplifyCostTask(const cliqCity::multicore::TaskData& data)
+	{
+		SimplifyCostRange* range = reinterpret_cast<SimplifyCostRange*>(data.mKernelData);
+		ComputeCollapseCosts(*range->simplifier, range->first, range->count);
+	}
+
+	// LSD radix sort on the cost bits in the high half, three passes of 11 bits.
+	inline void SortCollapseCandidates(std::vector<uint64_t>& candidates, std::vector<uint64_t>& scratch)
+	{
+		scratch.resize(candidates.size());
+
+		for (uint32_t shift = 32; shift < 64; shift += 11)
+		{
+			uint32_t histogram[2048];
+			memset(histogram, 0, sizeof(histogram));
+
+			for (uint64_t key : candidates)
+			{
+				histogram[(key >> shift) & 2047]++;
+			}
+
+			uint32_t sum = 0;
+			for (uint32_t b = 0; b < 2048; b++)
+			{
+				uint32_t count = histogram[b];
+				histogram[b] = sum;
+				sum += count;
+			}
+
+			for (uint64_t key : candidates)
+			{
+				scratch[histogram[(key >> shift) & 2047]++] = key;
+			}
+
+			candidates.swap(scratch);
+		}
+	}
+
+	// Applies the cheapest non overlapping collapses until targetIndexCount or the error limit is reached.
+	// Returns the number of collapses.
+	inline uint32_t ApplyCollapses(MeshSimplifier& simplifier, const uint32_t& targetIndexCount, const float& errorLimit)
+	{
+		std::vector<uint64_t>& candidates = simplifier.candidates;
+		candidates.clear();
+		for (uint32_t v = 0; v < simplifier.vertexCount; v++)
+		{
+			if (simplifier.targets[v] != UINT32_MAX && simplifier.costs[v] <= errorLimit)
+			{
+				// Non negative floats order the same as their bit patterns
+				uint32_t bits;
+				memcpy(&bits, &simplifier.costs[v], sizeof(float));
+				candidates.push_back((static_cast<uint64_t>(bits) << 32) | v);
+			}
+		}
+
+		SortCollapseCandidates(candidates, simplifier.sortScratch);
+
+		memset(&simplifier.touched[0], 0, simplifier.vertexCount);
+		memset(&simplifier.locked[0], 0, simplifier.vertexCount);
+		for (uint32_t v = 0; v < simplifier.vertexCount; v++)
+		{
+			simplifier.remap[v] = v;
+		}
+
+		uint32_t indexCount = static_cast<uint32_t>(simplifier.indices.size());
+		uint32_t collapses = 0;
+
+		for (uint32_t i = 0; i < candidates.size() && indexCount > targetIndexCount; i++)
+		{
+			uint32_t v = static_cast<uint32_t>(candidates[i]);
+			uint32_t u = simplifier.targets[v];
+
+			// A vertex moves or receives at most once per pass; neighbors may have moved since the costs were found
+			if (simplifier.locked[v] || simplifier.locked[u] || !IsCollapseValid(simplifier, v, u))
+			{
+				continue;
+			}
+
+			for (uint32_t a = simplifier.offsets[v]; a < simplifier.offsets[v + 1]; a++)
+			{
+				const uint32_t* triangle = &simplifier.indices[simplifier.adjacency[a] * 3];
+				uint32_t corners[3] = { simplifier.remap[triangle[0]], simplifier.remap[triangle[1]], simplifier.remap[triangle[2]] };
+
+				simplifier.touched[corners[0]] = 1;
+				simplifier.touched[corners[1]] = 1;
+				simplifier.touched[corners[2]] = 1;
+
+				bool degenerate = (corners[0] == corners[1] || corners[1] == corners[2] || corners[2] == corners[0]);
+				if (!degenerate && (corners[0] == u || corners[1] == u || corners[2] == u))
+				{
+					indexCount -= 3;
+				}
+			}
+
+			simplifier.remap[v] = u;
+			simplifier.locked[v] = 1;
+			simplifier.locked[u] = 1;
+			simplifier.kinds[v] = RIG_SIMPLIFY_VERTEX_COLLAPSED;
+			simplifier.error = (std::max)(simplifier.error, simplifier.costs[v]);
+			AddQuadric(simplifier.quadrics[u], simplifier.quadrics[v]);
+			collapses++;
+		}
+
+		// Rewrite the index buffer, dropping triangles that lost a corner
+		std::vector<uint32_t>& indices = simplifier.indices;
+		uint32_t out = 0;
+		for (uint32_t i = 0; i < indices.size(); i += 3)
+		{
+			uint32_t a = simplifier.remap[indices[i]];
+			uint32_t b = simplifier.remap[indices[i + 1]];
+			uint32_t c = simplifier.remap[indices[i + 2]];
+			if (a != b && b != c && c != a)
+			{
+				indices[out++] = a;
+				indices[out++] = b;
+				indices[out++] = c;
+			}
+		}
+
+		indices.resize(out);
+		return collapses;
+	}
+
+	// Simplifies the current level towards targetIndexCount without exceeding maxError (object space). Pass a
+	// dispatcher and rangeCount caller owned ranges to evaluate collapse costs in parallel, or nullptr.
+	inline void SimplifyMesh(MeshSimplifier& simplifier, const uint32_t& targetIndexCount, const float& maxError, cliqCity::multicore::TaskDispatcher* dispatcher = nullptr, SimplifyCostRange* ranges = nullptr, const uint32_t& rangeCount = 0)
+	{
+		float normalizedError = maxError / simplifier.scale;
+		float errorLimit = normalizedError * normalizedError;
+
+		while (simplifier.indices.size() > targetIndexCount)
+		{
+			BuildSimplifierAdjacency(simplifier);
+
+			if (dispatcher && rangeCount > 1)
+			{
+				uint32_t rangeSize = (simplifier.vertexCount + rangeCount - 1) / rangeCount;
+
+				cliqCity::multicore::TaskData data;
+				uint32_t taskCount = 0;
+				for (uint32_t first = 0; first < simplifier.vertexCount; first += rangeSize, taskCount++)
+				{
+					SimplifyCostRange& range = ranges[taskCount];
+					range.simplifier = &simplifier;
+					range.first = first;
+					range.count = (std::min)(rangeSize, simplifier.vertexCount - first);
+
+					data.mKernelData = &range;
+					range.taskID = dispatcher->AddTask(data, PerformSimplifyCostTask);
+				}
+
+				for (uint32_t i = 0; i < taskCount; i++)
+				{
+					dispatcher->WaitForTask(ranges[i].taskID);
+				}
+			}
+			else
+			{
+				ComputeCollapseCosts(simplifier, 0, simplifier.vertexCount);
+			}
+
+			if (ApplyCollapses(simplifier, targetIndexCount, errorLimit) == 0)
+			{
+				break;
+			}
+		}
+	}
+
+	// Object space error of the current level.
+	inline float GetSimplifierError(const MeshSimplifier& simplifier)
+	{
+		return sqrtf(simplifier.error) * simplifier.scale;
+	}
+
+#pragma endregion
+
+#pragma region LOD Chain
+
+	struct LODChainParameters
+	{
+		float		ratios[RIG_LOD_MAX_LEVELS];	// Target triangle ratio of each coarser level to the original
+		uint32_t	levelCount;					// Coarser levels requested, level 0 is the input
+		float		maxError;					// Object space; the chain ends early once no collapse fits
+	};
+
+	// Appends coarser levels to indices, which holds level 0 on input, and describes every level in mesh. Each level
+	// continues from the previous one so quadrics carry over. Levels share the full vertex range. Returns the
+	// number of levels.
+	template<class Vertex, class Index>
+	inline uint32_t BuildLODChain(LODMesh& mesh, std::vector<Index>& indices, const Vertex* vertices, const uint32_t& vertexCount, const LODChainParameters& parameters, cliqCity::multicore::TaskDispatcher* dispatcher = nullptr, SimplifyCostRange* ranges = nullptr, const uint32_t& rangeCount = 0)
+	{
+		uint32_t indexCount = static_cast<uint32_t>(indices.size());
+
+		mesh.levelCount = 0;
+		AddLODLevel(mesh, 0, indexCount, 0, vertexCount, 0.0f);
+
+		MeshSimplifier simplifier;
+		InitializeMeshSimplifier(simplifier, vertices, vertexCount, &indices[0], indexCount);
+
+		for (uint32_t l = 0; l < parameters.levelCount && mesh.levelCount < RIG_LOD_MAX_LEVELS; l++)
+		{
+			uint32_t previousCount = mesh.levels[mesh.levelCount - 1].indexCount;
+			uint32_t targetIndexCount = static_cast<uint32_t>(indexCount / 3 * parameters.ratios[l]) * 3;
+
+			SimplifyMesh(simplifier, targetIndexCount, parameters.maxError, dispatcher, ranges, rangeCount);
+
+			uint32_t levelCount = static_cast<uint32_t>(simplifier.indices.size());
+			if (levelCount == 0 || levelCount >= previousCount)
+			{
+				break;
+			}
+
+			uint32_t start = static_cast<uint32_t>(indices.size());
+			indices.resize(start + levelCount);
+			for (uint32_t i = 0; i < levelCount; i++)
+			{
+				indices[start + i] = static_cast<Index>(simplifier.indices[i]);
+			}
+
+			AddLODLevel(mesh, start, levelCount, 0, vertexCount, GetSimplifierError(simplifier));
+		}
+
+		// Collapses leave the order of the surviving triangles, so reorder each new level for the vertex cache
+		VertexCacheRange<Index> cacheRanges[RIG_LOD_MAX_LEVELS];
+		for (uint32_t l = 1; l < mesh.levelCount; l++)
+		{
+			cacheRanges[l - 1].indices = &indices[mesh.levels[l].indexStart];
+			cacheRanges[l - 1].indexCount = mesh.levels[l].indexCount;
+			cacheRanges[l - 1].vertexCount = vertexCount;
+		}
+
+		if (dispatcher)
+		{
+			OptimizeVertexCacheParallel(*dispatcher, cacheRanges, mesh.levelCount - 1);
+		}
+		else
+		{
+			for (uint32_t l = 0; l + 1 < mesh.levelCount; l++)
+			{
+				OptimizeVertexCache(cacheRanges[l].indices, cacheRanges[l].indexCount, cacheRanges[l].vertexCount);
+			}
+		}
+
+		return mesh.levelCount;
+	}
+
+#pragma endregion
+}
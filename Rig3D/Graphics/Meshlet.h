@@ -0,0 +1,451 @@
+#pragma once
+#include "GraphicsMath/cgm.h"
+#include "Rig3D/Visibility.h"
+#include "Rig3D/TaskDispatch/TaskDispatcher.h"
+#include <vector>
+#include <algorithm>
+#include <float.h>
+#include <math.h>
+#include <string.h>
+
+#define RIG_MESHLET_MAX_VERTICES	64
+#define RIG_MESHLET_MAX_TRIANGLES	124
+
+// Meshlets: small clusters of an indexed mesh with their own bounding sphere and normal cone so whole clusters can be
+// rejected when off screen or facing away. A meshlet indexes a range of the meshlet vertex list, which holds indices
+// into the original vertex buffer, and its triangles are local 8-bit indices into that range.
+//
+// Culling works in object space: extract the frustum from the object's transposed world-view-projection matrix and
+// pass the camera position transformed into object space.
+namespace Rig3D
+{
+	struct Meshlet
+	{
+		uint32_t	vertexOffset;
+		uint32_t	triangleOffset;		// In triangles; local indices start at 3 * triangleOffset
+		uint16_t	vertexCount;
+		uint16_t	triangleCount;
+	};
+
+	// Every triangle faces away from a camera for which dot(normalize(coneApex - camera), coneAxis) >= coneCutoff.
+	// coneCutoff is above 1 when the normals span too wide a cone for the test.
+	struct MeshletBounds
+	{
+		vec3f	center;
+		float	radius;
+		vec3f	coneApex;
+		vec3f	coneAxis;
+		float	coneCutoff;
+	};
+
+	struct MeshletMesh
+	{
+		std::vector<Meshlet>		meshlets;
+		std::vector<MeshletBounds>	bounds;
+		std::vector<uint32_t>		vertices;
+		std::vector<uint8_t>		triangles;
+		uint32_t					triangleCount;		// Sum over all meshlets, sizes the culling output
+	};
+
+	struct MeshletCullStatistics
+	{
+		uint32_t tested;
+		uint32_t frustumCulled;
+		uint32_t backfaceCulled;
+		uint32_t triangles;				// Triangles emitted
+
+		MeshletCullStatistics() : tested(0), frustumCulled(0), backfaceCulled(0), triangles(0) {};
+
+		inline void Reset() { tested = frustumCulled = backfaceCulled = triangles = 0; };
+	};
+
+#pragma region Building
+
+	template<class Vertex>
+	inline void ComputeMeshletBounds(MeshletBounds& bounds, const Meshlet& meshlet, const MeshletMesh& mesh, const Vertex* vertices)
+	{
+		const uint32_t* meshletVertices = &mesh.vertices[meshlet.vertexOffset];
+		const uint8_t* meshletTriangles = &mesh.triangles[meshlet.triangleOffset * 3];
+
+		vec3f minimum = vertices[meshletVertices[0]].Position;
+		vec3f maximum = minimum;
+		for (uint32_t v = 1; v < meshlet.vertexCount; v++)
+		{
+			const vec3f& p = vertices[meshletVertices[v]].Position;
+			minimum = { (std::min)(minimum.x, p.x), (std::min)(minimum.y, p.y), (std::min)(minimum.z, p.z) };
+			maximum = { (std::max)(maximum.x, p.x), (std::max)(maximum.y, p.y), (std::max)(maximum.z, p.z) };
+		}
+
+		bounds.center = (minimum + maximum) * 0.5f;
+		bounds.radius = 0.0f;
+		for (uint32_t v = 0; v < meshlet.vertexCount; v++)
+		{
+			vec3f offset = vertices[meshletVertices[v]].Position - bounds.center;
+			bounds.radius = (std::max)(bounds.radius, cliqCity::graphicsMath::dot(offset, offset));
+		}
+		bounds.radius = sqrtf(bounds.radius);
+
+		// Cone axis is the mean normal, the cutoff comes from the widest normal around it
+		vec3f normals[RIG_MESHLET_MAX_TRIANGLES];
+		vec3f axis = { 0.0f, 0.0f, 0.0f };
+		for (uint32_t t = 0; t < meshlet.triangleCount; t++)
+		{
+			const vec3f& a = vertices[meshletVertices[meshletTriangles[t * 3]]].Position;
+			const vec3f& b = vertices[meshletVertices[meshletTriangles[t * 3 + 1]]].Position;
+			const vec3f& c = vertices[meshletVertices[meshletTriangles[t * 3 + 2]]].Position;
+
+			vec3f n = cliqCity::graphicsMath::cross(b - a, c - a);
+			float length = sqrtf(cliqCity::graphicsMath::dot(n, n));
+			normals[t] = (length > 0.0f) ? n / length : vec3f(0.0f, 0.0f, 0.0f);
+			axis += normals[t];
+		}
+
+		bounds.coneApex = bounds.center;
+		bounds.coneAxis = { 0.0f, 0.0f, 0.0f };
+		bounds.coneCutoff = 2.0f;
+
+		float axisLength = sqrtf(cliqCity::graphicsMath::dot(axis, axis));
+		if (axisLength == 0.0f)
+		{
+			return;
+		}
+
+		axis /= axisLength;
+
+		float minimumDot = 1.0f;
+		for (uint32_t t = 0; t < meshlet.triangleCount; t++)
+		{
+			if (cliqCity::graphicsMath::dot(normals[t], normals[t]) > 0.0f)
+			{
+				minimumDot = (std::min)(minimumDot, cliqCity::graphicsMath::dot(normals[t], axis));
+			}
+		}
+
+		// Normals spanning a hemisphere or more can always have some triangle facing the camera
+		if (minimumDot <= 0.0f)
+		{
+			return;
+		}
+
+		// Move the apex back along the axis until it lies behind every triangle plane: then a camera that sees the
+		// apex from within the complement cone is behind all of them
+		float maxT = 0.0f;
+		for (uint32_t t = 0; t < meshlet.triangleCount; t++)
+		{
+			float normalDot = cliqCity::graphicsMath::dot(normals[t], axis);
+			if (normalDot <= 0.0f)
+			{
+				continue;
+			}
+
+			const vec3f& a = vertices[meshletVertices[meshletTriangles[t * 3]]].Position;
+			maxT = (std::max)(maxT, cliqCity::graphicsMath::dot(bounds.center - a, normals[t]) / normalDot);
+		}
+
+		bounds.coneApex = bounds.center - axis * maxT;
+		bounds.coneAxis = axis;
+		bounds.coneCutoff = sqrtf(1.0f - minimumDot * minimumDot);
+	}
+
+	// Splits the mesh into meshlets in index buffer order, so run OptimizeVertexCache first for compact clusters.
+	template<class Vertex, class Index>
+	inline void BuildMeshlets(MeshletMesh& mesh, const Vertex* vertices, const uint32_t& vertexCount, const Index* indices, const uint32_t& indexCount, const uint32_t& maxVertices = RIG_MESHLET_MAX_VERTICES, const uint32_t& maxTriangles = RIG_MESHLET_MAX_TRIANGLES)
+	{
+		mesh.meshlets.clear();
+		mesh.bounds.clear();
+		mesh.vertices.clear();
+		mesh.triangles.clear();
+		mesh.vertices.reserve(indexCount / 3);
+		mesh.triangles.reserve(indexCount);
+		mesh.triangleCount = 0;
+
+		// Global vertex -> local index for the meshlet being built
+		std::vector<uint8_t> localIndices(vertexCount, 0xFF);
+
+		Meshlet meshlet = { 0, 0, 0, 0 };
+
+		auto flush = [&]()
+		{
+			for (uint32_t v = 0; v < meshlet.vertexCount; v++)
+			{
+				localIndices[mesh.vertices[meshlet.vertexOffset + v]] = 0xFF;
+			}
+
+			mesh.meshlets.push_back(meshlet);
+			mesh.triangleCount += meshlet.triangleCount;
+
+			meshlet.vertexOffset = static_cast<uint32_t>(mesh.vertices.size());
+			meshlet.triangleOffset = static_cast<uint32_t>(mesh.triangles.size() / 3);
+			meshlet.vertexCount = 0;
+			meshlet.triangleCount = 0;
+		};
+
+		for (uint32_t i = 0; i + 2 < indexCount; i += 3)
+		{
+			uint32_t a = static_cast<uint32_t>(indices[i]);
+			uint32_t b = static_cast<uint32_t>(indices[i + 1]);
+			uint32_t c = static_cast<uint32_t>(indices[i + 2]);
+
+			uint32_t newVertices = (localIndices[a] == 0xFF) + (localIndices[b] == 0xFF) + (localIndices[c] == 0xFF);
+			if (meshlet.vertexCount + newVertices > maxVertices || meshlet.triangleCount + 1u > maxTriangles)
+			{
+				flush();
+			}
+
+			uint32_t corners[3] = { a, b, c };
+			for (uint32_t k = 0; k < 3; k++)
+			{
+				if (localIndices[corners[k]] == 0xFF)
+				{
+					localIndices[corners[k]] = static_cast<uint8_t>(meshlet.vertexCount++);
+					mesh.vertices.push_back(corners[k]);
+				}
+
+				mesh.triangles.push_back(localIndices[corners[k]]);
+			}
+
+			meshlet.triangleCount++;
+		}
+
+		if (meshlet.triangleCount > 0)
+		{
+			flush();
+		}
+
+		mesh.bounds.resize(mesh.meshlets.size());
+		for (uint32_t m = 0; m < mesh.meshlets.size(); m++)
+		{
+			ComputeMeshletBounds(mesh.bounds[m], mesh.meshlets[m], mesh, vertices);
+		}
+	}
+
+#pragma endregion
+
+#pragma region Culling
+
+	inline bool IsMeshletBackfacing(const MeshletBounds& bounds, const vec3f& cameraPosition)
+	{
+		vec3f direction = bounds.coneApex - cameraPosition;
+		float distance = sqrtf(cliqCity::graphicsMath::dot(direction, direction));
+
+		return cliqCity::graphicsMath::dot(direction, bounds.coneAxis) >= bounds.coneCutoff * distance;
+	}
+
+	inline bool IsMeshletOutside(const MeshletBounds& bounds, const Frustum& frustum)
+	{
+		const Plane<vec3f>* planes[6] = { &frustum.front, &frustum.back, &frustum.left, &frustum.right, &frustum.bottom, &frustum.top };
+
+		for (uint32_t p = 0; p < 6; p++)
+		{
+			if (cliqCity::graphicsMath::dot(planes[p]->normal, bounds.center) - (planes[p]->distance - bounds.radius) < 0.0f)
+			{
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	// Writes the ids of visible meshlets in [first, first + count) to visible and returns how many there are.
+	inline uint32_t CullMeshlets(const MeshletMesh& mesh, const Frustum& frustum, const vec3f& cameraPosition, uint32_t* visible, const uint32_t& first, const uint32_t& count, MeshletCullStatistics* statistics = nullptr)
+	{
+		uint32_t visibleCount = 0;
+		uint32_t frustumCulled = 0;
+		uint32_t backfaceCulled = 0;
+
+		for (uint32_t m = first; m < first + count; m++)
+		{
+			const MeshletBounds& bounds = mesh.bounds[m];
+			if (IsMeshletOutside(bounds, frustum))
+			{
+				frustumCulled++;
+			}
+			else if (IsMeshletBackfacing(bounds, cameraPosition))
+			{
+				backfaceCulled++;
+			}
+			else
+			{
+				visible[visibleCount++] = m;
+			}
+		}
+
+		if (statistics)
+		{
+			statistics->tested += count;
+			statistics->frustumCulled += frustumCulled;
+			statistics->backfaceCulled += backfaceCulled;
+		}
+
+		return visibleCount;
+	}
+
+	// Expands visible meshlets into an index list over the original vertex buffer. indices needs room for
+	// 3 * mesh.triangleCount entries in the worst case. Returns the index count.
+	inline uint32_t EmitMeshletIndices(const MeshletMesh& mesh, const uint32_t* visible, const uint32_t& visibleCount, uint32_t* indices, MeshletCullStatistics* statistics = nullptr)
+	{
+		uint32_t indexCount = 0;
+		for (uint32_t i = 0; i < visibleCount; i++)
+		{
+			const Meshlet& meshlet = mesh.meshlets[visible[i]];
+			const uint32_t* meshletVertices = &mesh.vertices[meshlet.vertexOffset];
+			const uint8_t* meshletTriangles = &mesh.triangles[meshlet.triangleOffset * 3];
+
+			for (uint32_t k = 0; k < meshlet.triangleCount * 3u; k++)
+			{
+				indices[indexCount++] = meshletVertices[meshletTriangles[k]];
+			}
+		}
+
+		if (statistics)
+		{
+			statistics->triangles += indexCount / 3;
+		}
+
+		return indexCount;
+	}
+
+	// Culls every meshlet and emits the survivors' triangles. visible is scratch with one entry per meshlet.
+	inline uint32_t CullMeshlets(const MeshletMesh& mesh, const Frustum& frustum, const vec3f& cameraPosition, uint32_t* visible, uint32_t* indices, MeshletCullStatistics* statistics = nullptr)
+	{
+		uint32_t visibleCount = CullMeshlets(mesh, frustum, cameraPosition, visible, 0, static_cast<uint32_t>(mesh.meshlets.size()), statistics);
+		return EmitMeshletIndices(mesh, visible, visibleCount, indices, statistics);
+	}
+
+	struct MeshletCullRange
+	{
+		const MeshletMesh*			mesh;
+		const Frustum*				frustum;
+		vec3f						cameraPosition;
+		uint32_t*					visible;
+		uint32_t					first;
+		uint32_t					count;
+		uint32_t					visibleCount;
+		MeshletCullStatistics		statistics;
+		cliqCity::multicore::TaskID	taskID;
+	};
+
+	inline void PerformMeshletCullTask(const cliqCity::multicore::TaskData& data)
+	{
+		MeshletCullRange* range = reinterpret_cast<MeshletCullRange*>(data.mKernelData);
+		range->statistics.Reset();
+		range->visibleCount = CullMeshlets(*range->mesh, *range->frustum, range->cameraPosition, range->visible + range->first, range->first, range->count, &range->statistics);
+	}
+
+	// Parallel version of CullMeshlets. Each range culls into its own slice of visible, the slices are compacted
+	// in order and expanded serially so the output matches the serial path.
+	inline uint32_t CullMeshletsParallel(cliqCity::multicore::TaskDispatcher& dispatcher, const MeshletMesh& mesh, const Frustum& frustum, const vec3f& cameraPosition, uint32_t* visible, uint32_t* indices, MeshletCullRange* ranges, const uint32_t& rangeCount, MeshletCullStatistics* statistics = nullptr)
+	{
+		uint32_t meshletCount = static_cast<uint32_t>(mesh.meshlets.size());
+		uint32_t rangeSize = (meshletCount + rangeCount - 1) / rangeCount;
+
+		cliqCity::multicore::TaskData data;
+		uint32_t taskCount = 0;
+		for (uint32_t first = 0; first < meshletCount; first += rangeSize, taskCount++)
+		{
+			MeshletCullRange& range = ranges[taskCount];
+			range.mesh = &mesh;
+			range.frustum = &frustum;
+			range.cameraPosition = cameraPosition;
+			range.visible = visible;
+			range.first = first;
+			range.count = (std::min)(rangeSize, meshletCount - first);
+
+			data.mKernelData = &range;
+			range.taskID = dispatcher.AddTask(data, PerformMeshletCullTask);
+		}
+
+		uint32_t visibleCount = 0;
+		for (uint32_t i = 0; i < taskCount; i++)
+		{
+			dispatcher.WaitForTask(ranges[i].taskID);
+
+			memmove(visible + visibleCount, visible + ranges[i].first, sizeof(uint32_t) * ranges[i].visibleCount);
+			visibleCount += ranges[i].visibleCount;
+
+			if (statistics)
+			{
+				statistics->tested += ranges[i].statistics.tested;
+				statistics->frustumCulled += ranges[i].statistics.frustumCulled;
+				statistics->backfaceCulled += ranges[i].statistics.backfaceCulled;
+			}
+		}
+
+		return EmitMeshletIndices(mesh, visible, visibleCount, indices, statistics);
+	}
+
+#pragma endregion
+
+#pragma region Validation
+
+	// Debug check of BuildMeshlets output against its source: meshlets stay within the limits, expanding all of
+	// them reproduces the index buffer, and every non degenerate triangle lies inside its meshlet's cone with the
+	// apex behind its plane, which is what makes IsMeshletBackfacing conservative.
+	template<class Vertex, class Index>
+	inline bool ValidateMeshlets(const MeshletMesh& mesh, const Vertex* vertices, const Index* indices, const uint32_t& indexCount, const uint32_t& maxVertices = RIG_MESHLET_MAX_VERTICES, const uint32_t& maxTriangles = RIG_MESHLET_MAX_TRIANGLES)
+	{
+		if (mesh.bounds.size() != mesh.meshlets.size() || mesh.triangleCount != indexCount / 3)
+		{
+			return false;
+		}
+
+		uint32_t index = 0;
+		for (uint32_t m = 0; m < mesh.meshlets.size(); m++)
+		{
+			const Meshlet& meshlet = mesh.meshlets[m];
+			const MeshletBounds& bounds = mesh.bounds[m];
+			if (meshlet.vertexCount > maxVertices || meshlet.triangleCount > maxTriangles ||
+				meshlet.vertexOffset + meshlet.vertexCount > mesh.vertices.size() ||
+				(meshlet.triangleOffset + meshlet.triangleCount) * 3u > mesh.triangles.size())
+			{
+				return false;
+			}
+
+			// Tolerances scale with the meshlet so large meshes do not trip on rounding
+			float tolerance = 1e-4f * (1.0f + bounds.radius);
+			float minimumDot = (bounds.coneCutoff <= 1.0f) ? sqrtf(1.0f - bounds.coneCutoff * bounds.coneCutoff) : 0.0f;
+
+			for (uint32_t t = 0; t < meshlet.triangleCount; t++)
+			{
+				uint32_t corners[3];
+				for (uint32_t k = 0; k < 3; k++)
+				{
+					uint8_t local = mesh.triangles[(meshlet.triangleOffset + t) * 3 + k];
+					if (local >= meshlet.vertexCount)
+					{
+						return false;
+					}
+
+					corners[k] = mesh.vertices[meshlet.vertexOffset + local];
+					if (corners[k] != static_cast<uint32_t>(indices[index++]))
+					{
+						return false;
+					}
+				}
+
+				if (bounds.coneCutoff > 1.0f)
+				{
+					continue;
+				}
+
+				const vec3f& a = vertices[corners[0]].Position;
+				vec3f n = cliqCity::graphicsMath::cross(vertices[corners[1]].Position - a, vertices[corners[2]].Position - a);
+				float length = sqrtf(cliqCity::graphicsMath::dot(n, n));
+				if (length == 0.0f)
+				{
+					continue;
+				}
+
+				n /= length;
+				if (cliqCity::graphicsMath::dot(n, bounds.coneAxis) < minimumDot - 1e-4f || cliqCity::graphicsMath::dot(bounds.coneApex - a, n) > tolerance)
+				{
+					return false;
+				}
+			}
+		}
+
+		return index == indexCount - indexCount % 3;
+	}
+
+#pragma endregion
+}
@@ -0,0 +1,608 @@
+#pragma once
+#include "GraphicsMath/cgm.h"
+#include "Rig3D/TaskDispatch/TaskDispatcher.h"
+#include <vector>
+#include <algorithm>
+#include <limits>
+#include <math.h>
+#include <string.h>
+#include <stdint.h>
+
+#define RIG_OBJ_MISSING_INDEX	0xffffffff
+#define RIG_OBJ_MIN_CHUNK_SIZE	(1 << 20)
+#define RIG_OBJ_MAX_CHUNKS		64
+
+// Wavefront OBJ parsing straight out of memory (see MemoryMappedFile). The text is cut into chunks at line breaks,
+// each chunk is parsed on its own and the results are concatenated in file order, so the output does not depend on
+// how many chunks or threads were used. Faces may have any number of corners (fan triangulated), any of the
+// v, v/vt, v//vn and v/vt/vn forms, and negative (relative) indices. Missing normals are generated per position.
+namespace Rig3D
+{
+	struct OBJCorner
+	{
+		uint32_t position;
+		uint32_t uv;
+		uint32_t normal;
+	};
+
+	struct OBJData
+	{
+		std::vector<vec3f>		positions;
+		std::vector<vec2f>		uvs;
+		std::vector<vec3f>		normals;
+		std::vector<OBJCorner>	corners;	// 3 per triangle
+	};
+
+	struct OBJChunk
+	{
+		const char*					begin;
+		const char*					end;
+		std::vector<vec3f>			positions;
+		std::vector<vec2f>			uvs;
+		std::vector<vec3f>			normals;
+		std::vector<OBJCorner>		corners;
+		std::vector<uint32_t>		relativeCorners[3];	// Corner slots holding chunk relative position, uv, normal indices
+		OBJData*					output;
+		uint32_t					offsets[3];			// Positions, uvs and normals in earlier chunks
+		uint32_t					totals[3];
+		size_t						cornerOffset;
+		bool						valid;
+		cliqCity::multicore::TaskID	taskID;
+	};
+
+#pragma region Lexing
+
+	inline bool IsOBJSpace(const char& c)
+	{
+		return c == ' ' || c == '\t';
+	}
+
+	inline const char* SkipOBJSpace(const char* p, const char* end)
+	{
+		while (p < end && IsOBJSpace(*p))
+		{
+			p++;
+		}
+
+		return p;
+	}
+
+	inline const char* SkipOBJLine(const char* p, const char* end)
+	{
+		const char* newline = static_cast<const char*>(memchr(p, '\n', end - p));
+		return newline ? newline + 1 : end;
+	}
+
+	// Decimal float with optional sign, fraction and exponent. Up to 19 significant digits are accumulated exactly
+	// and scaled once in double precision. Returns false and leaves p unchanged when there is no number.
+	inline bool ParseOBJFloat(const char*& p, const char* end, float& value)
+	{
+		static const double powers[] =
+		{
+			1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+			1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+		};
+
+		const char* s = p;
+		bool negative = false;
+		if (s < end && (*s == '-' || *s == '+'))
+		{
+			negative = (*s == '-');
+			s++;
+		}
+
+		uint64_t mantissa = 0;
+		int32_t digits = 0;
+		int32_t exponent = 0;
+		bool any = false;
+
+		for (; s < end && static_cast<uint8_t>(*s - '0') < 10; s++, any = true)
+		{
+			if (digits < 19)
+			{
+				mantissa = mantissa * 10 + (*s - '0');
+				digits += (mantissa != 0);
+			}
+			else
+			{
+				exponent++;
+			}
+		}
+
+		if (s < end && *s == '.')
+		{
+			for (s++; s < end && static_cast<uint8_t>(*s - '0') < 10; s++, any = true)
+			{
+				if (digits < 19)
+				{
+					mantissa = mantissa * 10 + (*s - '0');
+					digits += (mantissa != 0);
+					exponent--;
+				}
+			}
+		}
+
+		if (!any)
+		{
+			return false;
+		}
+
+		if (s < end && (*s == 'e' || *s == 'E'))
+		{
+			const char* e = s + 1;
+			bool negativeExponent = false;
+			if (e < end && (*e == '-' || *e == '+'))
+			{
+				negativeExponent = (*e == '-');
+				e++;
+			}
+
+			if (e < end && static_cast<uint8_t>(*e - '0') < 10)
+			{
+				int32_t explicitExponent = 0;
+				for (; e < end && static_cast<uint8_t>(*e - '0') < 10; e++)
+				{
+					explicitExponent = (std::min)(explicitExponent * 10 + (*e - '0'), 1000);
+				}
+
+				exponent += negativeExponent ? -explicitExponent : explicitExponent;
+				s = e;
+			}
+		}
+
+		double result = static_cast<double>(mantissa);
+		if (exponent < 0)
+		{
+			result = (exponent >= -22) ? result / powers[-exponent] : result * pow(10.0, exponent);
+		}
+		else if (exponent > 0)
+		{
+			result = (exponent <= 22) ? result * powers[exponent] : result * pow(10.0, exponent);
+		}
+
+		value = static_cast<float>(negative ? -result : result);
+		p = s;
+		return true;
+	}
+
+	inline bool ParseOBJInteger(const char*& p, const char* end, int64_t& value)
+	{
+		const char* s = p;
+		bool negative = false;
+		if (s < end && (*s == '-' || *s == '+'))
+		{
+			negative = (*s == '-');
+			s++;
+		}
+
+		if (s == end || static_cast<uint8_t>(*s - '0') >= 10)
+		{
+			return false;
+		}
+
+		// Anything past 12 digits is out of range anyway
+		int64_t result = 0;
+		for (uint32_t digits = 0; s < end && static_cast<uint8_t>(*s - '0') < 10; s++, digits++)
+		{
+			result = (digits < 12) ? result * 10 + (*s - '0') : result;
+		}
+
+		value = negative ? -result : result;
+		p = s;
+		return true;
+	}
+
+	inline uint32_t ParseOBJFloats(const char*& p, const char* end, float* values, const uint32_t& count)
+	{
+		uint32_t parsed = 0;
+		for (; parsed < count; parsed++)
+		{
+			p = SkipOBJSpace(p, end);
+			if (!ParseOBJFloat(p, end, values[parsed]))
+			{
+				break;
+			}
+		}
+
+		return parsed;
+	}
+
+#pragma endregion
+
+#pragma region Chunks
+
+	// Positive indices are stored 0 based and absolute. Negative ones are stored relative to the start of the chunk
+	// and flagged so the merge can add the number of elements in earlier chunks. 0 is invalid.
+	inline bool SetOBJCornerIndex(uint32_t& index, uint8_t& relative, const int64_t& value, const size_t& localCount, const uint32_t& attribute)
+	{
+		if (value > 0)
+		{
+			index = static_cast<uint32_t>(value - 1);
+			return true;
+		}
+
+		if (value < 0)
+		{
+			index = static_cast<uint32_t>(static_cast<int64_t>(localCount) + value);
+			relative |= (1 << attribute);
+			return true;
+		}
+
+		return false;
+	}
+
+	inline void EmitOBJCorner(OBJChunk& chunk, const OBJCorner& corner, const uint8_t& relative)
+	{
+		for (uint32_t a = 0; relative >> a; a++)
+		{
+			if (relative & (1 << a))
+			{
+				chunk.relativeCorners[a].push_back(static_cast<uint32_t>(chunk.corners.size()));
+			}
+		}
+
+		chunk.corners.push_back(corner);
+	}
+
+	// Corners are fan triangulated as they are read: (first, previous, current) from the third corner on.
+	inline bool ParseOBJFace(OBJChunk& chunk, const char* p, const char* end)
+	{
+		size_t counts[3] = { chunk.positions.size(), chunk.uvs.size(), chunk.normals.size() };
+
+		OBJCorner first, previous;
+		uint8_t firstRelative = 0, previousRelative = 0;
+		uint32_t cornerCount = 0;
+
+		while (true)
+		{
+			p = SkipOBJSpace(p, end);
+
+			int64_t values[3] = { 0, 0, 0 };
+			if (!ParseOBJInteger(p, end, values[0]))
+			{
+				break;
+			}
+
+			for (uint32_t a = 1; a < 3 && p < end && *p == '/'; a++)
+			{
+				p++;
+				ParseOBJInteger(p, end, values[a]);
+			}
+
+			OBJCorner corner = { 0, RIG_OBJ_MISSING_INDEX, RIG_OBJ_MISSING_INDEX };
+			uint8_t relative = 0;
+
+			if (!SetOBJCornerIndex(corner.position, relative, values[0], counts[0], 0))
+			{
+				return false;
+			}
+
+			if (values[1] != 0)
+			{
+				SetOBJCornerIndex(corner.uv, relative, values[1], counts[1], 1);
+			}
+
+			if (values[2] != 0)
+			{
+				SetOBJCornerIndex(corner.normal, relative, values[2], counts[2], 2);
+			}
+
+			if (cornerCount == 0)
+			{
+				first = corner;
+				firstRelative = relative;
+			}
+			else if (cornerCount >= 2)
+			{
+				EmitOBJCorner(chunk, first, firstRelative);
+				EmitOBJCorner(chunk, previous, previousRelative);
+				EmitOBJCorner(chunk, corner, relative);
+			}
+
+			previous = corner;
+			previousRelative = relative;
+			cornerCount++;
+
+			// Skip anything else glued to the corner
+			while (p < end && !IsOBJSpace(*p) && *p != '\r' && *p != '\n')
+			{
+				p++;
+			}
+		}
+
+		return cornerCount == 0 || cornerCount >= 3;
+	}
+
+	inline void ParseOBJChunk(OBJChunk& chunk)
+	{
+		chunk.valid = true;
+
+		const char* p = chunk.begin;
+		const char* end = chunk.end;
+		while (p < end)
+		{
+			p = SkipOBJSpace(p, end);
+			if (p == end)
+			{
+				break;
+			}
+
+			const char* line = p;
+			p = SkipOBJLine(p, end);
+
+			if (line[0] == 'v' && line + 1 < end)
+			{
+				float values[3] = { 0.0f, 0.0f, 0.0f };
+				if (IsOBJSpace(line[1]))
+				{
+					const char* q = line + 2;
+					if (ParseOBJFloats(q, p, values, 3) < 3)
+					{
+						chunk.valid = false;
+					}
+
+					chunk.positions.push_back(vec3f(values[0], values[1], values[2]));
+				}
+				else if (line[1] == 't' && line + 2 < end && IsOBJSpace(line[2]))
+				{
+					const char* q = line + 3;
+					if (ParseOBJFloats(q, p, values, 2) < 1)
+					{
+						chunk.valid = false;
+					}
+
+					chunk.uvs.push_back(vec2f(values[0], values[1]));
+				}
+				else if (line[1] == 'n' && line + 2 < end && IsOBJSpace(line[2]))
+				{
+					const char* q = line + 3;
+					if (ParseOBJFloats(q, p, values, 3) < 3)
+					{
+						chunk.valid = false;
+					}
+
+					chunk.normals.push_back(vec3f(values[0], values[1], values[2]));
+				}
+			}
+			else if (line[0] == 'f' && line + 1 < end && IsOBJSpace(line[1]))
+			{
+				if (!ParseOBJFace(chunk, line + 2, p))
+				{
+					chunk.valid = false;
+				}
+			}
+		}
+	}
+
+	inline void PerformOBJChunkTask(const cliqCity::multicore::TaskData& data)
+	{
+		ParseOBJChunk(*reinterpret_cast<OBJChunk*>(data.mKernelData));
+	}
+
+	// Turns chunk relative indices into file indices and checks every corner against the file totals.
+	inline void RebaseOBJChunk(OBJChunk& chunk)
+	{
+		for (uint32_t a = 0; a < 3; a++)
+		{
+			for (uint32_t slot : chunk.relativeCorners[a])
+			{
+				(&chunk.corners[slot].position)[a] += chunk.offsets[a];
+			}
+		}
+
+		for (const OBJCorner& corner : chunk.corners)
+		{
+			if (corner.position >= chunk.totals[0] ||
+				(corner.uv != RIG_OBJ_MISSING_INDEX && corner.uv >= chunk.totals[1]) ||
+				(corner.normal != RIG_OBJ_MISSING_INDEX && corner.normal >= chunk.totals[2]))
+			{
+				chunk.valid = false;
+				return;
+			}
+		}
+	}
+
+	inline void PerformOBJMergeTask(const cliqCity::multicore::TaskData& data)
+	{
+		OBJChunk& chunk = *reinterpret_cast<OBJChunk*>(data.mKernelData);
+		OBJData& output = *chunk.output;
+
+		RebaseOBJChunk(chunk);
+
+		std::copy(chunk.positions.begin(), chunk.positions.end(), output.positions.begin() + chunk.offsets[0]);
+		std::copy(chunk.uvs.begin(), chunk.uvs.end(), output.uvs.begin() + chunk.offsets[1]);
+		std::copy(chunk.normals.begin(), chunk.normals.end(), output.normals.begin() + chunk.offsets[2]);
+		std::copy(chunk.corners.begin(), chunk.corners.end(), output.corners.begin() + chunk.cornerOffset);
+	}
+
+#pragma endregion
+
+#pragma region Parsing
+
+	// Parses size bytes of OBJ text. Chunks run on dispatcher when one is given, otherwise on the calling thread.
+	// Returns false on malformed records or out of range indices.
+	inline bool ParseOBJ(OBJData& data, const char* text, const size_t& size, cliqCity::multicore::TaskDispatcher* dispatcher = nullptr)
+	{
+		data.positions.clear();
+		data.uvs.clear();
+		data.normals.clear();
+		data.corners.clear();
+
+		size_t chunkCount = dispatcher ? (std::max<size_t>)(1, (std::min<size_t>)(size / RIG_OBJ_MIN_CHUNK_SIZE, RIG_OBJ_MAX_CHUNKS)) : 1;
+		std::vector<OBJChunk> chunks(chunkCount);
+
+		const char* end = text + size;
+		const char* begin = text;
+		for (size_t i = 0; i < chunkCount; i++)
+		{
+			const char* split = (i + 1 == chunkCount) ? end : (std::max)(begin, text + size / chunkCount * (i + 1));
+			chunks[i].begin = begin;
+			chunks[i].end = (split < end) ? SkipOBJLine(split, end) : end;
+			begin = chunks[i].end;
+		}
+
+		if (dispatcher)
+		{
+			cliqCity::multicore::TaskData taskData;
+			for (size_t i = 0; i < chunkCount; i++)
+			{
+				taskData.mKernelData = &chunks[i];
+				chunks[i].taskID = dispatcher->AddTask(taskData, PerformOBJChunkTask);
+			}
+
+			for (size_t i = 0; i < chunkCount; i++)
+			{
+				dispatcher->WaitForTask(chunks[i].taskID);
+			}
+		}
+		else
+		{
+			ParseOBJChunk(chunks[0]);
+		}
+
+		uint32_t totals[3] = { 0, 0, 0 };
+		size_t cornerCount = 0;
+		for (size_t i = 0; i < chunkCount; i++)
+		{
+			if (!chunks[i].valid)
+			{
+				return false;
+			}
+
+			OBJChunk& chunk = chunks[i];
+			chunk.output = &data;
+			chunk.offsets[0] = totals[0];
+			chunk.offsets[1] = totals[1];
+			chunk.offsets[2] = totals[2];
+			chunk.cornerOffset = cornerCount;
+
+			totals[0] += static_cast<uint32_t>(chunk.positions.size());
+			totals[1] += static_cast<uint32_t>(chunk.uvs.size());
+			totals[2] += static_cast<uint32_t>(chunk.normals.size());
+			cornerCount += chunk.corners.size();
+		}
+
+		for (size_t i = 0; i < chunkCount; i++)
+		{
+			memcpy(chunks[i].totals, totals, sizeof(totals));
+		}
+
+		if (chunkCount == 1)
+		{
+			RebaseOBJChunk(chunks[0]);
+
+			data.positions.swap(chunks[0].positions);
+			data.uvs.swap(chunks[0].uvs);
+			data.normals.swap(chunks[0].normals);
+			data.corners.swap(chunks[0].corners);
+
+			return chunks[0].valid;
+		}
+
+		data.positions.resize(totals[0]);
+		data.uvs.resize(totals[1]);
+		data.normals.resize(totals[2]);
+		data.corners.resize(cornerCount);
+
+		cliqCity::multicore::TaskData taskData;
+		for (size_t i = 0; i < chunkCount; i++)
+		{
+			taskData.mKernelData = &chunks[i];
+			chunks[i].taskID = dispatcher->AddTask(taskData, PerformOBJMergeTask);
+		}
+
+		bool valid = true;
+		for (size_t i = 0; i < chunkCount; i++)
+		{
+			dispatcher->WaitForTask(chunks[i].taskID);
+			valid &= chunks[i].valid;
+		}
+
+		return valid;
+	}
+
+	// Builds an indexed mesh from parsed data. Corners sharing position, uv and normal become one vertex. Vertex
+	// needs Position, UV and Normal; missing UVs are zero and missing normals are area weighted per position.
+	// Returns false when the vertex count does not fit Index.
+	template<class Vertex, class Index>
+	inline bool BuildOBJMesh(std::vector<Vertex>& vertices, std::vector<Index>& indices, const OBJData& data)
+	{
+		vertices.clear();
+		indices.clear();
+
+		uint32_t positionCount = static_cast<uint32_t>(data.positions.size());
+		uint32_t cornerCount = static_cast<uint32_t>(data.corners.size());
+
+		std::vector<vec3f> generatedNormals;
+		for (uint32_t i = 0; i < cornerCount; i += 3)
+		{
+			const OBJCorner* c = &data.corners[i];
+			if (c[0].normal != RIG_OBJ_MISSING_INDEX && c[1].normal != RIG_OBJ_MISSING_INDEX && c[2].normal != RIG_OBJ_MISSING_INDEX)
+			{
+				continue;
+			}
+
+			if (generatedNormals.empty())
+			{
+				generatedNormals.assign(positionCount, vec3f(0.0f, 0.0f, 0.0f));
+			}
+
+			const vec3f& a = data.positions[c[0].position];
+			vec3f n = cliqCity::graphicsMath::cross(data.positions[c[1].position] - a, data.positions[c[2].position] - a);
+			for (uint32_t k = 0; k < 3; k++)
+			{
+				generatedNormals[c[k].position] += n;
+			}
+		}
+
+		for (vec3f& n : generatedNormals)
+		{
+			float length = cliqCity::graphicsMath::magnitude(n);
+			n = (length > 0.0f) ? n / length : vec3f(0.0f, 1.0f, 0.0f);
+		}
+
+		// Chains of the vertices created for each position, matched on uv and normal
+		std::vector<uint32_t> heads(positionCount, RIG_OBJ_MISSING_INDEX);
+		std::vector<uint32_t> next;
+		std::vector<OBJCorner> keys;
+
+		indices.resize(cornerCount);
+		for (uint32_t i = 0; i < cornerCount; i++)
+		{
+			const OBJCorner& corner = data.corners[i];
+
+			uint32_t vertex = heads[corner.position];
+			while (vertex != RIG_OBJ_MISSING_INDEX && (keys[vertex].uv != corner.uv || keys[vertex].normal != corner.normal))
+			{
+				vertex = next[vertex];
+			}
+
+			if (vertex == RIG_OBJ_MISSING_INDEX)
+			{
+				vertex = static_cast<uint32_t>(keys.size());
+				if (static_cast<uint64_t>(vertex) > static_cast<uint64_t>((std::numeric_limits<Index>::max)()))
+				{
+					vertices.clear();
+					indices.clear();
+					return false;
+				}
+
+				keys.push_back(corner);
+				next.push_back(heads[corner.position]);
+				heads[corner.position] = vertex;
+
+				Vertex v;
+				v.Position = data.positions[corner.position];
+				v.UV = (corner.uv != RIG_OBJ_MISSING_INDEX) ? data.uvs[corner.uv] : vec2f(0.0f, 0.0f);
+				v.Normal = (corner.normal != RIG_OBJ_MISSING_INDEX) ? data.normals[corner.normal] : generatedNormals[corner.position];
+				vertices.push_back(v);
+			}
+
+			indices[i] = static_cast<Index>(vertex);
+		}
+
+		return true;
+	}
+
+#pragma endregion
+}
@@ -0,0 +1,293 @@
+#pragma once
+#include "GraphicsMath/cgm.h"
+#include "Rig3D/TaskDispatch/TaskDispatcher.h"
+#include "Rig3D/Graphics/MeshOptimization.h"
+#include <vector>
+#include <algorithm>
+#include <float.h>
+#include <math.h>
+#include <string.h>
+
+// Per vertex tangent frames for normal mapping, written to Vertex::Tangent as (tangent, w) with the bitangent
+// reconstructed as cross(normal, tangent) * w. Work runs on an indexed mesh. Vertices sharing position and normal
+// accumulate together so UV seams stay smooth, and contributions are kept apart by handedness so mirrored UVs do
+// not cancel. Accumulation goes to one flat array per triangle range and the ranges are summed when vertices are
+// resolved, so the parallel version needs no atomics. Neither mode is MikkTSpace: welding across UV seams merges
+// tangent spaces MikkTSpace keeps apart, so normal maps baked against MikkTSpace will show seams.
+namespace Rig3D
+{
+	enum TangentFrameMode
+	{
+		TANGENT_FRAME_FACE_AVERAGE,		// Sum of the raw face tangents
+		TANGENT_FRAME_ANGLE_WEIGHTED	// Face tangents projected onto the vertex normal, normalized and angle weighted
+	};
+
+	struct TangentAccumulator
+	{
+		vec3f	tangent;
+		float	weight;
+	};
+
+	struct TangentFrameScratch
+	{
+		std::vector<uint32_t>			welds;			// Vertex to accumulator pair (right handed, left handed)
+		std::vector<TangentAccumulator>	accumulators;	// rangeCount partial arrays of 2 * weldCount
+		std::vector<float>				handedness;		// rangeCount partial arrays of vertexCount signed weights
+		uint32_t						weldCount;
+		uint32_t						vertexCount;
+		uint32_t						rangeCount;
+	};
+
+	template<class Vertex, class Index>
+	struct TangentFrameRange
+	{
+		Vertex*						vertices;
+		const Index*				indices;
+		TangentFrameScratch*		scratch;
+		TangentFrameMode			mode;
+		uint32_t					rangeIndex;
+		uint32_t					first;		// Triangle when accumulating, vertex when resolving
+		uint32_t					count;
+		cliqCity::multicore::TaskID	taskID;
+	};
+
+	struct TangentWeldKey
+	{
+		vec3f position;
+		vec3f normal;
+	};
+
+	// Maps every vertex to the first vertex with a bitwise equal position and normal.
+	template<class Vertex>
+	inline void InitializeTangentFrameScratch(TangentFrameScratch& scratch, const Vertex* vertices, const uint32_t& vertexCount, const uint32_t& rangeCount)
+	{
+		uint32_t tableSize = 1;
+		while (tableSize < vertexCount * 2)
+		{
+			tableSize <<= 1;
+		}
+
+		std::vector<uint32_t> table(tableSize, UINT32_MAX);
+		std::vector<TangentWeldKey> keys;
+		keys.reserve(vertexCount);
+
+		scratch.welds.resize(vertexCount);
+		for (uint32_t v = 0; v < vertexCount; v++)
+		{
+			TangentWeldKey key;
+			memset(&key, 0, sizeof(key));
+			key.position = vertices[v].Position;
+			key.normal = vertices[v].Normal;
+
+			uint32_t slot = HashVertexBytes(&key, sizeof(key)) & (tableSize - 1);
+			while (table[slot] != UINT32_MAX && memcmp(&keys[table[slot]], &key, sizeof(key)) != 0)
+			{
+				slot = (slot + 1) & (tableSize - 1);
+			}
+
+			if (table[slot] == UINT32_MAX)
+			{
+				table[slot] = static_cast<uint32_t>(keys.size());
+				keys.push_back(key);
+			}
+
+			scratch.welds[v] = table[slot];
+		}
+
+		scratch.weldCount = static_cast<uint32_t>(keys.size());
+		scratch.vertexCount = vertexCount;
+		scratch.rangeCount = (std::max)(rangeCount, 1u);
+
+		TangentAccumulator zero = { vec3f(0.0f, 0.0f, 0.0f), 0.0f };
+		scratch.accumulators.assign(static_cast<size_t>(scratch.rangeCount) * scratch.weldCount * 2, zero);
+		scratch.handedness.assign(static_cast<size_t>(scratch.rangeCount) * vertexCount, 0.0f);
+	}
+
+	// Angle at corner between the edges to the other two corners, measured in the plane of the normal.
+	inline float GetTangentCornerAngle(const vec3f& normal, const vec3f& a, const vec3f& b)
+	{
+		vec3f u = a - normal * cliqCity::graphicsMath::dot(normal, a);
+		vec3f v = b - normal * cliqCity::graphicsMath::dot(normal, b);
+		float lengths = cliqCity::graphicsMath::magnitude(u) * cliqCity::graphicsMath::magnitude(v);
+		if (lengths <= 0.0f)
+		{
+			return 0.0f;
+		}
+
+		return acosf((std::max)(-1.0f, (std::min)(1.0f, cliqCity::graphicsMath::dot(u, v) / lengths)));
+	}
+
+	template<class Vertex, class Index>
+	inline void AccumulateTangentFrames(TangentFrameScratch& scratch, const Vertex* vertices, const Index* indices, const uint32_t& firstTriangle, const uint32_t& triangleCount, const uint32_t& rangeIndex, const TangentFrameMode& mode)
+	{
+		TangentAccumulator* accumulators = &scratch.accumulators[static_cast<size_t>(rangeIndex) * scratch.weldCount * 2];
+		float* handedness = &scratch.handedness[static_cast<size_t>(rangeIndex) * scratch.vertexCount];
+
+		for (uint32_t t = firstTriangle; t < firstTriangle + triangleCount; t++)
+		{
+			uint32_t corners[3] = { static_cast<uint32_t>(indices[t * 3]), static_cast<uint32_t>(indices[t * 3 + 1]), static_cast<uint32_t>(indices[t * 3 + 2]) };
+			const Vertex& v0 = vertices[corners[0]];
+			const Vertex& v1 = vertices[corners[1]];
+			const Vertex& v2 = vertices[corners[2]];
+
+			vec3f e1 = v1.Position - v0.Position;
+			vec3f e2 = v2.Position - v0.Position;
+			float s1 = v1.UV.x - v0.UV.x;
+			float s2 = v2.UV.x - v0.UV.x;
+			float t1 = v1.UV.y - v0.UV.y;
+			float t2 = v2.UV.y - v0.UV.y;
+
+			float d = (s1 * t2) - (s2 * t1);
+			if (fabsf(d) <= FLT_MIN)
+			{
+				continue;
+			}
+
+			float r = 1.0f / d;
+			vec3f tangent = (e1 * t2 - e2 * t1) * r;
+			vec3f bitangent = (e2 * s1 - e1 * s2) * r;
+
+			for (uint32_t k = 0; k < 3; k++)
+			{
+				const Vertex& v = vertices[corners[k]];
+				const vec3f& n = v.Normal;
+
+				bool leftHanded = cliqCity::graphicsMath::dot(cliqCity::graphicsMath::cross(n, tangent), bitangent) < 0.0f;
+				TangentAccumulator& accumulator = accumulators[scratch.welds[corners[k]] * 2 + (leftHanded ? 1 : 0)];
+
+				float weight = 1.0f;
+				if (mode == TANGENT_FRAME_ANGLE_WEIGHTED)
+				{
+					vec3f projected = tangent - n * cliqCity::graphicsMath::dot(n, tangent);
+					float length = cliqCity::graphicsMath::magnitude(projected);
+					if (length <= 0.0f)
+					{
+						continue;
+					}
+
+					const Vertex& a = vertices[corners[(k + 1) % 3]];
+					const Vertex& b = vertices[corners[(k + 2) % 3]];
+					weight = GetTangentCornerAngle(n, a.Position - v.Position, b.Position - v.Position);
+					accumulator.tangent += projected * (weight / length);
+				}
+				else
+				{
+					accumulator.tangent += tangent;
+				}
+
+				accumulator.weight += weight;
+				handedness[corners[k]] += leftHanded ? -weight : weight;
+			}
+		}
+	}
+
+	// Sums the partial arrays for vertices [first, first + count) and writes their tangents.
+	template<class Vertex>
+	inline void ResolveTangentFrames(TangentFrameScratch& scratch, Vertex* vertices, const uint32_t& first, const uint32_t& count)
+	{
+		size_t accumulatorStride = static_cast<size_t>(scratch.weldCount) * 2;
+
+		for (uint32_t i = first; i < first + count; i++)
+		{
+			float sign = 0.0f;
+			for (uint32_t r = 0; r < scratch.rangeCount; r++)
+			{
+				sign += scratch.handedness[static_cast<size_t>(r) * scratch.vertexCount + i];
+			}
+
+			uint32_t slot = scratch.welds[i] * 2 + ((sign < 0.0f) ? 1 : 0);
+			vec3f tangent = { 0.0f, 0.0f, 0.0f };
+			for (uint32_t r = 0; r < scratch.rangeCount; r++)
+			{
+				tangent += scratch.accumulators[r * accumulatorStride + slot].tangent;
+			}
+
+			const vec3f& n = vertices[i].Normal;
+			tangent = tangent - n * cliqCity::graphicsMath::dot(n, tangent);
+			float length = cliqCity::graphicsMath::magnitude(tangent);
+
+			// No usable UVs: any direction perpendicular to the normal
+			if (length <= FLT_MIN)
+			{
+				vec3f axis = (fabsf(n.x) < 0.9f) ? vec3f(1.0f, 0.0f, 0.0f) : vec3f(0.0f, 1.0f, 0.0f);
+				tangent = axis - n * cliqCity::graphicsMath::dot(n, axis);
+				length = cliqCity::graphicsMath::magnitude(tangent);
+			}
+
+			vertices[i].Tangent = vec4f(tangent / length, (sign < 0.0f) ? -1.0f : 1.0f);
+		}
+	}
+
+	// Vertex {Position: vec3f, Normal: vec3f, UV: vec2f, Tangent: vec4f} with unit normals.
+	template<class Vertex, class Index>
+	void GenerateTangentFrames(Vertex* vertices, const uint32_t& vertexCount, const Index* indices, const uint32_t& indexCount, const TangentFrameMode& mode = TANGENT_FRAME_FACE_AVERAGE)
+	{
+		TangentFrameScratch scratch;
+		InitializeTangentFrameScratch(scratch, vertices, vertexCount, 1);
+		AccumulateTangentFrames(scratch, vertices, indices, 0, indexCount / 3, 0, mode);
+		ResolveTangentFrames(scratch, vertices, 0, vertexCount);
+	}
+
+	template<class Vertex, class Index>
+	void GenerateTangentFrames(std::vector<Vertex>& vertices, const std::vector<Index>& indices, const TangentFrameMode& mode = TANGENT_FRAME_FACE_AVERAGE)
+	{
+		if (!vertices.empty() && !indices.empty())
+		{
+			GenerateTangentFrames(&vertices[0], static_cast<uint32_t>(vertices.size()), &indices[0], static_cast<uint32_t>(indices.size()), mode);
+		}
+	}
+
+	template<class Vertex, class Index>
+	inline void PerformTangentAccumulateTask(const cliqCity::multicore::TaskData& data)
+	{
+		TangentFrameRange<Vertex, Index>* range = reinterpret_cast<TangentFrameRange<Vertex, Index>*>(data.mKernelData);
+		AccumulateTangentFrames(*range->scratch, range->vertices, range->indices, range->first, range->count, range->rangeIndex, range->mode);
+	}
+
+	template<class Vertex, class Index>
+	inline void PerformTangentResolveTask(const cliqCity::multicore::TaskData& data)
+	{
+		TangentFrameRange<Vertex, Index>* range = reinterpret_cast<TangentFrameRange<Vertex, Index>*>(data.mKernelData);
+		ResolveTangentFrames(*range->scratch, range->vertices, range->first, range->count);
+	}
+
+	// Accumulates triangle ranges, then resolves vertex ranges, as rangeCount tasks each. ranges is caller owned
+	// scratch with rangeCount elements; scratch is reused between calls.
+	template<class Vertex, class Index>
+	void GenerateTangentFramesParallel(cliqCity::multicore::TaskDispatcher& dispatcher, Vertex* vertices, const uint32_t& vertexCount, const Index* indices, const uint32_t& indexCount, TangentFrameRange<Vertex, Index>* ranges, const uint32_t& rangeCount, TangentFrameScratch& scratch, const TangentFrameMode& mode = TANGENT_FRAME_FACE_AVERAGE)
+	{
+		InitializeTangentFrameScratch(scratch, vertices, vertexCount, rangeCount);
+
+		uint32_t triangleCount = indexCount / 3;
+		uint32_t triangleRangeSize = (triangleCount + rangeCount - 1) / rangeCount;
+		uint32_t vertexRangeSize = (vertexCount + rangeCount - 1) / rangeCount;
+
+		cliqCity::multicore::TaskData data;
+		for (uint32_t pass = 0; pass < 2; pass++)
+		{
+			uint32_t total = (pass == 0) ? triangleCount : vertexCount;
+			uint32_t rangeSize = (pass == 0) ? triangleRangeSize : vertexRangeSize;
+
+			uint32_t taskCount = 0;
+			for (uint32_t first = 0; first < total; first += rangeSize, taskCount++)
+			{
+				TangentFrameRange<Vertex, Index>& range = ranges[taskCount];
+				range.vertices = vertices;
+				range.indices = indices;
+				range.scratch = &scratch;
+				range.mode = mode;
+				range.rangeIndex = taskCount;
+				range.first = first;
+				range.count = (std::min)(rangeSize, total - first);
+
+				data.mKernelData = &range;
+				range.taskID = (pass == 0) ? dispatcher.AddTask(data, PerformTangentAccumulateTask<Vertex, Index>) : dispatcher.AddTask(data, PerformTangentResolveTask<Vertex, Index>);
+			}
+
+			for (uint32_t i = 0; i < taskCount; i++)
+			{
+				dispatcher.WaitForTask(ranges[i].taskID);
+			}
+		}
+	}
+}
@@ -0,0 +1,550 @@
+#pragma once
+#include "GraphicsMath/cgm.h"
+#include <immintrin.h>
+#include <algorithm>
+#include <float.h>
+#include <math.h>
+#include <string.h>
+#include <stdint.h>
+
+#define RIG_QUANTIZE_BLOCK_SIZE 64
+
+// Compressed vertex attributes. Positions are stored as half floats, or as 16 bit UNORM relative to the mesh bounds
+// when more precision is needed; the dequantization is then folded into the world matrix. UVs are half floats and
+// unit vectors use octahedral encoding in two 16 bit SNORM components. The tangent handedness rides in the unused
+// position w, so a normal mapped vertex drops from 48 to 20 bytes and a Vertex3 from 32 to 16.
+//
+// Vertex shader decode of an octahedral vector e:
+//		float3 n = float3(e.xy, 1.0f - abs(e.x) - abs(e.y));
+//		float t = saturate(-n.z);
+//		n.xy += (n.xy >= 0.0f) ? -t : t;
+//		n = normalize(n);
+//
+// Position.w is not a homogeneous coordinate. In a QuantizedTangentVertex it carries the bitangent sign, which is
+// -1 or 0 on mirrored vertices, so transforming float4(position) directly drops the translation or flips the point.
+// Always rebuild w before the world transform and decode the sign separately:
+//		float4 p = float4(position.xyz, 1.0f);
+//		float bitangentSign = (position.w > 0.5f) ? 1.0f : -1.0f;	// Works for both the half and UNORM encodings
+namespace Rig3D
+{
+	// Input layout: RGBA_FLOAT16 or RGBA_UNORM16, RG_SNORM16, RG_FLOAT16
+	struct QuantizedVertex3
+	{
+		uint16_t	Position[4];
+		int16_t		Normal[2];
+		uint16_t	UV[2];
+	};
+
+	// Input layout: RGBA_FLOAT16 or RGBA_UNORM16, RG_SNORM16, RG_FLOAT16, RG_SNORM16. Position.w holds the
+	// bitangent sign (+1 / -1 as half, 1 / 0 as UNORM); shaders must replace it with 1 before transforming.
+	struct QuantizedTangentVertex
+	{
+		uint16_t	Position[4];
+		int16_t		Normal[2];
+		uint16_t	UV[2];
+		int16_t		Tangent[2];
+	};
+
+	// position = offset + scale * unorm. A zero scale on an axis means the mesh is flat along it.
+	struct VertexQuantizationBounds
+	{
+		vec3f	offset;
+		vec3f	scale;
+	};
+
+#pragma region Scalar
+
+	inline uint32_t FloatBits(const float& f)
+	{
+		uint32_t u;
+		memcpy(&u, &f, sizeof(u));
+		return u;
+	}
+
+	inline float BitsFloat(const uint32_t& u)
+	{
+		float f;
+		memcpy(&f, &u, sizeof(f));
+		return f;
+	}
+
+	// Round to nearest even, overflow goes to infinity and NaN stays NaN.
+	inline uint16_t FloatToHalf(const float& value)
+	{
+		uint32_t f = FloatBits(value);
+		uint32_t sign = f & 0x80000000u;
+		f ^= sign;
+
+		uint32_t h;
+		if (f >= 0x47800000u)
+		{
+			h = (f > 0x7f800000u) ? 0x7e00u : 0x7c00u;
+		}
+		else if (f < 0x38800000u)
+		{
+			// Denormal or zero: let the FPU round by adding into the implicit bit of 0.5
+			h = FloatBits(BitsFloat(f) + 0.5f) - 0x3f000000u;
+		}
+		else
+		{
+			uint32_t odd = (f >> 13) & 1;
+			f += 0xc8000fffu + odd;
+			h = f >> 13;
+		}
+
+		return static_cast<uint16_t>(h | (sign >> 16));
+	}
+
+	inline float HalfToFloat(const uint16_t& value)
+	{
+		const uint32_t shiftedExponent = 0x7c00u << 13;
+
+		uint32_t f = (value & 0x7fffu) << 13;
+		uint32_t exponent = f & shiftedExponent;
+		f += (127 - 15) << 23;
+
+		if (exponent == shiftedExponent)
+		{
+			f += (128 - 16) << 23;
+		}
+		else if (exponent == 0)
+		{
+			f += 1 << 23;
+			f = FloatBits(BitsFloat(f) - BitsFloat(113 << 23));
+		}
+
+		return BitsFloat(f | ((value & 0x8000u) << 16));
+	}
+
+	inline int16_t FloatToSNORM16(const float& value)
+	{
+		float clamped = (std::max)(-1.0f, (std::min)(1.0f, value));
+		return static_cast<int16_t>(floorf(clamped * 32767.0f + 0.5f));
+	}
+
+	inline float SNORM16ToFloat(const int16_t& value)
+	{
+		return (std::max)(-1.0f, value / 32767.0f);
+	}
+
+	inline uint16_t FloatToUNORM16(const float& value)
+	{
+		float clamped = (std::max)(0.0f, (std::min)(1.0f, value));
+		return static_cast<uint16_t>(clamped * 65535.0f + 0.5f);
+	}
+
+	inline float UNORM16ToFloat(const uint16_t& value)
+	{
+		return value / 65535.0f;
+	}
+
+	// Projects onto the octahedron |x| + |y| + |z| = 1 and folds the lower hemisphere over the diagonals.
+	inline void EncodeOctahedral(int16_t* encoded, const vec3f& v)
+	{
+		float l1 = fabsf(v.x) + fabsf(v.y) + fabsf(v.z);
+		float inverse = (l1 > 0.0f) ? 1.0f / l1 : 0.0f;
+		float x = v.x * inverse;
+		float y = v.y * inverse;
+
+		if (v.z < 0.0f)
+		{
+			float fx = (1.0f - fabsf(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+			float fy = (1.0f - fabsf(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+			x = fx;
+			y = fy;
+		}
+
+		encoded[0] = FloatToSNORM16(x);
+		encoded[1] = FloatToSNORM16(y);
+	}
+
+	inline vec3f DecodeOctahedral(const int16_t* encoded)
+	{
+		vec3f v;
+		v.x = SNORM16ToFloat(encoded[0]);
+		v.y = SNORM16ToFloat(encoded[1]);
+		v.z = 1.0f - fabsf(v.x) - fabsf(v.y);
+
+		float t = (std::max)(-v.z, 0.0f);
+		v.x += (v.x >= 0.0f) ? -t : t;
+		v.y += (v.y >= 0.0f) ? -t : t;
+
+		return cliqCity::graphicsMath::normalize(v);
+	}
+
+#pragma endregion
+
+#pragma region Kernels
+
+	// floorf(v + 0.5f) per lane, the rounding FloatToSNORM16 and FloatToUNORM16 use, so vector and scalar tails
+	// produce the same bits. _mm_cvtps_epi32 would round half to even instead.
+	inline __m128i RoundHalfUp(const __m128& v)
+	{
+		__m128 t = _mm_add_ps(v, _mm_set1_ps(0.5f));
+		__m128i i = _mm_cvttps_epi32(t);
+
+		// Truncation moves negative fractions up; the compare mask is -1 in those lanes
+		return _mm_add_epi32(i, _mm_castps_si128(_mm_cmpgt_ps(_mm_cvtepi32_ps(i), t)));
+	}
+
+	// out[i] = half(in[i])
+	inline void EncodeHalf(uint16_t* out, const float* in, const uint32_t& count)
+	{
+		uint32_t i = 0;
+#if defined(__AVX2__)
+		for (; i + 8 <= count; i += 8)
+		{
+			__m128i h = _mm256_cvtps_ph(_mm256_loadu_ps(in + i), _MM_FROUND_TO_NEAREST_INT);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), h);
+		}
+#endif
+		for (; i < count; i++)
+		{
+			out[i] = FloatToHalf(in[i]);
+		}
+	}
+
+	inline void DecodeHalf(float* out, const uint16_t* in, const uint32_t& count)
+	{
+		uint32_t i = 0;
+#if defined(__AVX2__)
+		for (; i + 8 <= count; i += 8)
+		{
+			__m128i h = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+			_mm256_storeu_ps(out + i, _mm256_cvtph_ps(h));
+		}
+#endif
+		for (; i < count; i++)
+		{
+			out[i] = HalfToFloat(in[i]);
+		}
+	}
+
+	// out[i] = unorm16((in[i] - offset) / scale), in and out as separate x, y, z streams.
+	inline void EncodeUNORM16(uint16_t* out, const float* in, const uint32_t& count, const float& offset, const float& scale)
+	{
+		float inverse = (scale > 0.0f) ? 1.0f / scale : 0.0f;
+
+		uint32_t i = 0;
+		__m128 o = _mm_set1_ps(offset);
+		__m128 s = _mm_set1_ps(inverse);
+		__m128 zero = _mm_setzero_ps();
+		__m128 one = _mm_set1_ps(1.0f);
+		__m128 range = _mm_set1_ps(65535.0f);
+		__m128i bias = _mm_set1_epi32(32768);
+		for (; i + 8 <= count; i += 8)
+		{
+			// Same operations in the same order as FloatToUNORM16. packs_epi32 saturates to signed, so shift
+			// into [-32768, 32767] and back.
+			__m128 a = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(in + i), o), s), zero), one);
+			__m128 b = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(in + i + 4), o), s), zero), one);
+			__m128i ia = _mm_sub_epi32(RoundHalfUp(_mm_mul_ps(a, range)), bias);
+			__m128i ib = _mm_sub_epi32(RoundHalfUp(_mm_mul_ps(b, range)), bias);
+			__m128i packed = _mm_xor_si128(_mm_packs_epi32(ia, ib), _mm_set1_epi16(static_cast<short>(0x8000)));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), packed);
+		}
+
+		for (; i < count; i++)
+		{
+			out[i] = FloatToUNORM16((in[i] - offset) * inverse);
+		}
+	}
+
+	inline void DecodeUNORM16(float* out, const uint16_t* in, const uint32_t& count, const float& offset, const float& scale)
+	{
+		for (uint32_t i = 0; i < count; i++)
+		{
+			out[i] = offset + UNORM16ToFloat(in[i]) * scale;
+		}
+	}
+
+	// Octahedral encoding of count unit vectors given as x, y, z streams. out receives interleaved x, y pairs.
+	inline void EncodeOctahedral(int16_t* out, const float* x, const float* y, const float* z, const uint32_t& count)
+	{
+		uint32_t i = 0;
+		__m128 signMask = _mm_set1_ps(-0.0f);
+		__m128 zero = _mm_setzero_ps();
+		__m128 one = _mm_set1_ps(1.0f);
+		__m128 minusOne = _mm_set1_ps(-1.0f);
+		__m128 range = _mm_set1_ps(32767.0f);
+		for (; i + 4 <= count; i += 4)
+		{
+			__m128 vx = _mm_loadu_ps(x + i);
+			__m128 vy = _mm_loadu_ps(y + i);
+			__m128 vz = _mm_loadu_ps(z + i);
+
+			__m128 l1 = _mm_add_ps(_mm_add_ps(_mm_andnot_ps(signMask, vx), _mm_andnot_ps(signMask, vy)), _mm_andnot_ps(signMask, vz));
+			__m128 valid = _mm_cmpgt_ps(l1, zero);
+			__m128 inverse = _mm_and_ps(_mm_div_ps(one, l1), valid);
+			__m128 ox = _mm_mul_ps(vx, inverse);
+			__m128 oy = _mm_mul_ps(vy, inverse);
+
+			// Fold: (1 - |o.yx|) carrying the sign of o.xy, where +0 and -0 both count as positive
+			__m128 sx = _mm_and_ps(_mm_cmplt_ps(ox, zero), signMask);
+			__m128 sy = _mm_and_ps(_mm_cmplt_ps(oy, zero), signMask);
+			__m128 fx = _mm_or_ps(_mm_sub_ps(one, _mm_andnot_ps(signMask, oy)), sx);
+			__m128 fy = _mm_or_ps(_mm_sub_ps(one, _mm_andnot_ps(signMask, ox)), sy);
+
+			__m128 lower = _mm_cmplt_ps(vz, zero);
+			ox = _mm_or_ps(_mm_and_ps(lower, fx), _mm_andnot_ps(lower, ox));
+			oy = _mm_or_ps(_mm_and_ps(lower, fy), _mm_andnot_ps(lower, oy));
+
+			// Clamped and rounded as FloatToSNORM16 does
+			ox = _mm_max_ps(minusOne, _mm_min_ps(one, ox));
+			oy = _mm_max_ps(minusOne, _mm_min_ps(one, oy));
+			__m128i ix = RoundHalfUp(_mm_mul_ps(ox, range));
+			__m128i iy = RoundHalfUp(_mm_mul_ps(oy, range));
+
+			// x0 y0 x1 y1 x2 y2 x3 y3
+			__m128i packed = _mm_packs_epi32(_mm_unpacklo_epi32(ix, iy), _mm_unpackhi_epi32(ix, iy));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(out + i * 2), packed);
+		}
+
+		for (; i < count; i++)
+		{
+			EncodeOctahedral(out + i * 2, vec3f(x[i], y[i], z[i]));
+		}
+	}
+
+	// Inverse of the above; in is interleaved x, y pairs and the results are unit length.
+	inline void DecodeOctahedral(float* x, float* y, float* z, const int16_t* in, const uint32_t& count)
+	{
+		uint32_t i = 0;
+		__m128 signMask = _mm_set1_ps(-0.0f);
+		__m128 zero = _mm_setzero_ps();
+		__m128 one = _mm_set1_ps(1.0f);
+		__m128 minusOne = _mm_set1_ps(-1.0f);
+		__m128 range = _mm_set1_ps(1.0f / 32767.0f);
+		for (; i + 4 <= count; i += 4)
+		{
+			__m128i e = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i * 2));
+
+			// Sign extend the interleaved pairs: low halves are x, high halves are y
+			__m128i ex = _mm_srai_epi32(_mm_slli_epi32(e, 16), 16);
+			__m128i ey = _mm_srai_epi32(e, 16);
+
+			__m128 vx = _mm_max_ps(_mm_mul_ps(_mm_cvtepi32_ps(ex), range), minusOne);
+			__m128 vy = _mm_max_ps(_mm_mul_ps(_mm_cvtepi32_ps(ey), range), minusOne);
+			__m128 vz = _mm_sub_ps(_mm_sub_ps(one, _mm_andnot_ps(signMask, vx)), _mm_andnot_ps(signMask, vy));
+
+			// xy -= sign(xy) * max(-z, 0)
+			__m128 t = _mm_max_ps(_mm_sub_ps(zero, vz), zero);
+			vx = _mm_sub_ps(vx, _mm_or_ps(t, _mm_and_ps(vx, signMask)));
+			vy = _mm_sub_ps(vy, _mm_or_ps(t, _mm_and_ps(vy, signMask)));
+
+			__m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(vx, vx), _mm_mul_ps(vy, vy)), _mm_mul_ps(vz, vz)));
+			__m128 inverse = _mm_div_ps(one, length);
+
+			_mm_storeu_ps(x + i, _mm_mul_ps(vx, inverse));
+			_mm_storeu_ps(y + i, _mm_mul_ps(vy, inverse));
+			_mm_storeu_ps(z + i, _mm_mul_ps(vz, inverse));
+		}
+
+		for (; i < count; i++)
+		{
+			vec3f v = DecodeOctahedral(in + i * 2);
+			x[i] = v.x;
+			y[i] = v.y;
+			z[i] = v.z;
+		}
+	}
+
+#pragma endregion
+
+#pragma region Import
+
+	template<class Vertex>
+	inline VertexQuantizationBounds GetQuantizationBounds(const Vertex* vertices, const uint32_t& count)
+	{
+		vec3f minimum = { FLT_MAX, FLT_MAX, FLT_MAX };
+		vec3f maximum = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+		for (uint32_t i = 0; i < count; i++)
+		{
+			const vec3f& p = vertices[i].Position;
+			minimum = { (std::min)(minimum.x, p.x), (std::min)(minimum.y, p.y), (std::min)(minimum.z, p.z) };
+			maximum = { (std::max)(maximum.x, p.x), (std::max)(maximum.y, p.y), (std::max)(maximum.z, p.z) };
+		}
+
+		VertexQuantizationBounds bounds;
+		bounds.offset = (count > 0) ? minimum : vec3f(0.0f, 0.0f, 0.0f);
+		bounds.scale = (count > 0) ? vec3f(maximum.x - minimum.x, maximum.y - minimum.y, maximum.z - minimum.z) : vec3f(0.0f, 0.0f, 0.0f);
+
+		return bounds;
+	}
+
+	// Object to world for UNORM16 positions: pre multiply the world matrix with this (row vector convention).
+	inline mat4f GetDequantizationMatrix(const VertexQuantizationBounds& bounds)
+	{
+		return mat4f::scale(bounds.scale) * mat4f::translate(bounds.offset);
+	}
+
+	// Block of attributes gathered into streams so the kernels can run on them.
+	struct QuantizationBlock
+	{
+		float		x[RIG_QUANTIZE_BLOCK_SIZE];
+		float		y[RIG_QUANTIZE_BLOCK_SIZE];
+		float		z[RIG_QUANTIZE_BLOCK_SIZE];
+		uint16_t	qx[RIG_QUANTIZE_BLOCK_SIZE];
+		uint16_t	qy[RIG_QUANTIZE_BLOCK_SIZE];
+		uint16_t	qz[RIG_QUANTIZE_BLOCK_SIZE];
+		int16_t		octahedral[RIG_QUANTIZE_BLOCK_SIZE * 2];
+	};
+
+	template<class Vertex>
+	inline void QuantizePositionBlock(QuantizationBlock& block, const Vertex* vertices, const uint32_t& count, const VertexQuantizationBounds* bounds)
+	{
+		for (uint32_t i = 0; i < count; i++)
+		{
+			block.x[i] = vertices[i].Position.x;
+			block.y[i] = vertices[i].Position.y;
+			block.z[i] = vertices[i].Position.z;
+		}
+
+		if (bounds)
+		{
+			EncodeUNORM16(block.qx, block.x, count, bounds->offset.x, bounds->scale.x);
+			EncodeUNORM16(block.qy, block.y, count, bounds->offset.y, bounds->scale.y);
+			EncodeUNORM16(block.qz, block.z, count, bounds->offset.z, bounds->scale.z);
+		}
+		else
+		{
+			EncodeHalf(block.qx, block.x, count);
+			EncodeHalf(block.qy, block.y, count);
+			EncodeHalf(block.qz, block.z, count);
+		}
+	}
+
+	template<class Vertex>
+	inline void QuantizeUVBlock(QuantizationBlock& block, const Vertex* vertices, const uint32_t& count)
+	{
+		for (uint32_t i = 0; i < count; i++)
+		{
+			block.x[i] = vertices[i].UV.x;
+			block.y[i] = vertices[i].UV.y;
+		}
+
+		EncodeHalf(block.qx, block.x, count);
+		EncodeHalf(block.qy, block.y, count);
+	}
+
+	template<class Attribute>
+	inline void QuantizeDirectionBlock(QuantizationBlock& block, const Attribute* attributes, const uint32_t& stride, const uint32_t& count)
+	{
+		const uint8_t* bytes = reinterpret_cast<const uint8_t*>(attributes);
+		for (uint32_t i = 0; i < count; i++)
+		{
+			const Attribute& a = *reinterpret_cast<const Attribute*>(bytes + i * stride);
+			block.x[i] = a.x;
+			block.y[i] = a.y;
+			block.z[i] = a.z;
+		}
+
+		EncodeOctahedral(block.octahedral, block.x, block.y, block.z, count);
+	}
+
+	// Vertex {Position: vec3f, Normal: vec3f, UV: vec2f}. bounds selects UNORM16 positions, nullptr half floats.
+	template<class Vertex>
+	void QuantizeVertices(QuantizedVertex3* out, const Vertex* vertices, const uint32_t& count, const VertexQuantizationBounds* bounds = nullptr)
+	{
+		QuantizationBlock block;
+		uint16_t w = bounds ? 0xffff : FloatToHalf(1.0f);
+
+		for (uint32_t first = 0; first < count; first += RIG_QUANTIZE_BLOCK_SIZE)
+		{
+			uint32_t n = (std::min)(count - first, static_cast<uint32_t>(RIG_QUANTIZE_BLOCK_SIZE));
+			const Vertex* in = vertices + first;
+			QuantizedVertex3* q = out + first;
+
+			QuantizePositionBlock(block, in, n, bounds);
+			for (uint32_t i = 0; i < n; i++)
+			{
+				q[i].Position[0] = block.qx[i];
+				q[i].Position[1] = block.qy[i];
+				q[i].Position[2] = block.qz[i];
+				q[i].Position[3] = w;
+			}
+
+			QuantizeUVBlock(block, in, n);
+			for (uint32_t i = 0; i < n; i++)
+			{
+				q[i].UV[0] = block.qx[i];
+				q[i].UV[1] = block.qy[i];
+			}
+
+			QuantizeDirectionBlock(block, &in->Normal, sizeof(Vertex), n);
+			for (uint32_t i = 0; i < n; i++)
+			{
+				q[i].Normal[0] = block.octahedral[i * 2];
+				q[i].Normal[1] = block.octahedral[i * 2 + 1];
+			}
+		}
+	}
+
+	// Vertex {Position: vec3f, Normal: vec3f, UV: vec2f, Tangent: vec4f} with the bitangent sign in Tangent.w.
+	template<class Vertex>
+	void QuantizeVertices(QuantizedTangentVertex* out, const Vertex* vertices, const uint32_t& count, const VertexQuantizationBounds* bounds = nullptr)
+	{
+		QuantizationBlock block;
+		uint16_t positive = bounds ? 0xffff : FloatToHalf(1.0f);
+		uint16_t negative = bounds ? 0x0000 : FloatToHalf(-1.0f);
+
+		for (uint32_t first = 0; first < count; first += RIG_QUANTIZE_BLOCK_SIZE)
+		{
+			uint32_t n = (std::min)(count - first, static_cast<uint32_t>(RIG_QUANTIZE_BLOCK_SIZE));
+			const Vertex* in = vertices + first;
+			QuantizedTangentVertex* q = out + first;
+
+			QuantizePositionBlock(block, in, n, bounds);
+			for (uint32_t i = 0; i < n; i++)
+			{
+				q[i].Position[0] = block.qx[i];
+				q[i].Position[1] = block.qy[i];
+				q[i].Position[2] = block.qz[i];
+				q[i].Position[3] = (in[i].Tangent.w < 0.0f) ? negative : positive;
+			}
+
+			QuantizeUVBlock(block, in, n);
+			for (uint32_t i = 0; i < n; i++)
+			{
+				q[i].UV[0] = block.qx[i];
+				q[i].UV[1] = block.qy[i];
+			}
+
+			QuantizeDirectionBlock(block, &in->Normal, sizeof(Vertex), n);
+			for (uint32_t i = 0; i < n; i++)
+			{
+				q[i].Normal[0] = block.octahedral[i * 2];
+				q[i].Normal[1] = block.octahedral[i * 2 + 1];
+			}
+
+			QuantizeDirectionBlock(block, &in->Tangent, sizeof(Vertex), n);
+			for (uint32_t i = 0; i < n; i++)
+			{
+				q[i].Tangent[0] = block.octahedral[i * 2];
+				q[i].Tangent[1] = block.octahedral[i * 2 + 1];
+			}
+		}
+	}
+
+	// Largest position error of a quantized mesh against its source, in object space units.
+	template<class QuantizedVertex, class Vertex>
+	float GetQuantizationError(const QuantizedVertex* quantized, const Vertex* vertices, const uint32_t& count, const VertexQuantizationBounds* bounds = nullptr)
+	{
+		float error = 0.0f;
+		for (uint32_t i = 0; i < count; i++)
+		{
+			float p[3];
+			for (uint32_t c = 0; c < 3; c++)
+			{
+				p[c] = bounds ? (&bounds->offset.x)[c] + UNORM16ToFloat(quantized[i].Position[c]) * (&bounds->scale.x)[c] : HalfToFloat(quantized[i].Position[c]);
+			}
+
+			vec3f d = vec3f(p[0], p[1], p[2]) - vertices[i].Position;
+			error = (std::max)(error, cliqCity::graphicsMath::magnitude(d));
+		}
+
+		return error;
+	}
+
+#pragma endregion
+}
@@ -0,0 +1,146 @@
+#pragma once
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#define RIG_VERTEX_FETCH_CACHE_SIZE		16
+#define RIG_VERTEX_FETCH_LINE_SIZE		64
+#define RIG_VERTEX_FETCH_LINE_COUNT		64
+
+// Split vertex streams. A mesh keeps its positions in one buffer (slot 0) and every other attribute in a second
+// buffer (slot 1), so depth only passes bind and fetch just the positions. Vertex layouts stay plain structs; the
+// Position member is cut out of each vertex and the remaining bytes, in declaration order, form the attribute
+// stream. Input layouts put POSITION in slot 0 and the other elements in slot 1.
+namespace Rig3D
+{
+	struct VertexStreamLayout
+	{
+		uint32_t positionOffset;
+		uint32_t positionStride;
+		uint32_t attributeStride;
+	};
+
+	struct VertexFetchStatistics
+	{
+		uint32_t	transformedVertices;
+		uint64_t	interleavedDepthBytes;		// Depth pass over the interleaved buffer
+		uint64_t	splitDepthBytes;			// Depth pass over the position stream
+		uint64_t	interleavedShadingBytes;	// Full pass over the interleaved buffer
+		uint64_t	splitShadingBytes;			// Full pass over both streams
+	};
+
+	template<class Vertex>
+	inline VertexStreamLayout GetVertexStreamLayout()
+	{
+		VertexStreamLayout layout;
+		layout.positionOffset = static_cast<uint32_t>(offsetof(Vertex, Position));
+		layout.positionStride = static_cast<uint32_t>(sizeof(static_cast<Vertex*>(nullptr)->Position));
+		layout.attributeStride = static_cast<uint32_t>(sizeof(Vertex)) - layout.positionStride;
+		return layout;
+	}
+
+	// De-interleaves count vertices into positions (positionStride bytes each) and attributes (attributeStride
+	// bytes each).
+	template<class Vertex>
+	inline void SplitVertexStreams(void* positions, void* attributes, const Vertex* vertices, const uint32_t& count)
+	{
+		VertexStreamLayout layout = GetVertexStreamLayout<Vertex>();
+		uint32_t tail = static_cast<uint32_t>(sizeof(Vertex)) - layout.positionOffset - layout.positionStride;
+
+		uint8_t* p = static_cast<uint8_t*>(positions);
+		uint8_t* a = static_cast<uint8_t*>(attributes);
+		for (uint32_t i = 0; i < count; i++)
+		{
+			const uint8_t* v = reinterpret_cast<const uint8_t*>(vertices + i);
+			memcpy(p, v + layout.positionOffset, layout.positionStride);
+			memcpy(a, v, layout.positionOffset);
+			memcpy(a + layout.positionOffset, v + layout.positionOffset + layout.positionStride, tail);
+
+			p += layout.positionStride;
+			a += layout.attributeStride;
+		}
+	}
+
+	template<class Vertex>
+	inline void SplitVertexStreams(std::vector<uint8_t>& positions, std::vector<uint8_t>& attributes, const std::vector<Vertex>& vertices)
+	{
+		VertexStreamLayout layout = GetVertexStreamLayout<Vertex>();
+		uint32_t count = static_cast<uint32_t>(vertices.size());
+
+		positions.resize(static_cast<size_t>(count) * layout.positionStride);
+		attributes.resize(static_cast<size_t>(count) * layout.attributeStride);
+
+		if (count > 0)
+		{
+			SplitVertexStreams(&positions[0], &attributes[0], &vertices[0], count);
+		}
+	}
+
+	// Memory traffic of one pass over a buffer: vertices missing the post transform cache are fetched and every
+	// cache line their bytes span is read unless a small FIFO line cache still holds it. Returns bytes read.
+	template<class Index>
+	inline uint64_t GetVertexFetchBytes(const Index* indices, const uint32_t& indexCount, const uint32_t& vertexCount, const uint32_t& stride, uint32_t* transformedVertices = nullptr)
+	{
+		if (stride == 0)
+		{
+			return 0;
+		}
+
+		uint32_t lineCount = static_cast<uint32_t>((static_cast<uint64_t>(vertexCount) * stride + RIG_VERTEX_FETCH_LINE_SIZE - 1) / RIG_VERTEX_FETCH_LINE_SIZE);
+		std::vector<uint32_t> vertexTimes(vertexCount, 0);
+		std::vector<uint32_t> lineTimes(lineCount, 0);
+		uint32_t vertexTime = RIG_VERTEX_FETCH_CACHE_SIZE + 1;
+		uint32_t lineTime = RIG_VERTEX_FETCH_LINE_COUNT + 1;
+		uint32_t transformed = 0;
+		uint64_t lines = 0;
+
+		for (uint32_t i = 0; i < indexCount; i++)
+		{
+			uint32_t v = static_cast<uint32_t>(indices[i]);
+			if (vertexTime - vertexTimes[v] <= RIG_VERTEX_FETCH_CACHE_SIZE)
+			{
+				continue;
+			}
+
+			vertexTimes[v] = vertexTime++;
+			transformed++;
+
+			uint64_t start = static_cast<uint64_t>(v) * stride;
+			uint32_t first = static_cast<uint32_t>(start / RIG_VERTEX_FETCH_LINE_SIZE);
+			uint32_t last = static_cast<uint32_t>((start + stride - 1) / RIG_VERTEX_FETCH_LINE_SIZE);
+			for (uint32_t l = first; l <= last; l++)
+			{
+				if (lineTime - lineTimes[l] > RIG_VERTEX_FETCH_LINE_COUNT)
+				{
+					lineTimes[l] = lineTime++;
+					lines++;
+				}
+			}
+		}
+
+		if (transformedVertices)
+		{
+			*transformedVertices = transformed;
+		}
+
+		return lines * RIG_VERTEX_FETCH_LINE_SIZE;
+	}
+
+	// Bytes fetched per pass for the interleaved and the split layout of the same index buffer.
+	template<class Index>
+	inline VertexFetchStatistics GetVertexFetchStatistics(const Index* indices, const uint32_t& indexCount, const uint32_t& vertexCount, const VertexStreamLayout& layout)
+	{
+		VertexFetchStatistics statistics;
+		uint64_t interleaved = GetVertexFetchBytes(indices, indexCount, vertexCount, layout.positionStride + layout.attributeStride, &statistics.transformedVertices);
+		uint64_t positions = GetVertexFetchBytes(indices, indexCount, vertexCount, layout.positionStride);
+		uint64_t attributes = GetVertexFetchBytes(indices, indexCount, vertexCount, layout.attributeStride);
+
+		statistics.interleavedDepthBytes = interleaved;
+		statistics.splitDepthBytes = positions;
+		statistics.interleavedShadingBytes = interleaved;
+		statistics.splitShadingBytes = positions + attributes;
+
+		return statistics;
+	}
+}
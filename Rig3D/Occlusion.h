@@ -0,0 +1,507 @@
+#pragma once
+#include "GraphicsMath/cgm.h"
+#include "Rig3D/Parametric.h"
+#include "Rig3D/TaskDispatch/TaskDispatcher.h"
+#include <vector>
+#include <algorithm>
+#include <emmintrin.h>
+#include <float.h>
+#include <math.h>
+
+#define RIG_OCCLUSION_TILE_WIDTH	32
+#define RIG_OCCLUSION_TILE_HEIGHT	8
+#define RIG_OCCLUSION_TILE_SIZE		(RIG_OCCLUSION_TILE_WIDTH * RIG_OCCLUSION_TILE_HEIGHT)
+#define RIG_OCCLUSION_MIN_AREA		1e-6f
+
+// Software occlusion culling. Occluders are rasterized on the CPU into a low resolution depth buffer stored
+// tile by tile, with a conservative (farthest) depth kept per tile. Occludees are tested against the tile
+// depths first and only fall through to individual pixels where the tile test is inconclusive.
+// Depth follows the D3D convention: z / w in [0, 1], smaller is closer, cleared to 1.
+namespace Rig3D
+{
+	struct OccluderMesh
+	{
+		std::vector<vec3f>		positions;
+		std::vector<uint32_t>	indices;
+		AABB<vec3f>				bounds;
+	};
+
+	// Screen space triangle ready for rasterization. Edge functions are positive inside and depth is
+	// the plane z = depth[0] * x + depth[1] * y + depth[2].
+	struct OcclusionTriangle
+	{
+		float	edges[3][3];
+		float	depth[3];
+		int32_t	minX, minY, maxX, maxY;
+	};
+
+	struct OcclusionStatistics
+	{
+		uint32_t occluderTriangles;		// Triangles submitted
+		uint32_t binnedTriangles;		// Triangles that survived clipping and were binned
+		uint32_t tested;				// Occludees tested
+		uint32_t occluded;				// Occludees rejected
+
+		OcclusionStatistics() : occluderTriangles(0), binnedTriangles(0), tested(0), occluded(0) {};
+
+		inline void Reset() { occluderTriangles = binnedTriangles = tested = occluded = 0; };
+	};
+
+	struct OcclusionBuffer
+	{
+		std::vector<float>					depth;			// Tile major, RIG_OCCLUSION_TILE_SIZE floats per tile
+		std::vector<float>					tileMaxDepth;
+		std::vector<OcclusionTriangle>		triangles;
+		std::vector<std::vector<uint32_t>>	bins;
+		std::vector<vec4f>					clipPositions;	// Scratch for AddOccluder
+		uint32_t							width;
+		uint32_t							height;
+		uint32_t							tilesX;
+		uint32_t							tilesY;
+
+		OcclusionBuffer() : width(0), height(0), tilesX(0), tilesY(0) {};
+	};
+
+#pragma region Setup
+
+	// Dimensions are rounded up to whole tiles.
+	inline void InitializeOcclusionBuffer(OcclusionBuffer& buffer, const uint32_t& width, const uint32_t& height)
+	{
+		buffer.tilesX = (width + RIG_OCCLUSION_TILE_WIDTH - 1) / RIG_OCCLUSION_TILE_WIDTH;
+		buffer.tilesY = (height + RIG_OCCLUSION_TILE_HEIGHT - 1) / RIG_OCCLUSION_TILE_HEIGHT;
+		buffer.width = buffer.tilesX * RIG_OCCLUSION_TILE_WIDTH;
+		buffer.height = buffer.tilesY * RIG_OCCLUSION_TILE_HEIGHT;
+
+		uint32_t tileCount = buffer.tilesX * buffer.tilesY;
+		buffer.depth.resize(tileCount * RIG_OCCLUSION_TILE_SIZE);
+		buffer.tileMaxDepth.resize(tileCount);
+		buffer.bins.resize(tileCount);
+	}
+
+	inline void ClearOcclusionBuffer(OcclusionBuffer& buffer)
+	{
+		std::fill(buffer.depth.begin(), buffer.depth.end(), 1.0f);
+		std::fill(buffer.tileMaxDepth.begin(), buffer.tileMaxDepth.end(), 1.0f);
+
+		buffer.triangles.clear();
+		for (std::vector<uint32_t>& bin : buffer.bins)
+		{
+			bin.clear();
+		}
+	}
+
+	template<class Vertex, class Index>
+	void InitializeOccluderMesh(OccluderMesh& occluder, const Vertex* vertices, const uint32_t& vertexCount, const Index* indices, const uint32_t& indexCount)
+	{
+		occluder.positions.resize(vertexCount);
+		occluder.indices.resize(indexCount);
+
+		vec3f minimum = vertices[0].Position;
+		vec3f maximum = vertices[0].Position;
+		for (uint32_t i = 0; i < vertexCount; i++)
+		{
+			occluder.positions[i] = vertices[i].Position;
+			for (int e = 0; e < 3; e++)
+			{
+				minimum[e] = min(minimum[e], vertices[i].Position[e]);
+				maximum[e] = max(maximum[e], vertices[i].Position[e]);
+			}
+		}
+
+		for (uint32_t i = 0; i < indexCount; i++)
+		{
+			occluder.indices[i] = static_cast<uint32_t>(indices[i]);
+		}
+
+		occluder.bounds.origin = (minimum + maximum) * 0.5f;
+		occluder.bounds.halfSize = (maximum - minimum) * 0.5f;
+	}
+
+	// Row vector transform to homogeneous clip space.
+	inline vec4f TransformToClip(const vec3f& p, const mat4f& m)
+	{
+		return
+		{
+			p.x * m[0][0] + p.y * m[1][0] + p.z * m[2][0] + m[3][0],
+			p.x * m[0][1] + p.y * m[1][1] + p.z * m[2][1] + m[3][1],
+			p.x * m[0][2] + p.y * m[1][2] + p.z * m[2][2] + m[3][2],
+			p.x * m[0][3] + p.y * m[1][3] + p.z * m[2][3] + m[3][3]
+		};
+	}
+
+#pragma endregion
+
+#pragma region Occluder Rasterization
+
+	inline void BinOcclusionTriangle(OcclusionBuffer& buffer, const vec4f& c0, const vec4f& c1, const vec4f& c2, OcclusionStatistics* statistics)
+	{
+		const vec4f* clip[3] = { &c0, &c1, &c2 };
+
+		float x[3], y[3], z[3];
+		for (int i = 0; i < 3; i++)
+		{
+			float inverseW = 1.0f / clip[i]->w;
+			x[i] = (clip[i]->x * inverseW * 0.5f + 0.5f) * buffer.width;
+			y[i] = (0.5f - clip[i]->y * inverseW * 0.5f) * buffer.height;
+			z[i] = clip[i]->z * inverseW;
+		}
+
+		float area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+		if (fabsf(area) < RIG_OCCLUSION_MIN_AREA)
+		{
+			return;
+		}
+
+		// Both windings are rasterized; the depth test resolves front and back faces.
+		OcclusionTriangle triangle;
+		triangle.minX = max(0, static_cast<int32_t>(floorf(min(x[0], min(x[1], x[2])))));
+		triangle.minY = max(0, static_cast<int32_t>(floorf(min(y[0], min(y[1], y[2])))));
+		triangle.maxX = min(static_cast<int32_t>(buffer.width) - 1, static_cast<int32_t>(floorf(max(x[0], max(x[1], x[2])))));
+		triangle.maxY = min(static_cast<int32_t>(buffer.height) - 1, static_cast<int32_t>(floorf(max(y[0], max(y[1], y[2])))));
+
+		if (triangle.minX > triangle.maxX || triangle.minY > triangle.maxY)
+		{
+			return;
+		}
+
+		float sign = (area > 0.0f) ? 1.0f : -1.0f;
+		for (int i = 0; i < 3; i++)
+		{
+			int a = i;
+			int b = (i + 1) % 3;
+			triangle.edges[i][0] = sign * (y[a] - y[b]);
+			triangle.edges[i][1] = sign * (x[b] - x[a]);
+			triangle.edges[i][2] = sign * (x[a] * y[b] - x[b] * y[a]);
+		}
+
+		float inverseArea = 1.0f / area;
+		float dz1 = z[1] - z[0];
+		float dz2 = z[2] - z[0];
+		triangle.depth[0] = (dz1 * (y[2] - y[0]) - dz2 * (y[1] - y[0])) * inverseArea;
+		triangle.depth[1] = (dz2 * (x[1] - x[0]) - dz1 * (x[2] - x[0])) * inverseArea;
+		triangle.depth[2] = z[0] - triangle.depth[0] * x[0] - triangle.depth[1] * y[0];
+
+		uint32_t triangleIndex = static_cast<uint32_t>(buffer.triangles.size());
+		buffer.triangles.push_back(triangle);
+
+		uint32_t tileMinX = triangle.minX / RIG_OCCLUSION_TILE_WIDTH;
+		uint32_t tileMaxX = triangle.maxX / RIG_OCCLUSION_TILE_WIDTH;
+		uint32_t tileMinY = triangle.minY / RIG_OCCLUSION_TILE_HEIGHT;
+		uint32_t tileMaxY = triangle.maxY / RIG_OCCLUSION_TILE_HEIGHT;
+
+		for (uint32_t ty = tileMinY; ty <= tileMaxY; ty++)
+		{
+			for (uint32_t tx = tileMinX; tx <= tileMaxX; tx++)
+			{
+				buffer.bins[ty * buffer.tilesX + tx].push_back(triangleIndex);
+			}
+		}
+
+		if (statistics)
+		{
+			statistics->binnedTriangles++;
+		}
+	}
+
+	// Transforms, clips against the near plane (z >= 0) and bins the occluder's triangles into tiles.
+	// Nothing is rasterized until RasterizeOccluders.
+	inline void AddOccluder(OcclusionBuffer& buffer, const OccluderMesh& occluder, const mat4f& worldViewProjection, OcclusionStatistics* statistics = nullptr)
+	{
+		uint32_t vertexCount = static_cast<uint32_t>(occluder.positions.size());
+		buffer.clipPositions.resize(vertexCount);
+		for (uint32_t i = 0; i < vertexCount; i++)
+		{
+			buffer.clipPositions[i] = TransformToClip(occluder.positions[i], worldViewProjection);
+		}
+
+		uint32_t indexCount = static_cast<uint32_t>(occluder.indices.size());
+		for (uint32_t i = 0; i + 2 < indexCount; i += 3)
+		{
+			const vec4f* input[3] =
+			{
+				&buffer.clipPositions[occluder.indices[i]],
+				&buffer.clipPositions[occluder.indices[i + 1]],
+				&buffer.clipPositions[occluder.indices[i + 2]]
+			};
+
+			if (statistics)
+			{
+				statistics->occluderTriangles++;
+			}
+
+			if (input[0]->z >= 0.0f && input[1]->z >= 0.0f && input[2]->z >= 0.0f)
+			{
+				BinOcclusionTriangle(buffer, *input[0], *input[1], *input[2], statistics);
+				continue;
+			}
+
+			// Sutherland-Hodgman against the near plane. A triangle clips to at most a quad.
+			vec4f clipped[4];
+			uint32_t clippedCount = 0;
+			for (uint32_t e = 0; e < 3; e++)
+			{
+				const vec4f& a = *input[e];
+				const vec4f& b = *input[(e + 1) % 3];
+
+				if (a.z >= 0.0f)
+				{
+					clipped[clippedCount++] = a;
+				}
+
+				if ((a.z >= 0.0f) != (b.z >= 0.0f))
+				{
+					float t = a.z / (a.z - b.z);
+					clipped[clippedCount++] =
+					{
+						a.x + (b.x - a.x) * t,
+						a.y + (b.y - a.y) * t,
+						0.0f,
+						a.w + (b.w - a.w) * t
+					};
+				}
+			}
+
+			for (uint32_t v = 2; v < clippedCount; v++)
+			{
+				if (clipped[0].w > 0.0f && clipped[v - 1].w > 0.0f && clipped[v].w > 0.0f)
+				{
+					BinOcclusionTriangle(buffer, clipped[0], clipped[v - 1], clipped[v], statistics);
+				}
+			}
+		}
+	}
+
+	// Rasterizes every triangle binned to the tile, four pixels at a time, keeping the nearest depth.
+	// Tiles share no pixels so different tiles can be rasterized concurrently.
+	inline void RasterizeOcclusionTile(OcclusionBuffer& buffer, const uint32_t& tileIndex)
+	{
+		const int32_t tileX0 = (tileIndex % buffer.tilesX) * RIG_OCCLUSION_TILE_WIDTH;
+		const int32_t tileY0 = (tileIndex / buffer.tilesX) * RIG_OCCLUSION_TILE_HEIGHT;
+		const int32_t tileX1 = tileX0 + RIG_OCCLUSION_TILE_WIDTH - 1;
+		const int32_t tileY1 = tileY0 + RIG_OCCLUSION_TILE_HEIGHT - 1;
+
+		float* tileDepth = &buffer.depth[tileIndex * RIG_OCCLUSION_TILE_SIZE];
+		const std::vector<uint32_t>& bin = buffer.bins[tileIndex];
+
+		const __m128 zero = _mm_setzero_ps();
+		const __m128 pixelOffsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+
+		for (uint32_t t = 0; t < bin.size(); t++)
+		{
+			const OcclusionTriangle& triangle = buffer.triangles[bin[t]];
+
+			int32_t x0 = max(triangle.minX, tileX0);
+			int32_t x1 = min(triangle.maxX, tileX1);
+			int32_t y0 = max(triangle.minY, tileY0);
+			int32_t y1 = min(triangle.maxY, tileY1);
+
+			// Align to 4 pixel groups relative to the tile. Extra lanes stay inside the tile and are still edge tested.
+			x0 = tileX0 + ((x0 - tileX0) & ~3);
+
+			const __m128 a0 = _mm_set1_ps(triangle.edges[0][0]);
+			const __m128 a1 = _mm_set1_ps(triangle.edges[1][0]);
+			const __m128 a2 = _mm_set1_ps(triangle.edges[2][0]);
+			const __m128 za = _mm_set1_ps(triangle.depth[0]);
+
+			for (int32_t y = y0; y <= y1; y++)
+			{
+				float py = static_cast<float>(y) + 0.5f;
+				const __m128 r0 = _mm_set1_ps(triangle.edges[0][1] * py + triangle.edges[0][2]);
+				const __m128 r1 = _mm_set1_ps(triangle.edges[1][1] * py + triangle.edges[1][2]);
+				const __m128 r2 = _mm_set1_ps(triangle.edges[2][1] * py + triangle.edges[2][2]);
+				const __m128 rz = _mm_set1_ps(triangle.depth[1] * py + triangle.depth[2]);
+
+				float* row = tileDepth + (y - tileY0) * RIG_OCCLUSION_TILE_WIDTH;
+				for (int32_t x = x0; x <= x1; x += 4)
+				{
+					__m128 px = _mm_add_ps(_mm_set1_ps(static_cast<float>(x)), pixelOffsets);
+
+					__m128 e0 = _mm_add_ps(_mm_mul_ps(a0, px), r0);
+					__m128 e1 = _mm_add_ps(_mm_mul_ps(a1, px), r1);
+					__m128 e2 = _mm_add_ps(_mm_mul_ps(a2, px), r2);
+
+					__m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(e0, zero), _mm_cmpge_ps(e1, zero)), _mm_cmpge_ps(e2, zero));
+					if (_mm_movemask_ps(inside) == 0)
+					{
+						continue;
+					}
+
+					float* pixels = row + (x - tileX0);
+					__m128 z = _mm_add_ps(_mm_mul_ps(za, px), rz);
+					__m128 previous = _mm_loadu_ps(pixels);
+					__m128 nearest = _mm_min_ps(previous, z);
+
+					_mm_storeu_ps(pixels, _mm_or_ps(_mm_and_ps(inside, nearest), _mm_andnot_ps(inside, previous)));
+				}
+			}
+		}
+
+		__m128 farthest = _mm_loadu_ps(tileDepth);
+		for (uint32_t i = 4; i < RIG_OCCLUSION_TILE_SIZE; i += 4)
+		{
+			farthest = _mm_max_ps(farthest, _mm_loadu_ps(tileDepth + i));
+		}
+
+		farthest = _mm_max_ps(farthest, _mm_shuffle_ps(farthest, farthest, _MM_SHUFFLE(1, 0, 3, 2)));
+		farthest = _mm_max_ps(farthest, _mm_shuffle_ps(farthest, farthest, _MM_SHUFFLE(2, 3, 0, 1)));
+		buffer.tileMaxDepth[tileIndex] = _mm_cvtss_f32(farthest);
+	}
+
+	inline void RasterizeOccluders(OcclusionBuffer& buffer)
+	{
+		uint32_t tileCount = buffer.tilesX * buffer.tilesY;
+		for (uint32_t i = 0; i < tileCount; i++)
+		{
+			RasterizeOcclusionTile(buffer, i);
+		}
+	}
+
+	struct OcclusionRasterRange
+	{
+		OcclusionBuffer*			buffer;
+		uint32_t					firstTile;
+		uint32_t					tileCount;
+		cliqCity::multicore::TaskID	taskID;
+	};
+
+	inline void PerformOcclusionRasterTask(const cliqCity::multicore::TaskData& data)
+	{
+		OcclusionRasterRange* range = reinterpret_cast<OcclusionRasterRange*>(data.mKernelData);
+		for (uint32_t i = 0; i < range->tileCount; i++)
+		{
+			RasterizeOcclusionTile(*range->buffer, range->firstTile + i);
+		}
+	}
+
+	// Splits the tiles across rangeCount tasks and waits for all of them. ranges is caller owned scratch
+	// memory with rangeCount elements.
+	inline void RasterizeOccludersParallel(cliqCity::multicore::TaskDispatcher& dispatcher, OcclusionBuffer& buffer, OcclusionRasterRange* ranges, const uint32_t& rangeCount)
+	{
+		uint32_t tileCount = buffer.tilesX * buffer.tilesY;
+		uint32_t rangeSize = (tileCount + rangeCount - 1) / rangeCount;
+
+		cliqCity::multicore::TaskData data;
+		uint32_t taskCount = 0;
+		for (uint32_t first = 0; first < tileCount; first += rangeSize, taskCount++)
+		{
+			OcclusionRasterRange& range = ranges[taskCount];
+			range.buffer = &buffer;
+			range.firstTile = first;
+			range.tileCount = min(rangeSize, tileCount - first);
+
+			data.mKernelData = &range;
+			range.taskID = dispatcher.AddTask(data, PerformOcclusionRasterTask);
+		}
+
+		for (uint32_t i = 0; i < taskCount; i++)
+		{
+			dispatcher.WaitForTask(ranges[i].taskID);
+		}
+	}
+
+#pragma endregion
+
+#pragma region Occludee Tests
+
+	// Returns true when the box is hidden behind rasterized occluders. Boxes crossing the near plane or
+	// lying outside the buffer are reported as not occluded; rejecting those is the frustum's job.
+	inline bool IsOccluded(const OcclusionBuffer& buffer, const AABB<vec3f>& bounds, const mat4f& worldViewProjection, OcclusionStatistics* statistics = nullptr)
+	{
+		if (statistics)
+		{
+			statistics->tested++;
+		}
+
+		float minX = FLT_MAX, minY = FLT_MAX, minZ = FLT_MAX;
+		float maxX = -FLT_MAX, maxY = -FLT_MAX;
+
+		for (int i = 0; i < 8; i++)
+		{
+			vec3f corner =
+			{
+				bounds.origin.x + ((i & 1) ? bounds.halfSize.x : -bounds.halfSize.x),
+				bounds.origin.y + ((i & 2) ? bounds.halfSize.y : -bounds.halfSize.y),
+				bounds.origin.z + ((i & 4) ? bounds.halfSize.z : -bounds.halfSize.z)
+			};
+
+			vec4f clip = TransformToClip(corner, worldViewProjection);
+			if (clip.z < 0.0f || clip.w <= 0.0f)
+			{
+				return false;
+			}
+
+			float inverseW = 1.0f / clip.w;
+			float x = (clip.x * inverseW * 0.5f + 0.5f) * buffer.width;
+			float y = (0.5f - clip.y * inverseW * 0.5f) * buffer.height;
+
+			minX = min(minX, x);
+			maxX = max(maxX, x);
+			minY = min(minY, y);
+			maxY = max(maxY, y);
+			minZ = min(minZ, clip.z * inverseW);
+		}
+
+		int32_t x0 = max(0, static_cast<int32_t>(floorf(minX)));
+		int32_t y0 = max(0, static_cast<int32_t>(floorf(minY)));
+		int32_t x1 = min(static_cast<int32_t>(buffer.width) - 1, static_cast<int32_t>(floorf(maxX)));
+		int32_t y1 = min(static_cast<int32_t>(buffer.height) - 1, static_cast<int32_t>(floorf(maxY)));
+
+		if (x0 > x1 || y0 > y1)
+		{
+			return false;
+		}
+
+		const __m128 nearest = _mm_set1_ps(minZ);
+		const __m128 laneOffsets = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+
+		for (int32_t ty = y0 / RIG_OCCLUSION_TILE_HEIGHT; ty <= y1 / RIG_OCCLUSION_TILE_HEIGHT; ty++)
+		{
+			for (int32_t tx = x0 / RIG_OCCLUSION_TILE_WIDTH; tx <= x1 / RIG_OCCLUSION_TILE_WIDTH; tx++)
+			{
+				uint32_t tileIndex = ty * buffer.tilesX + tx;
+
+				// Everything in this tile is in front of the box.
+				if (minZ > buffer.tileMaxDepth[tileIndex])
+				{
+					continue;
+				}
+
+				const int32_t tileX0 = tx * RIG_OCCLUSION_TILE_WIDTH;
+				const int32_t tileY0 = ty * RIG_OCCLUSION_TILE_HEIGHT;
+				const int32_t px0 = max(x0, tileX0);
+				const int32_t px1 = min(x1, tileX0 + RIG_OCCLUSION_TILE_WIDTH - 1);
+				const int32_t py0 = max(y0, tileY0);
+				const int32_t py1 = min(y1, tileY0 + RIG_OCCLUSION_TILE_HEIGHT - 1);
+
+				const __m128 rectMin = _mm_set1_ps(static_cast<float>(px0));
+				const __m128 rectMax = _mm_set1_ps(static_cast<float>(px1));
+				const float* tileDepth = &buffer.depth[tileIndex * RIG_OCCLUSION_TILE_SIZE];
+
+				for (int32_t y = py0; y <= py1; y++)
+				{
+					const float* row = tileDepth + (y - tileY0) * RIG_OCCLUSION_TILE_WIDTH;
+					for (int32_t x = tileX0 + ((px0 - tileX0) & ~3); x <= px1; x += 4)
+					{
+						__m128 lanes = _mm_add_ps(_mm_set1_ps(static_cast<float>(x)), laneOffsets);
+						__m128 inRect = _mm_and_ps(_mm_cmpge_ps(lanes, rectMin), _mm_cmple_ps(lanes, rectMax));
+						__m128 visible = _mm_and_ps(inRect, _mm_cmpge_ps(_mm_loadu_ps(row + (x - tileX0)), nearest));
+
+						if (_mm_movemask_ps(visible))
+						{
+							return false;
+						}
+					}
+				}
+			}
+		}
+
+		if (statistics)
+		{
+			statistics->occluded++;
+		}
+
+		return true;
+	}
+
+#pragma endregion
+}
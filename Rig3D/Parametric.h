@@ -24,6 +24,14 @@ namespace Rig3D
 		Vector halfSize;
 	};
 
+	template<class Vector>
+	struct OBB
+	{
+		Vector origin;
+		Vector halfSize;
+		Vector axes[3];
+	};
+
 	template<class Vector>
 	struct Sphere
 	{
@@ -41,5 +49,6 @@ namespace Rig3D
 
 typedef Rig3D::AABB<vec2f>		BoxCollider2D;
 typedef Rig3D::AABB<vec3f>		BoxCollider;
+typedef Rig3D::OBB<vec3f>		OrientedBoxCollider;
 typedef Rig3D::Sphere<vec2f>	CircleCollider;
 typedef Rig3D::Sphere<vec3f>	SphereCollider;
\ No newline at end of file
@@ -0,0 +1,99 @@
+#pragma once
+#include <atomic>
+#include <stdint.h>
+
+namespace cliqCity
+{
+	namespace multicore
+	{
+		// Bounded lock free queue (Vyukov's MPMC ring). Workers push finished work and the owning thread pops it, so
+		// results cross threads without taking a lock. Capacity must be a power of two. TryPush fails when full, so
+		// producers should bound the work in flight to Capacity.
+		template<class T, uint32_t Capacity>
+		class CompletionQueue
+		{
+			static_assert((Capacity & (Capacity - 1)) == 0, "CompletionQueue capacity must be a power of two");
+
+		public:
+			CompletionQueue() : mEnqueue(0), mDequeue(0)
+			{
+				for (uint32_t i = 0; i < Capacity; i++)
+				{
+					mCells[i].sequence.store(i, std::memory_order_relaxed);
+				}
+			}
+
+			bool TryPush(const T& value)
+			{
+				uint32_t position = mEnqueue.load(std::memory_order_relaxed);
+				for (;;)
+				{
+					Cell& cell = mCells[position & (Capacity - 1)];
+					uint32_t sequence = cell.sequence.load(std::memory_order_acquire);
+					int32_t difference = static_cast<int32_t>(sequence - position);
+					if (difference == 0)
+					{
+						if (mEnqueue.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+						{
+							cell.value = value;
+							cell.sequence.store(position + 1, std::memory_order_release);
+							return true;
+						}
+					}
+					else if (difference < 0)
+					{
+						return false;
+					}
+					else
+					{
+						position = mEnqueue.load(std::memory_order_relaxed);
+					}
+				}
+			}
+
+			bool TryPop(T& value)
+			{
+				uint32_t position = mDequeue.load(std::memory_order_relaxed);
+				for (;;)
+				{
+					Cell& cell = mCells[position & (Capacity - 1)];
+					uint32_t sequence = cell.sequence.load(std::memory_order_acquire);
+					int32_t difference = static_cast<int32_t>(sequence - (position + 1));
+					if (difference == 0)
+					{
+						if (mDequeue.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+						{
+							value = cell.value;
+							cell.sequence.store(position + Capacity, std::memory_order_release);
+							return true;
+						}
+					}
+					else if (difference < 0)
+					{
+						return false;
+					}
+					else
+					{
+						position = mDequeue.load(std::memory_order_relaxed);
+					}
+				}
+			}
+
+		private:
+			struct Cell
+			{
+				std::atomic<uint32_t>	sequence;
+				T						value;
+			};
+
+			// Producer and consumer counters sit on separate cache lines
+			Cell					mCells[Capacity];
+			std::atomic<uint32_t>	mEnqueue;
+			uint8_t					mPadding[64];
+			std::atomic<uint32_t>	mDequeue;
+
+			CompletionQueue(CompletionQueue const&) = delete;
+			void operator=(CompletionQueue const&) = delete;
+		};
+	}
+}
@@ -1,7 +1,15 @@
 #pragma once
 #include "GraphicsMath/cgm.h"
 #include "Rig3D/Parametric.h"
+#include "Rig3D/TaskDispatch/TaskDispatcher.h"
 #include <vector>
+#include <immintrin.h>
+#include <float.h>
+#include <string.h>
+
+#define RIG_CULL_SIMD_WIDTH 8
+#define RIG_CULL_PLANE_MASK_ALL 0x3F
+#define RIG_CULL_MAX_VIEWS 32
 
 namespace Rig3D
 {
@@ -10,6 +18,26 @@ namespace Rig3D
 		Plane<vec3f> front, back, left, right, bottom, top;
 	};
 
+	enum CullResult
+	{
+		CULL_RESULT_OUTSIDE,
+		CULL_RESULT_INTERSECT,
+		CULL_RESULT_INSIDE
+	};
+
+	// Per frame counters. Reset once per frame and pass to every box test.
+	struct CullStatistics
+	{
+		uint32_t tested;			// Volumes tested
+		uint32_t culled;			// Volumes rejected
+		uint32_t inside;			// Volumes fully inside every plane, whether tested or passed an empty plane mask
+		uint32_t planeTests;		// Individual volume - plane tests performed
+
+		CullStatistics() : tested(0), culled(0), inside(0), planeTests(0) {};
+
+		inline void Reset() { tested = culled = inside = planeTests = 0; };
+	};
+
 	inline void ExtractNormalizedFrustumLH(Frustum* frustum, mat4f& viewProjectionMatrix)
 	{
 		float distance, magnitude;
@@ -146,4 +174,607 @@ namespace Rig3D
 			}
 		}
 	}
+
+#pragma region SoA Sphere Culling
+
+	// Structure of arrays sphere layout for the SIMD kernels. Each array must be 32 byte aligned and
+	// padded with valid (ignored) values up to a multiple of RIG_CULL_SIMD_WIDTH.
+	struct SphereSoA
+	{
+		float*		x;
+		float*		y;
+		float*		z;
+		float*		radius;
+		uint32_t	count;
+	};
+
+	// Callers allocate the output index buffer with this many entries. Survivors are written with full 
+	// vector stores, so the tail of the last block may be overwritten.
+	inline uint32_t GetCullPaddedCount(const uint32_t& count)
+	{
+		return (count + (RIG_CULL_SIMD_WIDTH - 1)) & ~(RIG_CULL_SIMD_WIDTH - 1);
+	}
+
+	inline void ConvertSpheresToSoA(SphereSoA& soa, const Sphere<vec3f>* spheres, const uint32_t& count)
+	{
+		for (uint32_t i = 0; i < count; i++)
+		{
+			soa.x[i] = spheres[i].origin.x;
+			soa.y[i] = spheres[i].origin.y;
+			soa.z[i] = spheres[i].origin.z;
+			soa.radius[i] = spheres[i].radius;
+		}
+
+		// Padding spheres are pushed behind every plane so they never survive.
+		for (uint32_t i = count; i < GetCullPaddedCount(count); i++)
+		{
+			soa.x[i] = soa.y[i] = soa.z[i] = 0.0f;
+			soa.radius[i] = -FLT_MAX;
+		}
+
+		soa.count = count;
+	}
+
+#if defined(__AVX2__)
+
+	// Permutation that moves the set lanes of an 8 bit mask to the front, i.e. an emulated compress store.
+	struct CullCompactionTable
+	{
+		__m256i permutations[256];
+
+		CullCompactionTable()
+		{
+			for (uint32_t mask = 0; mask < 256; mask++)
+			{
+				int32_t lanes[8] = { 0, 0, 0, 0, 0, 0, 0, 0 };
+				int32_t count = 0;
+				for (int32_t lane = 0; lane < 8; lane++)
+				{
+					if (mask & (1 << lane))
+					{
+						lanes[count++] = lane;
+					}
+				}
+
+				permutations[mask] = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(lanes));
+			}
+		}
+
+		static const CullCompactionTable& SharedInstance()
+		{
+			static CullCompactionTable sharedInstance;
+			return sharedInstance;
+		}
+	};
+
+#endif
+
+	// Branch free test of spheres [first, first + count) against all six planes. Surviving sphere indices
+	// are compacted into indices[0..n) and n is returned. first and count must be multiples of RIG_CULL_SIMD_WIDTH.
+	inline uint32_t CullSoA(const Frustum& frustum, const SphereSoA& spheres, uint32_t* indices, const uint32_t& first, const uint32_t& count)
+	{
+		const Plane<vec3f>* planes[6] =
+		{
+			&frustum.front,
+			&frustum.back,
+			&frustum.left,
+			&frustum.right,
+			&frustum.bottom,
+			&frustum.top,
+		};
+
+		uint32_t survivorCount = 0;
+		uint32_t end = first + count;
+
+#if defined(__AVX2__)
+		const CullCompactionTable& table = CullCompactionTable::SharedInstance();
+
+		__m256 nx[6], ny[6], nz[6], nd[6];
+		for (uint32_t p = 0; p < 6; p++)
+		{
+			nx[p] = _mm256_set1_ps(planes[p]->normal.x);
+			ny[p] = _mm256_set1_ps(planes[p]->normal.y);
+			nz[p] = _mm256_set1_ps(planes[p]->normal.z);
+			nd[p] = _mm256_set1_ps(planes[p]->distance);
+		}
+
+		__m256i laneIndices = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+		__m256 zero = _mm256_setzero_ps();
+
+		for (uint32_t i = first; i < end; i += 8)
+		{
+			__m256 x = _mm256_load_ps(spheres.x + i);
+			__m256 y = _mm256_load_ps(spheres.y + i);
+			__m256 z = _mm256_load_ps(spheres.z + i);
+			__m256 r = _mm256_load_ps(spheres.radius + i);
+
+			// Track the minimum signed distance over all planes; the sphere survives if it is non negative.
+			__m256 minimum = _mm256_set1_ps(FLT_MAX);
+			for (uint32_t p = 0; p < 6; p++)
+			{
+				__m256 distance = _mm256_fmadd_ps(nx[p], x, _mm256_fmadd_ps(ny[p], y, _mm256_fmadd_ps(nz[p], z, _mm256_sub_ps(r, nd[p]))));
+				minimum = _mm256_min_ps(minimum, distance);
+			}
+
+			int mask = _mm256_movemask_ps(_mm256_cmp_ps(minimum, zero, _CMP_GE_OQ));
+
+			__m256i sphereIndices = _mm256_add_epi32(_mm256_set1_epi32(static_cast<int>(i)), laneIndices);
+			__m256i compacted = _mm256_permutevar8x32_epi32(sphereIndices, table.permutations[mask]);
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(indices + survivorCount), compacted);
+
+			survivorCount += _mm_popcnt_u32(static_cast<uint32_t>(mask));
+		}
+#else
+		__m128 nx[6], ny[6], nz[6], nd[6];
+		for (uint32_t p = 0; p < 6; p++)
+		{
+			nx[p] = _mm_set1_ps(planes[p]->normal.x);
+			ny[p] = _mm_set1_ps(planes[p]->normal.y);
+			nz[p] = _mm_set1_ps(planes[p]->normal.z);
+			nd[p] = _mm_set1_ps(planes[p]->distance);
+		}
+
+		__m128 zero = _mm_setzero_ps();
+
+		for (uint32_t i = first; i < end; i += 4)
+		{
+			__m128 x = _mm_load_ps(spheres.x + i);
+			__m128 y = _mm_load_ps(spheres.y + i);
+			__m128 z = _mm_load_ps(spheres.z + i);
+			__m128 r = _mm_load_ps(spheres.radius + i);
+
+			__m128 minimum = _mm_set1_ps(FLT_MAX);
+			for (uint32_t p = 0; p < 6; p++)
+			{
+				__m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx[p], x), _mm_mul_ps(ny[p], y)), _mm_add_ps(_mm_mul_ps(nz[p], z), _mm_sub_ps(r, nd[p])));
+				minimum = _mm_min_ps(minimum, distance);
+			}
+
+			int mask = _mm_movemask_ps(_mm_cmpge_ps(minimum, zero));
+
+			// Branch free scalar compaction: always write, only advance on survivors.
+			indices[survivorCount] = i;		survivorCount += (mask & 1);
+			indices[survivorCount] = i + 1;	survivorCount += (mask >> 1) & 1;
+			indices[survivorCount] = i + 2;	survivorCount += (mask >> 2) & 1;
+			indices[survivorCount] = i + 3;	survivorCount += (mask >> 3) & 1;
+		}
+#endif
+
+		return survivorCount;
+	}
+
+	inline uint32_t CullSoA(const Frustum& frustum, const SphereSoA& spheres, uint32_t* indices)
+	{
+		return CullSoA(frustum, spheres, indices, 0, GetCullPaddedCount(spheres.count));
+	}
+
+	// One task's share of a parallel cull. Survivors are written in place at indices + first.
+	struct CullRange
+	{
+		const Frustum*				frustum;
+		const SphereSoA*			spheres;
+		uint32_t*					indices;
+		uint32_t					first;
+		uint32_t					count;
+		uint32_t					survivorCount;
+		cliqCity::multicore::TaskID	taskID;
+	};
+
+	inline void PerformCullTask(const cliqCity::multicore::TaskData& data)
+	{
+		CullRange* range = reinterpret_cast<CullRange*>(data.mKernelData);
+		range->survivorCount = CullSoA(*range->frustum, *range->spheres, range->indices + range->first, range->first, range->count);
+	}
+
+	// Splits the spheres across rangeCount tasks, waits for them and compacts the per range survivors 
+	// with a prefix sum. ranges is caller owned scratch memory with rangeCount elements.
+	inline uint32_t CullParallel(cliqCity::multicore::TaskDispatcher& dispatcher, const Frustum& frustum, const SphereSoA& spheres, uint32_t* indices, CullRange* ranges, const uint32_t& rangeCount)
+	{
+		uint32_t paddedCount = GetCullPaddedCount(spheres.count);
+		uint32_t rangeSize = GetCullPaddedCount((paddedCount + rangeCount - 1) / rangeCount);
+
+		cliqCity::multicore::TaskData data;
+		uint32_t taskCount = 0;
+		for (uint32_t first = 0; first < paddedCount; first += rangeSize, taskCount++)
+		{
+			CullRange& range = ranges[taskCount];
+			range.frustum = &frustum;
+			range.spheres = &spheres;
+			range.indices = indices;
+			range.first = first;
+			range.count = min(rangeSize, paddedCount - first);
+			range.survivorCount = 0;
+
+			data.mKernelData = &range;
+			range.taskID = dispatcher.AddTask(data, PerformCullTask);
+		}
+
+		uint32_t survivorCount = 0;
+		for (uint32_t i = 0; i < taskCount; i++)
+		{
+			dispatcher.WaitForTask(ranges[i].taskID);
+
+			if (ranges[i].first != survivorCount)
+			{
+				memmove(indices + survivorCount, indices + ranges[i].first, sizeof(uint32_t) * ranges[i].survivorCount);
+			}
+
+			survivorCount += ranges[i].survivorCount;
+		}
+
+		return survivorCount;
+	}
+
+#pragma endregion
+
+#pragma region Box Culling
+
+	template<class Vertex>
+	void ComputeAABB(AABB<vec3f>& aabb, const Vertex* vertices, const uint32_t& count)
+	{
+		vec3f minimum = vertices[0].Position;
+		vec3f maximum = vertices[0].Position;
+
+		for (uint32_t i = 1; i < count; i++)
+		{
+			for (int e = 0; e < 3; e++)
+			{
+				minimum[e] = min(minimum[e], vertices[i].Position[e]);
+				maximum[e] = max(maximum[e], vertices[i].Position[e]);
+			}
+		}
+
+		aabb.origin = (minimum + maximum) * 0.5f;
+		aabb.halfSize = (maximum - minimum) * 0.5f;
+	}
+
+	// Transforms a local space box by a row vector world matrix (no shear).
+	inline void TransformAABB(OBB<vec3f>& obb, const AABB<vec3f>& aabb, const mat4f& world)
+	{
+		for (int i = 0; i < 3; i++)
+		{
+			vec3f axis = { world[i][0], world[i][1], world[i][2] };
+			float scale = cliqCity::graphicsMath::magnitude(axis);
+
+			obb.axes[i] = axis / scale;
+			obb.halfSize[i] = aabb.halfSize[i] * scale;
+		}
+
+		obb.origin = 
+		{
+			aabb.origin.x * world[0][0] + aabb.origin.y * world[1][0] + aabb.origin.z * world[2][0] + world[3][0],
+			aabb.origin.x * world[0][1] + aabb.origin.y * world[1][1] + aabb.origin.z * world[2][1] + world[3][1],
+			aabb.origin.x * world[0][2] + aabb.origin.y * world[1][2] + aabb.origin.z * world[2][2] + world[3][2]
+		};
+	}
+
+	// Shared p/n-vertex test. radius is the box extent projected onto the plane normal, so center +/- radius
+	// are the signed distances of the p-vertex and n-vertex. Planes the box is fully inside of are cleared from
+	// planeMask, which callers pass down to children in a hierarchy so those planes are never tested again.
+	template<class ProjectedRadius>
+	inline CullResult CullBox(const Frustum& frustum, const vec3f& origin, uint8_t& planeMask, CullStatistics* statistics, ProjectedRadius projectedRadius)
+	{
+		const Plane<vec3f>* planes[6] =
+		{
+			&frustum.front,
+			&frustum.back,
+			&frustum.left,
+			&frustum.right,
+			&frustum.bottom,
+			&frustum.top,
+		};
+
+		if (statistics)
+		{
+			statistics->tested++;
+		}
+
+		if (planeMask == 0)
+		{
+			if (statistics)
+			{
+				statistics->inside++;
+			}
+
+			return CULL_RESULT_INSIDE;
+		}
+
+		for (uint32_t p = 0; p < 6; p++)
+		{
+			uint8_t bit = static_cast<uint8_t>(1 << p);
+			if (!(planeMask & bit))
+			{
+				continue;
+			}
+
+			float center = cliqCity::graphicsMath::dot(planes[p]->normal, origin) - planes[p]->distance;
+			float radius = projectedRadius(planes[p]->normal);
+
+			if (statistics)
+			{
+				statistics->planeTests++;
+			}
+
+			// p-vertex behind plane: box is outside
+			if (center + radius < 0.0f)
+			{
+				if (statistics)
+				{
+					statistics->culled++;
+				}
+
+				return CULL_RESULT_OUTSIDE;
+			}
+
+			// n-vertex in front of plane: box is fully inside this plane
+			if (center - radius >= 0.0f)
+			{
+				planeMask &= ~bit;
+			}
+		}
+
+		if (planeMask != 0)
+		{
+			return CULL_RESULT_INTERSECT;
+		}
+
+		if (statistics)
+		{
+			statistics->inside++;
+		}
+
+		return CULL_RESULT_INSIDE;
+	}
+
+	inline CullResult CullAABB(const Frustum& frustum, const AABB<vec3f>& aabb, uint8_t& planeMask, CullStatistics* statistics = nullptr)
+	{
+		return CullBox(frustum, aabb.origin, planeMask, statistics, [&aabb](const vec3f& normal)
+		{
+			return fabsf(normal.x) * aabb.halfSize.x + fabsf(normal.y) * aabb.halfSize.y + fabsf(normal.z) * aabb.halfSize.z;
+		});
+	}
+
+	inline CullResult CullOBB(const Frustum& frustum, const OBB<vec3f>& obb, uint8_t& planeMask, CullStatistics* statistics = nullptr)
+	{
+		return CullBox(frustum, obb.origin, planeMask, statistics, [&obb](const vec3f& normal)
+		{
+			return 
+				fabsf(cliqCity::graphicsMath::dot(normal, obb.axes[0])) * obb.halfSize.x +
+				fabsf(cliqCity::graphicsMath::dot(normal, obb.axes[1])) * obb.halfSize.y +
+				fabsf(cliqCity::graphicsMath::dot(normal, obb.axes[2])) * obb.halfSize.z;
+		});
+	}
+
+	inline void Cull(const Frustum& frustum, AABB<vec3f>* boxes, std::vector<uint32_t>& indices, const uint32_t& count, CullStatistics* statistics = nullptr)
+	{
+		for (uint32_t i = 0; i < count; i++)
+		{
+			uint8_t planeMask = RIG_CULL_PLANE_MASK_ALL;
+			if (CullAABB(frustum, boxes[i], planeMask, statistics) != CULL_RESULT_OUTSIDE)
+			{
+				indices.push_back(i);
+			}
+		}
+	}
+
+	inline void Cull(const Frustum& frustum, OBB<vec3f>* boxes, std::vector<uint32_t>& indices, const uint32_t& count, CullStatistics* statistics = nullptr)
+	{
+		for (uint32_t i = 0; i < count; i++)
+		{
+			uint8_t planeMask = RIG_CULL_PLANE_MASK_ALL;
+			if (CullOBB(frustum, boxes[i], planeMask, statistics) != CULL_RESULT_OUTSIDE)
+			{
+				indices.push_back(i);
+			}
+		}
+	}
+
+#pragma endregion
+
+#pragma region Multi View Culling
+
+	// Tests spheres [first, first + count) against viewCount (at most RIG_CULL_MAX_VIEWS) frusta in one pass.
+	// Bit v of masks[i] is set when sphere i touches view v. first and count must be multiples of RIG_CULL_SIMD_WIDTH.
+	// Objects are the outer loop: each block of spheres is loaded once, tested against every view while its mask
+	// is built in a register, and the mask is stored once. Planes are gathered up front as scalars and broadcast
+	// from there, which keeps all 32 views in a few cache lines.
+	inline void CullMultiViewSoA(const Frustum* frusta, const uint32_t& viewCount, const SphereSoA& spheres, uint32_t* masks, const uint32_t& first, const uint32_t& count)
+	{
+		// x, y, z, distance for the 6 planes of each view
+		float planes[RIG_CULL_MAX_VIEWS][6][4];
+		for (uint32_t v = 0; v < viewCount; v++)
+		{
+			const Plane<vec3f>* frustumPlanes[6] =
+			{
+				&frusta[v].front,
+				&frusta[v].back,
+				&frusta[v].left,
+				&frusta[v].right,
+				&frusta[v].bottom,
+				&frusta[v].top,
+			};
+
+			for (uint32_t p = 0; p < 6; p++)
+			{
+				planes[v][p][0] = frustumPlanes[p]->normal.x;
+				planes[v][p][1] = frustumPlanes[p]->normal.y;
+				planes[v][p][2] = frustumPlanes[p]->normal.z;
+				planes[v][p][3] = frustumPlanes[p]->distance;
+			}
+		}
+
+		uint32_t end = first + count;
+
+#if defined(__AVX2__)
+		__m256 zero = _mm256_setzero_ps();
+
+		for (uint32_t i = first; i < end; i += 8)
+		{
+			__m256 x = _mm256_load_ps(spheres.x + i);
+			__m256 y = _mm256_load_ps(spheres.y + i);
+			__m256 z = _mm256_load_ps(spheres.z + i);
+			__m256 r = _mm256_load_ps(spheres.radius + i);
+
+			__m256i mask = _mm256_setzero_si256();
+			__m256i bit = _mm256_set1_epi32(1);
+
+			for (uint32_t v = 0; v < viewCount; v++)
+			{
+				__m256 minimum = _mm256_set1_ps(FLT_MAX);
+				for (uint32_t p = 0; p < 6; p++)
+				{
+					const float* plane = planes[v][p];
+					__m256 distance = _mm256_fmadd_ps(_mm256_broadcast_ss(plane), x, _mm256_fmadd_ps(_mm256_broadcast_ss(plane + 1), y, _mm256_fmadd_ps(_mm256_broadcast_ss(plane + 2), z, _mm256_sub_ps(r, _mm256_broadcast_ss(plane + 3)))));
+					minimum = _mm256_min_ps(minimum, distance);
+				}
+
+				__m256i visible = _mm256_castps_si256(_mm256_cmp_ps(minimum, zero, _CMP_GE_OQ));
+				mask = _mm256_or_si256(mask, _mm256_and_si256(visible, bit));
+				bit = _mm256_slli_epi32(bit, 1);
+			}
+
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(masks + i), mask);
+		}
+#else
+		__m128 zero = _mm_setzero_ps();
+
+		for (uint32_t i = first; i < end; i += 4)
+		{
+			__m128 x = _mm_load_ps(spheres.x + i);
+			__m128 y = _mm_load_ps(spheres.y + i);
+			__m128 z = _mm_load_ps(spheres.z + i);
+			__m128 r = _mm_load_ps(spheres.radius + i);
+
+			__m128i mask = _mm_setzero_si128();
+			__m128i bit = _mm_set1_epi32(1);
+
+			for (uint32_t v = 0; v < viewCount; v++)
+			{
+				__m128 minimum = _mm_set1_ps(FLT_MAX);
+				for (uint32_t p = 0; p < 6; p++)
+				{
+					const float* plane = planes[v][p];
+					__m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_load1_ps(plane), x), _mm_mul_ps(_mm_load1_ps(plane + 1), y)), _mm_add_ps(_mm_mul_ps(_mm_load1_ps(plane + 2), z), _mm_sub_ps(r, _mm_load1_ps(plane + 3))));
+					minimum = _mm_min_ps(minimum, distance);
+				}
+
+				__m128i visible = _mm_castps_si128(_mm_cmpge_ps(minimum, zero));
+				mask = _mm_or_si128(mask, _mm_and_si128(visible, bit));
+				bit = _mm_slli_epi32(bit, 1);
+			}
+
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(masks + i), mask);
+		}
+#endif
+	}
+
+	struct MultiViewCullRange
+	{
+		const Frustum*				frusta;
+		const SphereSoA*			spheres;
+		uint32_t*					masks;
+		uint32_t					viewCount;
+		uint32_t					first;
+		uint32_t					count;
+		cliqCity::multicore::TaskID	taskID;
+	};
+
+	inline void PerformMultiViewCullTask(const cliqCity::multicore::TaskData& data)
+	{
+		MultiViewCullRange* range = reinterpret_cast<MultiViewCullRange*>(data.mKernelData);
+		CullMultiViewSoA(range->frusta, range->viewCount, *range->spheres, range->masks, range->first, range->count);
+	}
+
+	// Splits the spheres across rangeCount tasks and waits for them. masks needs GetCullPaddedCount(spheres.count)
+	// entries and ranges is caller owned scratch memory with rangeCount elements.
+	inline void CullMultiViewParallel(cliqCity::multicore::TaskDispatcher& dispatcher, const Frustum* frusta, const uint32_t& viewCount, const SphereSoA& spheres, uint32_t* masks, MultiViewCullRange* ranges, const uint32_t& rangeCount)
+	{
+		uint32_t paddedCount = GetCullPaddedCount(spheres.count);
+		uint32_t rangeSize = GetCullPaddedCount((paddedCount + rangeCount - 1) / rangeCount);
+
+		cliqCity::multicore::TaskData data;
+		uint32_t taskCount = 0;
+		for (uint32_t first = 0; first < paddedCount; first += rangeSize, taskCount++)
+		{
+			MultiViewCullRange& range = ranges[taskCount];
+			range.frusta = frusta;
+			range.spheres = &spheres;
+			range.masks = masks;
+			range.viewCount = viewCount;
+			range.first = first;
+			range.count = min(rangeSize, paddedCount - first);
+
+			data.mKernelData = &range;
+			range.taskID = dispatcher.AddTask(data, PerformMultiViewCullTask);
+		}
+
+		for (uint32_t i = 0; i < taskCount; i++)
+		{
+			dispatcher.WaitForTask(ranges[i].taskID);
+		}
+	}
+
+	// Writes the indices of the objects visible in view into indices (count entries) and returns how many there are.
+	inline uint32_t CompactView(const uint32_t* masks, const uint32_t& count, const uint32_t& view, uint32_t* indices)
+	{
+		uint32_t visibleCount = 0;
+		for (uint32_t i = 0; i < count; i++)
+		{
+			// Branch free: always write, only advance on visible objects.
+			indices[visibleCount] = i;
+			visibleCount += (masks[i] >> view) & 1;
+		}
+
+		return visibleCount;
+	}
+
+	struct MultiViewCompactRange
+	{
+		const uint32_t*				masks;
+		uint32_t* const*			indices;
+		uint32_t*					counts;
+		uint32_t					objectCount;
+		uint32_t					firstView;
+		uint32_t					viewCount;
+		cliqCity::multicore::TaskID	taskID;
+	};
+
+	inline void PerformMultiViewCompactTask(const cliqCity::multicore::TaskData& data)
+	{
+		MultiViewCompactRange* range = reinterpret_cast<MultiViewCompactRange*>(data.mKernelData);
+		for (uint32_t v = range->firstView; v < range->firstView + range->viewCount; v++)
+		{
+			range->counts[v] = CompactView(range->masks, range->objectCount, v, range->indices[v]);
+		}
+	}
+
+	// Per view compaction after a multi view cull. indices[v] must hold objectCount entries; counts[v] receives
+	// the number of objects visible in view v. Views are independent, so they are split across rangeCount tasks.
+	inline void CompactViewsParallel(cliqCity::multicore::TaskDispatcher& dispatcher, const uint32_t* masks, const uint32_t& objectCount, const uint32_t& viewCount, uint32_t* const* indices, uint32_t* counts, MultiViewCompactRange* ranges, const uint32_t& rangeCount)
+	{
+		uint32_t rangeSize = (viewCount + rangeCount - 1) / rangeCount;
+
+		cliqCity::multicore::TaskData data;
+		uint32_t taskCount = 0;
+		for (uint32_t first = 0; first < viewCount; first += rangeSize, taskCount++)
+		{
+			MultiViewCompactRange& range = ranges[taskCount];
+			range.masks = masks;
+			range.indices = indices;
+			range.counts = counts;
+			range.objectCount = objectCount;
+			range.firstView = first;
+			range.viewCount = min(rangeSize, viewCount - first);
+
+			data.mKernelData = &range;
+			range.taskID = dispatcher.AddTask(data, PerformMultiViewCompactTask);
+		}
+
+		for (uint32_t i = 0; i < taskCount; i++)
+		{
+			dispatcher.WaitForTask(ranges[i].taskID);
+		}
+	}
+
+#pragma endregion
 }
\ No newline at end of file